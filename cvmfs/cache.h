@@ -9,6 +9,7 @@
 #define __STDC_FORMAT_MACROS
 #endif
 
+#include <errno.h>
 #include <stdint.h>
 
 #include <string>
@@ -170,6 +171,15 @@ class CacheManager : SingleCopy {
   virtual int64_t Pread(int fd, void *buf, uint64_t size, uint64_t offset) = 0;
   virtual int Dup(int fd) = 0;
   virtual int Readahead(int fd) = 0;
+  /**
+   * Optional capability: returns a file descriptor from which the kernel can
+   * read the object's data directly at the object's offsets, e.g. in order to
+   * splice it into the fuse device without copying through user space or to
+   * memory map it.  The returned descriptor is owned by fd and must not be
+   * closed separately.  Cache managers that do not keep objects in plain files
+   * return -ENOTSUP.
+   */
+  virtual int GetSpliceFd(int fd) { return -ENOTSUP; }
 
   virtual uint32_t SizeOfTxn() = 0;
   virtual int StartTxn(const shash::Any &id, uint64_t size, void *txn) = 0;
@@ -81,6 +81,7 @@ class PosixCacheManager : public CacheManager {
   virtual int64_t Pread(int fd, void *buf, uint64_t size, uint64_t offset);
   virtual int Dup(int fd);
   virtual int Readahead(int fd);
+  virtual int GetSpliceFd(int fd) { return fd; }
 
   virtual uint32_t SizeOfTxn() { return sizeof(Transaction); }
   virtual int StartTxn(const shash::Any &id, uint64_t size, void *txn);
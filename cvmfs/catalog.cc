@@ -12,6 +12,7 @@
 
 #include "catalog_mgr.h"
 #include "logging.h"
+#include "murmur.hxx"
 #include "platform.h"
 #include "smalloc.h"
 #include "util_concurrency.h"
@@ -66,6 +67,17 @@ Catalog::Catalog(const PathString &mountpoint,
   lock_ = reinterpret_cast<pthread_mutex_t *>(smalloc(sizeof(pthread_mutex_t)));
   int retval = pthread_mutex_init(lock_, NULL);
   assert(retval == 0);
+  hardlink_lock_ =
+    reinterpret_cast<pthread_mutex_t *>(smalloc(sizeof(pthread_mutex_t)));
+  retval = pthread_mutex_init(hardlink_lock_, NULL);
+  assert(retval == 0);
+  use_sql_readers_ = false;
+  for (unsigned i = 0; i < kNumSqlReaders; ++i) {
+    sql_readers_[i].lock =
+      reinterpret_cast<pthread_mutex_t *>(smalloc(sizeof(pthread_mutex_t)));
+    retval = pthread_mutex_init(sql_readers_[i].lock, NULL);
+    assert(retval == 0);
+  }
 
   database_ = NULL;
   uid_map_ = NULL;
@@ -82,6 +94,13 @@ Catalog::Catalog(const PathString &mountpoint,
 
 
 Catalog::~Catalog() {
+  CloseSqlReaders();
+  for (unsigned i = 0; i < kNumSqlReaders; ++i) {
+    pthread_mutex_destroy(sql_readers_[i].lock);
+    free(sql_readers_[i].lock);
+  }
+  pthread_mutex_destroy(hardlink_lock_);
+  free(hardlink_lock_);
   pthread_mutex_destroy(lock_);
   free(lock_);
   FinalizePreparedStatements();
@@ -119,6 +138,80 @@ void Catalog::FinalizePreparedStatements() {
 }
 
 
+/**
+ * Lookups and listings on read-only catalogs do not need to wait for each
+ * other.  If the main connection is busy, the calling thread uses one of the
+ * additional reader connections.  Otherwise, or if the reader cannot be opened,
+ * the main connection is used.  Returns NULL if the main connection is used,
+ * in which case lock_ is held.
+ */
+Catalog::SqlReader *Catalog::AcquireSqlReader() const {
+  if (use_sql_readers_) {
+    if (pthread_mutex_trylock(lock_) == 0)
+      return NULL;
+
+    const pthread_t self = pthread_self();
+    SqlReader *reader = &sql_readers_[
+      MurmurHash2(&self, sizeof(self), 0x07387a4f) % kNumSqlReaders];
+    int retval = pthread_mutex_lock(reader->lock);
+    assert(retval == 0);
+    if ((reader->database != NULL) || OpenSqlReader(reader))
+      return reader;
+    retval = pthread_mutex_unlock(reader->lock);
+    assert(retval == 0);
+  }
+
+  int retval = pthread_mutex_lock(lock_);
+  assert(retval == 0);
+  return NULL;
+}
+
+
+void Catalog::ReleaseSqlReader(SqlReader *reader) const {
+  int retval = pthread_mutex_unlock((reader == NULL) ? lock_ : reader->lock);
+  assert(retval == 0);
+}
+
+
+/**
+ * Opens another connection to the database file.  The memory of the reader
+ * connections is managed by the sqlite memory manager like the one of the main
+ * connection.  Called with the reader lock held.
+ */
+bool Catalog::OpenSqlReader(SqlReader *reader) const {
+  if (reader->failed)
+    return false;
+
+  reader->database = CatalogDatabase::Open(database_->filename(),
+                                           CatalogDatabase::kOpenReadOnly);
+  if (reader->database == NULL) {
+    LogCvmfs(kLogCatalog, kLogDebug,
+             "failed to open reader connection for catalog %s",
+             mountpoint_.c_str());
+    reader->failed = true;
+    return false;
+  }
+  // Use the same statements as the main connection, see OpenDatabase()
+  reader->database->EnforceSchema(database_->schema_version(),
+                                  database_->schema_revision());
+  reader->sql_listing = new SqlListing(*reader->database);
+  reader->sql_lookup_md5path = new SqlLookupPathHash(*reader->database);
+  return true;
+}
+
+
+void Catalog::CloseSqlReaders() {
+  for (unsigned i = 0; i < kNumSqlReaders; ++i) {
+    delete sql_readers_[i].sql_lookup_md5path;
+    delete sql_readers_[i].sql_listing;
+    delete sql_readers_[i].database;
+    sql_readers_[i].sql_lookup_md5path = NULL;
+    sql_readers_[i].sql_listing = NULL;
+    sql_readers_[i].database = NULL;
+  }
+}
+
+
 bool Catalog::InitStandalone(const std::string &database_file) {
   bool retval = OpenDatabase(database_file);
   if (!retval) {
@@ -229,6 +322,7 @@ bool Catalog::OpenDatabase(const string &db_path) {
     parent_->AddChild(this);
   }
 
+  use_sql_readers_ = (DatabaseOpenMode() == CatalogDatabase::kOpenReadOnly);
   initialized_ = true;
   return true;
 }
@@ -301,18 +395,28 @@ PathString Catalog::PlantPath(const PathString &path) const {
  * @return true if DirectoryEntry was successfully found, false otherwise
  */
 bool Catalog::LookupEntry(const shash::Md5 &md5path, const bool expand_symlink,
-                          DirectoryEntry *dirent) const
+                          DirectoryEntry *dirent, bool *io_error) const
 {
   assert(IsInitialized());
 
-  MutexLockGuard m(lock_);
-  sql_lookup_md5path_->BindPathHash(md5path);
-  bool found = sql_lookup_md5path_->FetchRow();
+  SqlReader *reader = AcquireSqlReader();
+  SqlLookupPathHash *sql_lookup_md5path = (reader == NULL) ?
+    sql_lookup_md5path_ : reader->sql_lookup_md5path;
+  sql_lookup_md5path->BindPathHash(md5path);
+  bool found = sql_lookup_md5path->FetchRow();
+  if (!found && (sql_lookup_md5path->GetLastError() != SQLITE_DONE)) {
+    LogCvmfs(kLogCatalog, kLogDebug | kLogSyslogErr,
+             "failed to read catalog %s (%d)", mountpoint_.c_str(),
+             sql_lookup_md5path->GetLastError());
+    if (io_error != NULL)
+      *io_error = true;
+  }
   if (found && (dirent != NULL)) {
-    *dirent = sql_lookup_md5path_->GetDirent(this, expand_symlink);
+    *dirent = sql_lookup_md5path->GetDirent(this, expand_symlink);
     FixTransitionPoint(md5path, dirent);
   }
-  sql_lookup_md5path_->Reset();
+  sql_lookup_md5path->Reset();
+  ReleaseSqlReader(reader);
 
   return found;
 }
@@ -374,10 +478,12 @@ bool Catalog::ListingMd5PathStat(const shash::Md5 &md5path,
   DirectoryEntry dirent;
   StatEntry entry;
 
-  MutexLockGuard m(lock_);
-  sql_listing_->BindPathHash(md5path);
-  while (sql_listing_->FetchRow()) {
-    dirent = sql_listing_->GetDirent(this);
+  SqlReader *reader = AcquireSqlReader();
+  SqlListing *sql_listing =
+    (reader == NULL) ? sql_listing_ : reader->sql_listing;
+  sql_listing->BindPathHash(md5path);
+  while (sql_listing->FetchRow()) {
+    dirent = sql_listing->GetDirent(this);
     if (dirent.IsHidden())
       continue;
     FixTransitionPoint(md5path, &dirent);
@@ -385,9 +491,11 @@ bool Catalog::ListingMd5PathStat(const shash::Md5 &md5path,
     entry.info = dirent.GetStatStructure();
     listing->PushBack(entry);
   }
-  sql_listing_->Reset();
+  const bool retval = (sql_listing->GetLastError() == SQLITE_DONE);
+  sql_listing->Reset();
+  ReleaseSqlReader(reader);
 
-  return true;
+  return retval;
 }
 
 
@@ -405,17 +513,20 @@ bool Catalog::ListingMd5Path(const shash::Md5 &md5path,
 {
   assert(IsInitialized());
 
-  MutexLockGuard m(lock_);
-
-  sql_listing_->BindPathHash(md5path);
-  while (sql_listing_->FetchRow()) {
-    DirectoryEntry dirent = sql_listing_->GetDirent(this, expand_symlink);
+  SqlReader *reader = AcquireSqlReader();
+  SqlListing *sql_listing =
+    (reader == NULL) ? sql_listing_ : reader->sql_listing;
+  sql_listing->BindPathHash(md5path);
+  while (sql_listing->FetchRow()) {
+    DirectoryEntry dirent = sql_listing->GetDirent(this, expand_symlink);
     FixTransitionPoint(md5path, &dirent);
     listing->push_back(dirent);
   }
-  sql_listing_->Reset();
+  const bool retval = (sql_listing->GetLastError() == SQLITE_DONE);
+  sql_listing->Reset();
+  ReleaseSqlReader(reader);
 
-  return true;
+  return retval;
 }
 
 
@@ -562,6 +673,22 @@ shash::Any Catalog::GetPreviousRevision() const {
 }
 
 
+/**
+ * Returns the hash of the index of the paged representation of a nested
+ * catalog or a null hash.  The index might refer to an older revision of the
+ * nested catalog.
+ */
+shash::Any Catalog::GetNestedPagedIndex(const PathString &mountpoint) const {
+  MutexLockGuard m(lock_);
+  const std::string hash_string = database().GetPropertyDefault<std::string>(
+    MakePagedIndexKey(mountpoint.ToString()), "");
+  return (!hash_string.empty())
+    ? shash::MkFromHexPtr(shash::HexPtr(hash_string),
+                          shash::kSuffixPagedCatalog)
+    : shash::Any();
+}
+
+
 string Catalog::PrintMemStatistics() const {
   sqlite::MemStatistics stats;
   {
@@ -603,6 +730,7 @@ inode_t Catalog::GetMangledInode(const uint64_t row_id,
   // Hardlinks are encoded in catalog-wide unique hard link group ids.
   // These ids must be resolved to actual inode relationships at runtime.
   if (hardlink_group > 0) {
+    MutexLockGuard m(hardlink_lock_);
     HardlinkGroupMap::const_iterator inode_iter =
       hardlink_groups_.find(hardlink_group);
 
@@ -91,6 +91,7 @@ class InodeAnnotation {
 class Catalog : SingleCopy {
   FRIEND_TEST(T_Catalog, NormalizePath);
   FRIEND_TEST(T_Catalog, PlantPath);
+  FRIEND_TEST(T_Catalog, SqlReaders);
   friend class swissknife::CommandMigrate;  // for catalog version migration
 
  public:
@@ -124,6 +125,15 @@ class Catalog : SingleCopy {
   inline bool LookupPath(const PathString &path, DirectoryEntry *dirent) const {
     return LookupMd5Path(NormalizePath(path), dirent);
   }
+  /**
+   * Sets io_error if the entry might exist but the database could not be read,
+   * e.g. because a block of a paged catalog failed to download.
+   */
+  inline bool LookupPath(const PathString &path, DirectoryEntry *dirent,
+                         bool *io_error) const
+  {
+    return LookupEntry(NormalizePath(path), true, dirent, io_error);
+  }
   bool LookupRawSymlink(const PathString &path, LinkString *raw_symlink) const;
   bool LookupXattrsPath(const PathString &path, XattrList *xattrs) const {
     return LookupXattrsMd5Path(NormalizePath(path), xattrs);
@@ -172,6 +182,7 @@ class Catalog : SingleCopy {
   uint64_t GetNumEntries() const;
   uint64_t GetNumChunks() const;
   shash::Any GetPreviousRevision() const;
+  shash::Any GetNestedPagedIndex(const PathString &mountpoint) const;
   const Counters& GetCounters() const { return counters_; }
   std::string PrintMemStatistics() const;
 
@@ -227,7 +238,11 @@ class Catalog : SingleCopy {
 
  protected:
   typedef std::map<uint64_t, inode_t> HardlinkGroupMap;
+  /**
+   * Protected by hardlink_lock_ because it is updated by concurrent readers
+   */
   mutable HardlinkGroupMap hardlink_groups_;
+  pthread_mutex_t *hardlink_lock_;
 
   pthread_mutex_t *lock_;
 
@@ -252,6 +267,14 @@ class Catalog : SingleCopy {
 
   void ResetNestedCatalogCacheUnprotected();
 
+  /**
+   * The property that stores the hash of the paged index of the nested
+   * catalog at mountpoint, see catalog_paged.h
+   */
+  static std::string MakePagedIndexKey(const std::string &mountpoint) {
+    return "paged_index:" + mountpoint;
+  }
+
   bool LookupMd5Path(const shash::Md5 &md5path, DirectoryEntry *dirent) const;
 
  private:
@@ -269,6 +292,37 @@ class Catalog : SingleCopy {
     kVomsPresent,  // voms_authz property available
   };
 
+  /**
+   * An additional read-only connection to the catalog database together with
+   * its own statements for lookups and listings.  Used by concurrent readers
+   * if the main connection is busy.  Opened on first use.
+   */
+  struct SqlReader {
+    SqlReader()
+      : lock(NULL)
+      , database(NULL)
+      , sql_listing(NULL)
+      , sql_lookup_md5path(NULL)
+      , failed(false)
+    { }
+    pthread_mutex_t *lock;
+    CatalogDatabase *database;
+    SqlListing *sql_listing;
+    SqlLookupPathHash *sql_lookup_md5path;
+    bool failed;
+  };
+
+  /**
+   * Number of additional connections of a read-only catalog.  Threads are
+   * mapped to readers by their thread id.
+   */
+  static const unsigned kNumSqlReaders = 4;
+
+  SqlReader *AcquireSqlReader() const;
+  void ReleaseSqlReader(SqlReader *reader) const;
+  bool OpenSqlReader(SqlReader *reader) const;
+  void CloseSqlReaders();
+
   shash::Md5 NormalizePath(const PathString &path) const;
   PathString NormalizePath2(const PathString &path) const;
   PathString PlantPath(const PathString &path) const;
@@ -286,7 +340,7 @@ class Catalog : SingleCopy {
   bool ListingMd5PathStat(const shash::Md5 &md5path,
                           StatEntryList *listing) const;
   bool LookupEntry(const shash::Md5 &md5path, const bool expand_symlink,
-                   DirectoryEntry *dirent) const;
+                   DirectoryEntry *dirent, bool *io_error = NULL) const;
 
   CatalogDatabase *database_;
 
@@ -334,6 +388,12 @@ class Catalog : SingleCopy {
   SqlChunksListing            *sql_chunks_listing_;
   SqlLookupXattrs             *sql_lookup_xattrs_;
 
+  /**
+   * Only used for read-only catalogs, see AcquireSqlReader()
+   */
+  bool use_sql_readers_;
+  mutable SqlReader sql_readers_[kNumSqlReaders];
+
   mutable HashVector        referenced_hashes_;
 };  // class Catalog
 
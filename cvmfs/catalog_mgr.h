@@ -125,7 +125,7 @@ class AbstractCatalogManager : public SingleCopy {
 
   void SetInodeAnnotation(InodeAnnotation *new_annotation);
   virtual bool Init();
-  LoadError Remount(const bool dry_run);
+  LoadError Remount(const bool dry_run, shash::Any *root_hash = NULL);
   LoadError ChangeRoot(const shash::Any &root_hash);
   void DetachNested();
 
@@ -5,17 +5,25 @@
 #include "cvmfs_config.h"
 #include "catalog_mgr_client.h"
 
+#include <errno.h>
+#include <pthread.h>
+
+#include <algorithm>
+#include <cassert>
 #include <string>
 #include <vector>
 
 #include "cache_posix.h"
+#include "catalog_paged.h"
 #include "download.h"
 #include "fetch.h"
 #include "manifest.h"
 #include "mountpoint.h"
+#include "platform.h"
 #include "quota.h"
 #include "signature.h"
 #include "statistics.h"
+#include "util/mutex.h"
 #include "util/posix.h"
 #include "util/string.h"
 
@@ -45,12 +53,23 @@ ClientCatalogManager::ClientCatalogManager(MountPoint *mountpoint)
   , all_inodes_(0)
   , loaded_inodes_(0)
   , fixed_alt_root_catalog_(false)
+  , paged_catalogs_(false)
+  , prestage_parallelism_(0)
 {
   LogCvmfs(kLogCatalog, kLogDebug, "constructing client catalog manager");
   n_certificate_hits_ = mountpoint->statistics()->Register(
     "cache.n_certificate_hits", "Number of certificate hits");
   n_certificate_misses_ = mountpoint->statistics()->Register(
     "cache.n_certificate_misses", "Number of certificate misses");
+  n_prestaged_ = mountpoint->statistics()->Register(
+    "catalog_mgr.n_prestaged",
+    "Number of catalogs fetched before applying a new revision");
+  sz_prestaged_ = mountpoint->statistics()->Register(
+    "catalog_mgr.sz_prestaged",
+    "Number of bytes of catalogs fetched before applying a new revision");
+  prestage_ready_ms_ = mountpoint->statistics()->Register(
+    "catalog_mgr.prestage_ready_ms",
+    "Milliseconds until the last new revision was ready to be applied");
 }
 
 
@@ -129,7 +148,8 @@ LoadError ClientCatalogManager::LoadCatalog(
     if (mountpoint.IsEmpty() && fixed_alt_root_catalog_)
       alt_catalog_path = hash.MakeAlternativePath();
     LoadError load_error =
-      LoadCatalogCas(hash, cvmfs_path, alt_catalog_path, catalog_path);
+      LoadCatalogCas(hash, cvmfs_path, alt_catalog_path,
+                     GetPagedIndexHash(mountpoint, hash), catalog_path);
     if (load_error == catalog::kLoadNew)
       loaded_catalogs_[mountpoint] = hash;
     *catalog_hash = hash;
@@ -176,7 +196,7 @@ LoadError ClientCatalogManager::LoadCatalog(
 
     if (catalog_path) {
       LoadError success_code =
-        LoadCatalogCas(cache_hash, cvmfs_path, "", catalog_path);
+        LoadCatalogCas(cache_hash, cvmfs_path, "", shash::Any(), catalog_path);
       if (success_code != catalog::kLoadNew)
         return success_code;
       loaded_catalogs_[mountpoint] = cache_hash;
@@ -211,7 +231,7 @@ LoadError ClientCatalogManager::LoadCatalog(
 
     if (catalog_path) {
       LoadError error =
-        LoadCatalogCas(cache_hash, cvmfs_path, "", catalog_path);
+        LoadCatalogCas(cache_hash, cvmfs_path, "", shash::Any(), catalog_path);
       if (error == catalog::kLoadNew) {
         loaded_catalogs_[mountpoint] = cache_hash;
         *catalog_hash = cache_hash;
@@ -224,8 +244,10 @@ LoadError ClientCatalogManager::LoadCatalog(
       return success_code;
     }
   }
-  if (!catalog_path)
+  if (!catalog_path) {
+    *catalog_hash = ensemble.manifest->catalog_hash();
     return catalog::kLoadNew;
+  }
 
   // Load new catalog
   catalog::LoadError load_retval =
@@ -233,6 +255,8 @@ LoadError ClientCatalogManager::LoadCatalog(
                    cvmfs_path,
                    ensemble.manifest->has_alt_catalog_path() ?
                      ensemble.manifest->MakeCatalogPath() : "",
+                   GetPagedIndexHash(mountpoint,
+                                     ensemble.manifest->catalog_hash()),
                    catalog_path);
   if (load_retval != catalog::kLoadNew)
     return load_retval;
@@ -248,13 +272,85 @@ LoadError ClientCatalogManager::LoadCatalog(
 }
 
 
+/**
+ * Returns the hash of the paged index for the catalog at mountpoint, if
+ * available.  The index of the root catalog is taken from the manifest, the
+ * index of nested catalogs from the parent catalog.  Called with the write lock
+ * held.
+ */
+shash::Any ClientCatalogManager::GetPagedIndexHash(
+  const PathString &mountpoint,
+  const shash::Any &hash)
+{
+  if (!paged_catalogs_)
+    return shash::Any();
+  if (mountpoint.IsEmpty()) {
+    if (manifest_.IsValid() && (manifest_->catalog_hash() == hash))
+      return manifest_->paged_catalog_index();
+    return shash::Any();
+  }
+  if (GetCatalogs().empty())
+    return shash::Any();
+  // The nested catalog is not yet attached, so this is its parent
+  return FindCatalog(mountpoint)->GetNestedPagedIndex(mountpoint);
+}
+
+
+/**
+ * Fetches and parses the index of a paged catalog.  Returns NULL on failure.
+ */
+PagedCatalogIndex *ClientCatalogManager::FetchPagedIndex(
+  const shash::Any &index_hash,
+  const string &name)
+{
+  CacheManager *cache_mgr = fetcher_->cache_mgr();
+  int fd = fetcher_->Fetch(index_hash, CacheManager::kSizeUnknown,
+                           "paged index of " + name, zlib::kZlibDefault,
+                           CacheManager::kTypeRegular);
+  if (fd < 0)
+    return NULL;
+  int64_t size = cache_mgr->GetSize(fd);
+  string text(std::max(size, static_cast<int64_t>(0)), '\0');
+  const int64_t nbytes =
+    (size > 0) ? cache_mgr->Pread(fd, &text[0], size, 0) : size;
+  cache_mgr->Close(fd);
+  if ((size <= 0) || (nbytes != size))
+    return NULL;
+  return PagedCatalogIndex::Parse(text);
+}
+
+
 LoadError ClientCatalogManager::LoadCatalogCas(
   const shash::Any &hash,
   const string &name,
   const std::string &alt_catalog_path,
+  const shash::Any &paged_index_hash,
   string *catalog_path)
 {
   assert(hash.suffix == shash::kSuffixCatalog);
+  if (!paged_index_hash.IsNull()) {
+    // A complete copy in the cache is preferred
+    int fd = fetcher_->cache_mgr()->OpenPinned(hash, name, true);
+    if (fd >= 0) {
+      *catalog_path = "@" + StringifyInt(fd);
+      return kLoadNew;
+    }
+    if (fd == -ENOSPC)
+      return kLoadNoSpace;
+
+    PagedCatalogIndex *index = FetchPagedIndex(paged_index_hash, name);
+    if ((index != NULL) && (index->catalog_hash() == hash)) {
+      LogCvmfs(kLogCatalog, kLogDebug, "opening paged %s (%u blocks)",
+               name.c_str(), index->num_blocks());
+      *catalog_path = sqlite::RegisterPageReader(
+        new PagedCatalogReader(fetcher_, index, name));
+      return kLoadNew;
+    }
+    LogCvmfs(kLogCatalog, kLogDebug, "invalid or stale paged index %s for %s",
+             paged_index_hash.ToString().c_str(), name.c_str());
+    delete index;
+  }
+
   int fd = fetcher_->Fetch(hash, CacheManager::kSizeUnknown, name,
     zlib::kZlibDefault, CacheManager::kTypeCatalog, alt_catalog_path);
   if (fd >= 0) {
@@ -283,6 +379,137 @@ void ClientCatalogManager::UnloadCatalog(const Catalog *catalog) {
 }
 
 
+/**
+ * Fetches the new root catalog and, recursively, every nested catalog of the
+ * new revision that is currently attached with a different hash.  Nested
+ * catalogs that did not change are skipped together with their subtree.  The
+ * catalogs are fetched by prestage_parallelism_ threads and are only cached,
+ * not attached; they are unpinned again so that a failed remount does not
+ * leave them pinned.  Failures are not fatal, the remaining catalogs are then
+ * loaded on demand as usual.
+ */
+void ClientCatalogManager::PrestageCatalogs(const shash::Any &root_hash) {
+  if ((prestage_parallelism_ == 0) || root_hash.IsNull())
+    return;
+  const uint64_t start_ns = platform_monotonic_time_ns();
+
+  PrestageState state;
+  state.catalog_mgr = this;
+  ReadLock();
+  state.attached = mounted_catalogs_;
+  Unlock();
+  state.queue.push_back(std::make_pair(PathString("", 0), root_hash));
+  state.num_busy = 0;
+  int retval = pthread_mutex_init(&state.lock, NULL);
+  assert(retval == 0);
+  retval = pthread_cond_init(&state.cond, NULL);
+  assert(retval == 0);
+
+  LogCvmfs(kLogCatalog, kLogDebug, "pre-staging catalogs of revision %s "
+           "(%u threads)", root_hash.ToString().c_str(), prestage_parallelism_);
+  vector<pthread_t> threads(prestage_parallelism_);
+  for (unsigned i = 0; i < threads.size(); ++i) {
+    retval = pthread_create(&threads[i], NULL, MainPrestage, &state);
+    assert(retval == 0);
+  }
+  for (unsigned i = 0; i < threads.size(); ++i)
+    pthread_join(threads[i], NULL);
+  pthread_cond_destroy(&state.cond);
+  pthread_mutex_destroy(&state.lock);
+
+  prestage_ready_ms_->Set((platform_monotonic_time_ns() - start_ns) / 1000000);
+  LogCvmfs(kLogCatalog, kLogDebug, "pre-staged catalogs of revision %s in "
+           "%" PRId64 " ms", root_hash.ToString().c_str(),
+           prestage_ready_ms_->Get());
+}
+
+
+void *ClientCatalogManager::MainPrestage(void *data) {
+  PrestageState *state = reinterpret_cast<PrestageState *>(data);
+  vector<std::pair<PathString, shash::Any> > next;
+  while (true) {
+    pthread_mutex_lock(&state->lock);
+    while (state->queue.empty() && (state->num_busy > 0))
+      pthread_cond_wait(&state->cond, &state->lock);
+    if (state->queue.empty()) {
+      // Nothing left and no other thread can produce more work
+      pthread_cond_broadcast(&state->cond);
+      pthread_mutex_unlock(&state->lock);
+      return NULL;
+    }
+    std::pair<PathString, shash::Any> job = state->queue.back();
+    state->queue.pop_back();
+    state->num_busy++;
+    pthread_mutex_unlock(&state->lock);
+
+    next.clear();
+    state->catalog_mgr->PrestageCatalog(job.first, job.second, state, &next);
+
+    pthread_mutex_lock(&state->lock);
+    state->queue.insert(state->queue.end(), next.begin(), next.end());
+    state->num_busy--;
+    pthread_cond_broadcast(&state->cond);
+    pthread_mutex_unlock(&state->lock);
+  }
+}
+
+
+/**
+ * Fetches a single catalog into the cache and collects its changed nested
+ * catalogs that are part of the attached tree in next.
+ */
+void ClientCatalogManager::PrestageCatalog(
+  const PathString &mountpoint,
+  const shash::Any &hash,
+  PrestageState *state,
+  vector<std::pair<PathString, shash::Any> > *next)
+{
+  const string name = "file catalog at " + repo_name_ + ":" +
+    (mountpoint.IsEmpty() ? "/" : mountpoint.ToString()) +
+    " (" + hash.ToString() + ", pre-staged)";
+  CacheManager *cache_mgr = fetcher_->cache_mgr();
+  int fd = fetcher_->Fetch(hash, CacheManager::kSizeUnknown, name,
+                           zlib::kZlibDefault, CacheManager::kTypeCatalog);
+  if (fd < 0) {
+    LogCvmfs(kLogCatalog, kLogDebug, "failed to pre-stage %s (%d)",
+             name.c_str(), fd);
+    return;
+  }
+  perf::Inc(n_prestaged_);
+  perf::Xadd(sz_prestaged_, std::max(cache_mgr->GetSize(fd),
+                                     static_cast<int64_t>(0)));
+
+  // The database connection takes over the file descriptor
+  Catalog *catalog = new Catalog(mountpoint, hash, NULL, !mountpoint.IsEmpty());
+  if (catalog->OpenDatabase("@" + StringifyInt(fd))) {
+    const Catalog::NestedCatalogList &nested = catalog->ListNestedCatalogs();
+    for (unsigned i = 0; i < nested.size(); ++i) {
+      map<PathString, shash::Any>::const_iterator iter =
+        state->attached.find(nested[i].mountpoint);
+      if ((iter != state->attached.end()) && (iter->second != nested[i].hash))
+        next->push_back(std::make_pair(nested[i].mountpoint, nested[i].hash));
+    }
+  } else {
+    LogCvmfs(kLogCatalog, kLogDebug, "failed to open pre-staged %s",
+             name.c_str());
+  }
+  delete catalog;
+
+  // Catalogs that are in use stay pinned
+  bool is_attached = false;
+  for (map<PathString, shash::Any>::const_iterator i = state->attached.begin(),
+       iend = state->attached.end(); i != iend; ++i)
+  {
+    if (i->second == hash) {
+      is_attached = true;
+      break;
+    }
+  }
+  if (!is_attached)
+    cache_mgr->quota_mgr()->Unpin(hash);
+}
+
+
 /**
  * Checks if the current repository revision is blacklisted.  The format
  * of the blacklist lines is '<REPO N' where REPO is the repository name,
@@ -328,6 +555,110 @@ bool ClientCatalogManager::IsRevisionBlacklisted() {
 //------------------------------------------------------------------------------
 
 
+PagedCatalogReader::PagedCatalogReader(
+  cvmfs::Fetcher *fetcher,
+  PagedCatalogIndex *index,
+  const string &name)
+  : fetcher_(fetcher)
+  , index_(index)
+  , name_(name)
+  , url_("data/" + index->data_hash().MakePath())
+{
+  atomic_init32(&fd_full_);
+  atomic_write32(&fd_full_, -1);
+  int retval = pthread_mutex_init(&lock_fallback_, NULL);
+  assert(retval == 0);
+}
+
+
+PagedCatalogReader::~PagedCatalogReader() {
+  const int fd_full = atomic_read32(&fd_full_);
+  if (fd_full >= 0)
+    fetcher_->cache_mgr()->Close(fd_full);
+  pthread_mutex_destroy(&lock_fallback_);
+  delete index_;
+}
+
+
+/**
+ * Downloads the full catalog, unless another thread already did.  The catalog
+ * is pinned like a catalog that is loaded the classic way and unpinned when it
+ * is unloaded.  Returns the file descriptor or -errno.
+ */
+int PagedCatalogReader::FetchFullCatalog() {
+  MutexLockGuard m(lock_fallback_);
+  int fd_full = atomic_read32(&fd_full_);
+  if (fd_full >= 0)
+    return fd_full;
+  fd_full = fetcher_->Fetch(index_->catalog_hash(), CacheManager::kSizeUnknown,
+                            name_, zlib::kZlibDefault,
+                            CacheManager::kTypeCatalog);
+  if (fd_full < 0) {
+    LogCvmfs(kLogCatalog, kLogDebug | kLogSyslogErr,
+             "failed to fetch %s, neither paged nor in full (%d)",
+             name_.c_str(), fd_full);
+    return fd_full;
+  }
+  LogCvmfs(kLogCatalog, kLogDebug | kLogSyslogWarn,
+           "falling back to the full catalog for paged %s", name_.c_str());
+  atomic_write32(&fd_full_, fd_full);
+  return fd_full;
+}
+
+
+uint64_t PagedCatalogReader::GetSize() {
+  return index_->size();
+}
+
+
+/**
+ * Every touched block is fetched, if necessary, and read from the cache.
+ */
+int64_t PagedCatalogReader::Pread(void *buf, uint64_t size, uint64_t offset) {
+  CacheManager *cache_mgr = fetcher_->cache_mgr();
+  int fd_full = atomic_read32(&fd_full_);
+  if (fd_full >= 0)
+    return cache_mgr->Pread(fd_full, buf, size, offset);
+  if (offset >= index_->size())
+    return 0;
+  size = std::min(size, index_->size() - offset);
+
+  uint64_t nbytes = 0;
+  while (nbytes < size) {
+    const uint64_t pos = offset + nbytes;
+    const unsigned block_idx = pos / index_->block_size();
+    const uint64_t pos_in_block = pos % index_->block_size();
+    const uint64_t block_size = index_->GetBlockSize(block_idx);
+    const PagedCatalogIndex::Block &block = index_->block(block_idx);
+    int fd = fetcher_->Fetch(block.hash, block_size,
+                             name_ + " block " + StringifyInt(block_idx),
+                             zlib::kZlibDefault, CacheManager::kTypeRegular,
+                             url_, block.offset, block.compressed_size);
+    if (fd < 0) {
+      LogCvmfs(kLogCatalog, kLogDebug, "failed to fetch block %u of %s (%d)",
+               block_idx, name_.c_str(), fd);
+      fd_full = FetchFullCatalog();
+      if (fd_full < 0)
+        return fd_full;
+      return cache_mgr->Pread(fd_full, buf, size, offset);
+    }
+    const uint64_t to_read = std::min(size - nbytes, block_size - pos_in_block);
+    const int64_t retval = cache_mgr->Pread(
+      fd, reinterpret_cast<char *>(buf) + nbytes, to_read, pos_in_block);
+    cache_mgr->Close(fd);
+    if (retval < 0)
+      return retval;
+    if (static_cast<uint64_t>(retval) != to_read)
+      return -EIO;
+    nbytes += to_read;
+  }
+  return nbytes;
+}
+
+
+//------------------------------------------------------------------------------
+
+
 void CachedManifestEnsemble::FetchCertificate(const shash::Any &hash) {
   uint64_t size;
   bool retval = cache_mgr_->Open2Mem(
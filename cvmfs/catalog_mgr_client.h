@@ -8,14 +8,19 @@
 #include "catalog_mgr.h"
 
 #include <inttypes.h>
+#include <pthread.h>
 
 #include <map>
 #include <string>
+#include <utility>
+#include <vector>
 
+#include "atomic.h"
 #include "backoff.h"
 #include "hash.h"
 #include "manifest_fetch.h"
 #include "shortstring.h"
+#include "sqlitevfs.h"
 
 class CacheManager;
 namespace cvmfs {
@@ -32,6 +37,8 @@ class SignatureManager;
 
 namespace catalog {
 
+class PagedCatalogIndex;
+
 /**
  * A catalog manager that uses a Fetcher to get file catalgs in the form of
  * (virtual) file descriptors from a cache manager.  Sqlite has a path based
@@ -45,12 +52,27 @@ namespace catalog {
  * updated root catalogs.  It requires the cache manager to get access to the
  * Unpin() method of the corresponding quota manager; loaded catalogs need to
  * be unpinned when the class is destructed.
+ *
+ * If paged catalogs are enabled and the publisher provides a paged catalog
+ * that is not yet in the cache, the catalog is opened as %<id> from a
+ * PagedCatalogReader instead.  Only the blocks that sqlite reads are then
+ * downloaded.
+ *
+ * Before a new revision is applied, PrestageCatalogs() can fetch the new root
+ * catalog and the changed nested catalogs of the currently attached tree into
+ * the cache, so that the remount itself and the first lookups after the
+ * remount do not wait for downloads.
  */
 class ClientCatalogManager : public AbstractCatalogManager<Catalog> {
   // Maintains certificate hit/miss counters
   friend class CachedManifestEnsemble;
 
  public:
+  /**
+   * Upper bound for the number of threads that pre-stage catalogs
+   */
+  static const unsigned kMaxPrestageParallelism = 16;
+
   explicit ClientCatalogManager(MountPoint *mountpoint);
   virtual ~ClientCatalogManager();
 
@@ -60,11 +82,18 @@ class ClientCatalogManager : public AbstractCatalogManager<Catalog> {
 
   bool IsRevisionBlacklisted();
 
+  void PrestageCatalogs(const shash::Any &root_hash);
+
   bool offline_mode() const { return offline_mode_; }
   uint64_t all_inodes() const { return all_inodes_; }
   uint64_t loaded_inodes() const { return loaded_inodes_; }
   std::string repo_name() const { return repo_name_; }
   manifest::Manifest *manifest() const { return manifest_.weak_ref(); }
+  void set_paged_catalogs(const bool value) { paged_catalogs_ = value; }
+  void set_prestage_parallelism(const uint64_t value) {
+    prestage_parallelism_ = (value > kMaxPrestageParallelism) ?
+                            kMaxPrestageParallelism : value;
+  }
 
  protected:
   LoadError LoadCatalog(const PathString  &mountpoint,
@@ -78,10 +107,33 @@ class ClientCatalogManager : public AbstractCatalogManager<Catalog> {
   void ActivateCatalog(catalog::Catalog *catalog);
 
  private:
+  /**
+   * Shared by the threads of PrestageCatalogs().  The queue contains the
+   * catalogs that still need to be fetched.
+   */
+  struct PrestageState {
+    ClientCatalogManager *catalog_mgr;
+    std::map<PathString, shash::Any> attached;
+    std::vector<std::pair<PathString, shash::Any> > queue;
+    unsigned num_busy;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+  };
+  static void *MainPrestage(void *data);
+  void PrestageCatalog(const PathString &mountpoint,
+                       const shash::Any &hash,
+                       PrestageState *state,
+                       std::vector<std::pair<PathString, shash::Any> > *next);
+
   LoadError LoadCatalogCas(const shash::Any &hash,
                            const std::string &name,
                            const std::string &alt_catalog_path,
+                           const shash::Any &paged_index_hash,
                            std::string *catalog_path);
+  shash::Any GetPagedIndexHash(const PathString &mountpoint,
+                               const shash::Any &hash);
+  PagedCatalogIndex *FetchPagedIndex(const shash::Any &index_hash,
+                                     const std::string &name);
 
   /**
    * Required for unpinning
@@ -99,9 +151,18 @@ class ClientCatalogManager : public AbstractCatalogManager<Catalog> {
   uint64_t all_inodes_;
   uint64_t loaded_inodes_;
   bool fixed_alt_root_catalog_;  /**< fixed root hash but alternative url */
+  bool paged_catalogs_;
+  /**
+   * Number of catalogs fetched in parallel by PrestageCatalogs(), 0 disables
+   * pre-staging
+   */
+  unsigned prestage_parallelism_;
   BackoffThrottle backoff_throttle_;
   perf::Counter *n_certificate_hits_;
   perf::Counter *n_certificate_misses_;
+  perf::Counter *n_prestaged_;
+  perf::Counter *sz_prestaged_;
+  perf::Counter *prestage_ready_ms_;
 };
 
 
@@ -123,6 +184,37 @@ class CachedManifestEnsemble : public manifest::ManifestEnsemble {
   ClientCatalogManager *catalog_mgr_;
 };
 
+
+/**
+ * Provides a paged catalog to the sqlite VFS.  The blocks of the catalog are
+ * fetched on demand through the Fetcher as ranges of the data object and then
+ * read from the cache.  If a block cannot be fetched, e.g. because a proxy
+ * ignores range requests, the reader falls back to the full catalog object and
+ * serves all further reads from there.
+ */
+class PagedCatalogReader : public sqlite::PageReader {
+ public:
+  PagedCatalogReader(cvmfs::Fetcher *fetcher,
+                     PagedCatalogIndex *index,
+                     const std::string &name);
+  virtual ~PagedCatalogReader();
+  virtual uint64_t GetSize();
+  virtual int64_t Pread(void *buf, uint64_t size, uint64_t offset);
+
+ private:
+  int FetchFullCatalog();
+
+  cvmfs::Fetcher *fetcher_;
+  PagedCatalogIndex *index_;
+  std::string name_;
+  std::string url_;
+  /**
+   * Pinned file descriptor of the full catalog once the reader fell back to it
+   */
+  atomic_int32 fd_full_;
+  pthread_mutex_t lock_fallback_;
+};
+
 }  // namespace catalog
 
 #endif  // CVMFS_CATALOG_MGR_CLIENT_H_
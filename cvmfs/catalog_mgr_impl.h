@@ -112,14 +112,18 @@ bool AbstractCatalogManager<CatalogT>::Init() {
 /**
  * Remounts the root catalog if necessary.  If a newer root catalog exists,
  * it is mounted and replaces the currently mounted tree (all existing catalogs
- * are detached)
+ * are detached).  If root_hash is given, it receives the hash of the root
+ * catalog of the latest revision.
  */
 template <class CatalogT>
-LoadError AbstractCatalogManager<CatalogT>::Remount(const bool dry_run) {
+LoadError AbstractCatalogManager<CatalogT>::Remount(
+  const bool dry_run,
+  shash::Any *root_hash)
+{
   LogCvmfs(kLogCatalog, kLogDebug,
            "remounting repositories (dry run %d)", dry_run);
   if (dry_run)
-    return LoadCatalog(PathString("", 0), shash::Any(), NULL, NULL);
+    return LoadCatalog(PathString("", 0), shash::Any(), NULL, root_hash);
 
   WriteLock();
 
@@ -129,6 +133,8 @@ LoadError AbstractCatalogManager<CatalogT>::Remount(const bool dry_run) {
                                            shash::Any(),
                                            &catalog_path,
                                            &catalog_hash);
+  if (root_hash != NULL)
+    *root_hash = catalog_hash;
   if (load_error == kLoadNew) {
     inode_t old_inode_gauge = inode_gauge_;
     DetachAll();
@@ -264,10 +270,14 @@ bool AbstractCatalogManager<CatalogT>::LookupPath(const PathString &path,
   perf::Inc(statistics_.n_lookup_path);
   LogCvmfs(kLogCatalog, kLogDebug, "looking up '%s' in catalog: '%s'",
            path.c_str(), best_fit->mountpoint().c_str());
-  bool found = best_fit->LookupPath(path, dirent);
+  // An entry that cannot be read is an I/O error and must not become ENOENT
+  bool io_error = false;
+  bool found = best_fit->LookupPath(path, dirent, &io_error);
 
   // Possibly in a nested catalog
-  if (!found && MountSubtree(path, best_fit, false /* is_listable */, NULL)) {
+  if (!found && !io_error &&
+      MountSubtree(path, best_fit, false /* is_listable */, NULL))
+  {
     LogCvmfs(kLogCatalog, kLogDebug, "looking up '%s' in a nested catalog",
              path.c_str());
     Unlock();
@@ -276,9 +286,9 @@ bool AbstractCatalogManager<CatalogT>::LookupPath(const PathString &path,
     best_fit = FindCatalog(path);
     assert(best_fit != NULL);
     perf::Inc(statistics_.n_lookup_path);
-    found = best_fit->LookupPath(path, dirent);
+    found = best_fit->LookupPath(path, dirent, &io_error);
 
-    if (!found) {
+    if (!found && !io_error) {
       LogCvmfs(kLogCatalog, kLogDebug,
                "entry not found, we may have to load nested catalogs");
 
@@ -294,12 +304,12 @@ bool AbstractCatalogManager<CatalogT>::LookupPath(const PathString &path,
 
       if (nested_catalog != best_fit) {
         perf::Inc(statistics_.n_lookup_path);
-        found = nested_catalog->LookupPath(path, dirent);
+        found = nested_catalog->LookupPath(path, dirent, &io_error);
         if (!found) {
           LogCvmfs(kLogCatalog, kLogDebug,
                    "nested catalogs loaded but entry '%s' was still not found",
                    path.c_str());
-          if (dirent != NULL) *dirent = dirent_negative;
+          if ((dirent != NULL) && !io_error) *dirent = dirent_negative;
           goto lookup_path_notfound;
         } else {
           best_fit = nested_catalog;
@@ -310,7 +320,11 @@ bool AbstractCatalogManager<CatalogT>::LookupPath(const PathString &path,
         goto lookup_path_notfound;
       }
     }
-    assert(found);
+    assert(found || io_error);
+  }
+  if (io_error) {
+    LogCvmfs(kLogCatalog, kLogDebug, "EIO: '%s'", path.c_str());
+    goto lookup_path_notfound;
   }
   // Not in a nested catalog (because no nested cataog fits), ENOENT
   if (!found) {
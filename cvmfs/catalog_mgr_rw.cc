@@ -15,6 +15,7 @@
 #include <string>
 
 #include "catalog_balancer.h"
+#include "catalog_paged.h"
 #include "catalog_rw.h"
 #include "logging.h"
 #include "manifest.h"
@@ -49,6 +50,7 @@ WritableCatalogManager::WritableCatalogManager(
   , nested_kcatalog_limit_(nested_kcatalog_limit)
   , root_kcatalog_limit_(root_kcatalog_limit)
   , file_mbyte_limit_(file_mbyte_limit)
+  , paged_catalogs_(false)
   , is_balanceable_(is_balanceable)
   , max_weight_(max_weight)
   , min_weight_(min_weight)
@@ -1079,6 +1081,7 @@ bool WritableCatalogManager::Commit(const bool           stop_for_tweaks,
   manifest->set_root_path("");
   manifest->set_ttl(root_catalog_info.ttl);
   manifest->set_revision(root_catalog_info.revision);
+  manifest->set_paged_catalog_index(root_catalog_info.paged_index_hash);
 
   return true;
 }
@@ -1223,6 +1226,52 @@ void WritableCatalogManager::ScheduleCatalogProcessing(
 }
 
 
+/**
+ * Creates the paged representation of a finalized catalog and schedules the
+ * upload of its data and index objects.  Returns the hash of the index.
+ */
+shash::Any WritableCatalogManager::UploadPagedCatalog(
+  const WritableCatalog *catalog,
+  const shash::Any &catalog_hash)
+{
+  const string data_path = catalog->database_path() + ".paged";
+  const string index_path = catalog->database_path() + ".paged_index";
+  UniquePtr<PagedCatalogIndex> index(
+    PagedCatalogIndex::Create(catalog->database_path(), data_path,
+                              catalog_hash));
+  if (!index.IsValid()) {
+    PANIC(kLogStderr, "could not create paged catalog for %s",
+          catalog->mountpoint().c_str());
+  }
+
+  shash::Any index_hash(catalog_hash.algorithm, shash::kSuffixPagedCatalog);
+  const string index_text = index->Serialize();
+  FILE *findex = fopen(index_path.c_str(), "w");
+  if ((findex == NULL) ||
+      !zlib::CompressMem2File(
+        reinterpret_cast<const unsigned char *>(index_text.data()),
+        index_text.length(), findex, &index_hash) ||
+      (fclose(findex) != 0))
+  {
+    PANIC(kLogStderr, "could not write paged catalog index for %s",
+          catalog->mountpoint().c_str());
+  }
+
+  LogCvmfs(kLogCatalog, kLogVerboseMsg,
+           "uploading paged catalog '%s' (%u blocks, index %s)",
+           catalog->mountpoint().c_str(), index->num_blocks(),
+           index_hash.ToStringWithSuffix().c_str());
+  {
+    MutexLockGuard guard(catalog_processing_lock_);
+    paged_uploads_.insert(data_path);
+    paged_uploads_.insert(index_path);
+  }
+  spooler_->Upload(data_path, "data/" + index->data_hash().MakePath());
+  spooler_->Upload(index_path, "data/" + index_hash.MakePath());
+  return index_hash;
+}
+
+
 void WritableCatalogManager::CatalogUploadCallback(
                           const upload::SpoolerResult &result,
                           const CatalogUploadContext   catalog_upload_context) {
@@ -1236,6 +1285,11 @@ void WritableCatalogManager::CatalogUploadCallback(
   WritableCatalog *catalog = NULL;
   {
     MutexLockGuard guard(catalog_processing_lock_);
+    // see WritableCatalogManager::UploadPagedCatalog()
+    if (paged_uploads_.erase(result.local_path) > 0) {
+      unlink(result.local_path.c_str());
+      return;
+    }
     std::map<std::string, WritableCatalog*>::iterator c =
       catalog_processing_map_.find(result.local_path);
     assert(c != catalog_processing_map_.end());
@@ -1245,6 +1299,10 @@ void WritableCatalogManager::CatalogUploadCallback(
   uint64_t catalog_size = GetFileSize(result.local_path);
   assert(catalog_size > 0);
 
+  shash::Any paged_index_hash;
+  if (paged_catalogs_)
+    paged_index_hash = UploadPagedCatalog(catalog, result.content_hash);
+
   SyncLock();
   if (catalog->HasParent()) {
     // finalized nested catalogs will update their parent's pointer and schedule
@@ -1257,6 +1315,10 @@ void WritableCatalogManager::CatalogUploadCallback(
                                 catalog_size,
                                 catalog->delta_counters_);
     catalog->delta_counters_.SetZero();
+    if (paged_catalogs_) {
+      parent->SetNestedPagedIndex(catalog->mountpoint().ToString(),
+                                  paged_index_hash);
+    }
 
     const int remaining_dirty_children =
       catalog->GetWritableParent()->DecrementDirtyChildren();
@@ -1278,6 +1340,7 @@ void WritableCatalogManager::CatalogUploadCallback(
     root_catalog_info.ttl          = catalog->GetTTL();
     root_catalog_info.content_hash = result.content_hash;
     root_catalog_info.revision     = catalog->GetRevision();
+    root_catalog_info.paged_index_hash = paged_index_hash;
     catalog_upload_context.root_catalog_info->Set(root_catalog_info);
     SyncUnlock();
   } else {
@@ -1434,17 +1497,27 @@ WritableCatalogManager::SnapshotCatalogsSerialized(
     int64_t catalog_size = GetFileSize((*i)->database_path());
     assert(catalog_size > 0);
 
+    // Paged objects are unlinked by CatalogUploadSerializedCallback()
+    shash::Any paged_index_hash;
+    if (paged_catalogs_)
+      paged_index_hash = UploadPagedCatalog(*i, hash_catalog);
+
     if ((*i)->HasParent()) {
       LogCvmfs(kLogCatalog, kLogVerboseMsg, "updating nested catalog link");
       WritableCatalog *parent = (*i)->GetWritableParent();
       parent->UpdateNestedCatalog((*i)->mountpoint().ToString(), hash_catalog,
                                   catalog_size, (*i)->delta_counters_);
       (*i)->delta_counters_.SetZero();
+      if (paged_catalogs_) {
+        parent->SetNestedPagedIndex((*i)->mountpoint().ToString(),
+                                    paged_index_hash);
+      }
     } else if ((*i)->IsRoot()) {
       root_catalog_info.size = catalog_size;
       root_catalog_info.ttl = (*i)->GetTTL();
       root_catalog_info.content_hash = hash_catalog;
       root_catalog_info.revision = (*i)->GetRevision();
+      root_catalog_info.paged_index_hash = paged_index_hash;
     } else {
       PANIC(kLogStderr, "inconsistent state detected");
     }
@@ -141,6 +141,11 @@ class WritableCatalogManager : public SimpleCatalogManager {
 
   void SetTTL(const uint64_t new_ttl);
   bool SetVOMSAuthz(const std::string &voms_authz);
+  /**
+   * Additionally upload a paged representation of every committed catalog,
+   * see catalog_paged.h
+   */
+  void set_paged_catalogs(const bool value) { paged_catalogs_ = value; }
   bool Commit(const bool           stop_for_tweaks,
               const uint64_t       manual_revision,
               manifest::Manifest  *manifest);
@@ -182,6 +187,7 @@ class WritableCatalogManager : public SimpleCatalogManager {
     size_t       size;
     shash::Any   content_hash;
     unsigned int revision;
+    shash::Any   paged_index_hash;
   };
 
   struct CatalogUploadContext {
@@ -193,6 +199,8 @@ class WritableCatalogManager : public SimpleCatalogManager {
   void FinalizeCatalog(WritableCatalog *catalog,
                        const bool stop_for_tweaks);
   void ScheduleCatalogProcessing(WritableCatalog *catalog);
+  shash::Any UploadPagedCatalog(const WritableCatalog *catalog,
+                                const shash::Any &catalog_hash);
 
   void GetModifiedCatalogLeafs(WritableCatalogList *result) const {
     const bool dirty = GetModifiedCatalogLeafsRecursively(GetRootCatalog(),
@@ -233,12 +241,18 @@ class WritableCatalogManager : public SimpleCatalogManager {
 
   pthread_mutex_t                         *catalog_processing_lock_;
   std::map<std::string, WritableCatalog*>  catalog_processing_map_;
+  /**
+   * Local paths of uploaded paged catalog objects, whose upload callbacks are
+   * ignored.  Protected by catalog_processing_lock_.
+   */
+  std::set<std::string>                    paged_uploads_;
 
   // TODO(jblomer): catalog limits should become its own struct
   bool enforce_limits_;
   unsigned nested_kcatalog_limit_;
   unsigned root_kcatalog_limit_;
   unsigned file_mbyte_limit_;
+  bool paged_catalogs_;
 
   /**
    * Directories don't have extended attributes at this point.
@@ -0,0 +1,196 @@
+/**
+ * This file is part of the CernVM File System.
+ */
+
+#include "catalog_paged.h"
+
+#include <alloca.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cassert>
+#include <cstdlib>
+#include <vector>
+
+#include "compression.h"
+#include "smalloc.h"
+#include "util/pointer.h"
+#include "util/posix.h"
+#include "util/string.h"
+
+using namespace std;  // NOLINT
+
+namespace catalog {
+
+PagedCatalogIndex *PagedCatalogIndex::Create(
+  const string &db_path,
+  const string &data_path,
+  const shash::Any &catalog_hash,
+  const unsigned block_size)
+{
+  const shash::Algorithms algorithm = catalog_hash.algorithm;
+  assert(block_size > 0);
+  int fd_db = open(db_path.c_str(), O_RDONLY);
+  if (fd_db < 0)
+    return NULL;
+  int fd_data = open(data_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+  if (fd_data < 0) {
+    close(fd_db);
+    return NULL;
+  }
+
+  PagedCatalogIndex *result = new PagedCatalogIndex();
+  result->block_size_ = block_size;
+  result->catalog_hash_ = catalog_hash;
+  shash::ContextPtr data_ctx(algorithm);
+  data_ctx.buffer = alloca(data_ctx.size);
+  shash::Init(data_ctx);
+  unsigned char *buf = reinterpret_cast<unsigned char *>(smalloc(block_size));
+  bool success = true;
+  while (true) {
+    ssize_t nbytes = SafeRead(fd_db, buf, block_size);
+    if (nbytes < 0) {
+      success = false;
+      break;
+    }
+    if (nbytes == 0)
+      break;
+
+    void *zbuf;
+    uint64_t zsize;
+    if (!zlib::CompressMem2Mem(buf, nbytes, &zbuf, &zsize)) {
+      success = false;
+      break;
+    }
+    Block block;
+    block.offset = result->blocks_.empty() ? 0 :
+      result->blocks_.back().offset + result->blocks_.back().compressed_size;
+    block.compressed_size = zsize;
+    block.hash = shash::Any(algorithm);
+    shash::HashMem(reinterpret_cast<unsigned char *>(zbuf), zsize,
+                   &block.hash);
+    shash::Update(reinterpret_cast<unsigned char *>(zbuf), zsize, data_ctx);
+    success = SafeWrite(fd_data, zbuf, zsize);
+    free(zbuf);
+    if (!success)
+      break;
+    result->blocks_.push_back(block);
+    result->size_ += nbytes;
+  }
+  free(buf);
+  close(fd_db);
+  if (close(fd_data) != 0)
+    success = false;
+  if (!success) {
+    unlink(data_path.c_str());
+    delete result;
+    return NULL;
+  }
+
+  result->data_hash_ = shash::Any(algorithm);
+  shash::Final(data_ctx, &result->data_hash_);
+  result->data_hash_.suffix = shash::kSuffixPartial;
+  return result;
+}
+
+
+PagedCatalogIndex *PagedCatalogIndex::Parse(const string &text) {
+  vector<string> lines = SplitString(text, '\n');
+  UniquePtr<PagedCatalogIndex> result(new PagedCatalogIndex());
+  bool has_version = false;
+  bool has_catalog_hash = false;
+  bool has_data_hash = false;
+  unsigned i = 0;
+  for (; i < lines.size(); ++i) {
+    const string &line = lines[i];
+    if (line == "--")
+      break;
+    if (line.empty())
+      return NULL;
+    const string value = line.substr(1);
+    switch (line[0]) {
+      case 'V':
+        if (String2Uint64(value) != kVersion)
+          return NULL;
+        has_version = true;
+        break;
+      case 'C':
+        if (!shash::HexPtr(value).IsValid())
+          return NULL;
+        result->catalog_hash_ =
+          shash::MkFromHexPtr(shash::HexPtr(value), shash::kSuffixCatalog);
+        has_catalog_hash = true;
+        break;
+      case 'B':
+        result->block_size_ = String2Uint64(value);
+        break;
+      case 'S':
+        result->size_ = String2Uint64(value);
+        break;
+      case 'D':
+        if (!shash::HexPtr(value).IsValid())
+          return NULL;
+        result->data_hash_ =
+          shash::MkFromHexPtr(shash::HexPtr(value), shash::kSuffixPartial);
+        has_data_hash = true;
+        break;
+      default:
+        // Unknown keys are ignored for forward compatibility
+        break;
+    }
+  }
+  if ((i == lines.size()) || !has_version || !has_catalog_hash ||
+      !has_data_hash || (result->block_size_ == 0))
+  {
+    return NULL;
+  }
+
+  uint64_t offset = 0;
+  for (++i; i < lines.size(); ++i) {
+    if (lines[i].empty())
+      continue;
+    vector<string> fields = SplitString(lines[i], ' ');
+    Block block;
+    if ((fields.size() != 2) ||
+        !String2Uint64Parse(fields[0], &block.compressed_size) ||
+        !shash::HexPtr(fields[1]).IsValid())
+    {
+      return NULL;
+    }
+    block.offset = offset;
+    block.hash = shash::MkFromHexPtr(shash::HexPtr(fields[1]));
+    offset += block.compressed_size;
+    result->blocks_.push_back(block);
+  }
+
+  const uint64_t num_blocks =
+    (result->size_ + result->block_size_ - 1) / result->block_size_;
+  if (num_blocks != result->blocks_.size())
+    return NULL;
+  return result.Release();
+}
+
+
+string PagedCatalogIndex::Serialize() const {
+  string result =
+    "V" + StringifyUint(kVersion) + "\n" +
+    "C" + catalog_hash_.ToString() + "\n" +
+    "B" + StringifyUint(block_size_) + "\n" +
+    "S" + StringifyUint(size_) + "\n" +
+    "D" + data_hash_.ToString() + "\n" +
+    "--\n";
+  for (unsigned i = 0; i < blocks_.size(); ++i) {
+    result += StringifyUint(blocks_[i].compressed_size) + " " +
+              blocks_[i].hash.ToString() + "\n";
+  }
+  return result;
+}
+
+
+uint64_t PagedCatalogIndex::GetBlockSize(const unsigned block_idx) const {
+  assert(block_idx < blocks_.size());
+  const uint64_t offset = static_cast<uint64_t>(block_idx) * block_size_;
+  return (size_ - offset < block_size_) ? size_ - offset : block_size_;
+}
+
+}  // namespace catalog
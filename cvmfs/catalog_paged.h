@@ -0,0 +1,108 @@
+/**
+ * This file is part of the CernVM File System.
+ *
+ * The paged representation of a file catalog allows clients to fetch only the
+ * parts of a catalog that sqlite actually reads.  The catalog database is cut
+ * into blocks of a fixed size.  The blocks are compressed independently and
+ * stored one after another in a data object.  A small index object lists the
+ * compressed size and the content hash of every block.  Both are regular
+ * content-addressed objects.
+ *
+ * The publisher stores the hash of the index object next to the reference to
+ * the catalog: in the properties of the parent catalog for nested catalogs and
+ * in the manifest for the root catalog.  The index names the catalog it was
+ * created from, so that stale references are detected.
+ */
+
+#ifndef CVMFS_CATALOG_PAGED_H_
+#define CVMFS_CATALOG_PAGED_H_
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "hash.h"
+
+namespace catalog {
+
+/**
+ * Describes the blocks of the data object of a paged catalog.  The index is
+ * serialized as text:
+ *   V<version>
+ *   C<content hash of the (classic) catalog object>
+ *   B<uncompressed block size>
+ *   S<size of the catalog database>
+ *   D<hash of the data object>
+ *   --
+ *   <compressed size> <hash>   (one line per block)
+ *
+ * The blocks are stored in order, so the offset of a block in the data object
+ * is the sum of the compressed sizes of the preceding blocks.
+ */
+class PagedCatalogIndex {
+ public:
+  static const unsigned kVersion = 1;
+  /**
+   * A multiple of the sqlite page size.  Blocks are downloaded and cached as a
+   * whole.
+   */
+  static const unsigned kDefaultBlockSize = 64 * 1024;
+
+  struct Block {
+    Block() : offset(0), compressed_size(0) { }
+    /**
+     * Offset in the data object
+     */
+    uint64_t offset;
+    uint64_t compressed_size;
+    /**
+     * Content hash of the compressed block
+     */
+    shash::Any hash;
+  };
+
+  /**
+   * Cuts the database file at db_path into blocks and writes the data object
+   * to data_path.  The blocks are hashed with the algorithm of catalog_hash.
+   * Returns NULL on I/O errors.
+   */
+  static PagedCatalogIndex *Create(const std::string &db_path,
+                                   const std::string &data_path,
+                                   const shash::Any &catalog_hash,
+                                   const unsigned block_size =
+                                     kDefaultBlockSize);
+  /**
+   * Returns NULL if the text is not a valid index.
+   */
+  static PagedCatalogIndex *Parse(const std::string &text);
+  std::string Serialize() const;
+
+  /**
+   * The size of the uncompressed block; only the last block can be smaller
+   * than the block size.
+   */
+  uint64_t GetBlockSize(const unsigned block_idx) const;
+
+  uint64_t size() const { return size_; }
+  unsigned block_size() const { return block_size_; }
+  unsigned num_blocks() const { return blocks_.size(); }
+  const Block &block(const unsigned block_idx) const {
+    return blocks_[block_idx];
+  }
+  const shash::Any &catalog_hash() const { return catalog_hash_; }
+  const shash::Any &data_hash() const { return data_hash_; }
+
+ private:
+  PagedCatalogIndex() : size_(0), block_size_(0) { }
+
+  uint64_t size_;
+  unsigned block_size_;
+  shash::Any catalog_hash_;
+  shash::Any data_hash_;
+  std::vector<Block> blocks_;
+};
+
+}  // namespace catalog
+
+#endif  // CVMFS_CATALOG_PAGED_H_
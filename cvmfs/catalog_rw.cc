@@ -574,6 +574,13 @@ void WritableCatalog::RemoveNestedCatalog(const string &mountpoint,
     stmt.Execute();
   assert(retval);
 
+  SqlCatalog stmt_paged(database(),
+                        "DELETE FROM properties WHERE key = :key;");
+  retval =
+    stmt_paged.BindText(1, MakePagedIndexKey(mountpoint)) &&
+    stmt_paged.Execute();
+  assert(retval);
+
   // If the reference was successfully deleted, we also have to check whether
   // there is also an attached reference in our in-memory data.
   // In this case we remove the child and return it through **attached_reference
@@ -610,6 +617,22 @@ void WritableCatalog::RemoveBindMountpoint(const std::string &mountpoint) {
 }
 
 
+/**
+ * Stores the hash of the paged index of a nested catalog.  Stale entries of
+ * nested catalogs that are not paged anymore are detected by the client
+ * through the catalog hash in the index.
+ */
+void WritableCatalog::SetNestedPagedIndex(const std::string &mountpoint,
+                                          const shash::Any &index_hash)
+{
+  MutexLockGuard guard(lock_);
+  SetDirty();
+  const bool retval = database().SetProperty(MakePagedIndexKey(mountpoint),
+                                             index_hash.ToString());
+  assert(retval);
+}
+
+
 /**
  * Updates the link to a nested catalog in the database.
  * @param path             the path of the nested catalog to update
@@ -97,6 +97,8 @@ class WritableCatalog : public Catalog {
   void RemoveNestedCatalog(const std::string &mountpoint,
                            Catalog **attached_reference);
   void RemoveBindMountpoint(const std::string &mountpoint);
+  void SetNestedPagedIndex(const std::string &mountpoint,
+                           const shash::Any &index_hash);
 
   void UpdateLastModified();
   void IncrementRevision();
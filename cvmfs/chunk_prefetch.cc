@@ -0,0 +1,243 @@
+/**
+ * This file is part of the CernVM File System.
+ */
+
+#include "cvmfs_config.h"
+#include "chunk_prefetch.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "fetch.h"
+#include "logging.h"
+#include "murmur.hxx"
+#include "util/mutex.h"
+
+using namespace std;  // NOLINT
+
+namespace cvmfs {
+
+static inline uint32_t hasher_handle(const uint64_t &value) {
+  return MurmurHash2(&value, sizeof(value), 0x07387a4f);
+}
+
+
+ChunkPrefetcher::ChunkPrefetcher(
+  Fetcher *fetcher,
+  Fetcher *external_fetcher,
+  const unsigned max_window,
+  const unsigned num_workers,
+  const uint64_t max_bytes,
+  perf::StatisticsTemplate statistics)
+  : fetcher_(fetcher)
+  , external_fetcher_(external_fetcher)
+  , max_window_(max_window)
+  , num_workers_(num_workers)
+  , max_bytes_(max_bytes)
+  , bytes_scheduled_(0)
+  , terminate_(false)
+{
+  assert(max_window_ > 0);
+  assert(num_workers_ > 0);
+  int retval = pthread_mutex_init(&lock_, NULL);
+  assert(retval == 0);
+  retval = pthread_cond_init(&cond_jobs_, NULL);
+  assert(retval == 0);
+  // Chunk handles start at 2, so 0 is a safe empty key
+  handles_.Init(16, 0, hasher_handle);
+
+  n_scheduled_ = statistics.RegisterTemplated("n_scheduled",
+    "overall number of chunks scheduled for prefetching");
+  n_hits_ = statistics.RegisterTemplated("n_hits",
+    "overall number of prefetched chunks used by the reader");
+  n_wasted_ = statistics.RegisterTemplated("n_wasted",
+    "overall number of prefetched chunks not used by the reader");
+  n_failed_ = statistics.RegisterTemplated("n_failed",
+    "overall number of failed chunk prefetches");
+  n_throttled_ = statistics.RegisterTemplated("n_throttled",
+    "overall number of chunk prefetches skipped due to the memory budget");
+  sz_prefetched_ = statistics.RegisterTemplated("sz_prefetched",
+    "overall number of bytes of prefetched chunks");
+}
+
+
+ChunkPrefetcher::~ChunkPrefetcher() {
+  {
+    MutexLockGuard m(&lock_);
+    terminate_ = true;
+    int retval = pthread_cond_broadcast(&cond_jobs_);
+    assert(retval == 0);
+  }
+  for (unsigned i = 0; i < workers_.size(); ++i)
+    pthread_join(workers_[i], NULL);
+  pthread_cond_destroy(&cond_jobs_);
+  pthread_mutex_destroy(&lock_);
+}
+
+
+void ChunkPrefetcher::CountWastedUnlocked(
+  const HandleState &state,
+  const unsigned chunk_idx)
+{
+  if (state.prefetch_idx <= state.next_idx)
+    return;
+  unsigned nwasted = state.prefetch_idx - state.next_idx;
+  if ((chunk_idx >= state.next_idx) && (chunk_idx < state.prefetch_idx))
+    nwasted--;
+  perf::Xadd(n_wasted_, nwasted);
+}
+
+
+void ChunkPrefetcher::Forget(const uint64_t handle) {
+  MutexLockGuard m(&lock_);
+  HandleState state;
+  if (!handles_.Lookup(handle, &state))
+    return;
+  CountWastedUnlocked(state, state.prefetch_idx);
+  handles_.Erase(handle);
+}
+
+
+void *ChunkPrefetcher::MainWorker(void *data) {
+  ChunkPrefetcher *prefetcher = reinterpret_cast<ChunkPrefetcher *>(data);
+  LogCvmfs(kLogCvmfs, kLogDebug, "starting chunk prefetch worker");
+
+  while (true) {
+    Job job;
+    {
+      MutexLockGuard m(&prefetcher->lock_);
+      while (prefetcher->jobs_.empty() && !prefetcher->terminate_)
+        pthread_cond_wait(&prefetcher->cond_jobs_, &prefetcher->lock_);
+      if (prefetcher->terminate_)
+        break;
+      job = prefetcher->jobs_.front();
+      prefetcher->jobs_.pop_front();
+    }
+
+    prefetcher->ProcessJob(job);
+
+    MutexLockGuard m(&prefetcher->lock_);
+    prefetcher->bytes_scheduled_ -= job.chunk.size();
+  }
+
+  LogCvmfs(kLogCvmfs, kLogDebug, "stopping chunk prefetch worker");
+  return NULL;
+}
+
+
+void ChunkPrefetcher::OnChunkAccess(
+  const uint64_t handle,
+  const FileChunkReflist &chunks,
+  const unsigned chunk_idx,
+  const CacheManager::ObjectType object_type)
+{
+  const unsigned num_chunks = chunks.list->size();
+
+  MutexLockGuard m(&lock_);
+  HandleState state;
+  if (!handles_.Lookup(handle, &state)) {
+    state.next_idx = state.prefetch_idx = chunk_idx + 1;
+    handles_.Insert(handle, state);
+    return;
+  }
+
+  const bool is_prefetched =
+    (chunk_idx >= state.next_idx) && (chunk_idx < state.prefetch_idx);
+  if (is_prefetched)
+    perf::Inc(n_hits_);
+
+  if (chunk_idx != state.next_idx) {
+    CountWastedUnlocked(state, chunk_idx);
+    state.next_idx = state.prefetch_idx = chunk_idx + 1;
+    state.window = 0;
+    handles_.Insert(handle, state);
+    return;
+  }
+
+  // Sequential access: open or widen the window
+  if (is_prefetched)
+    state.window = std::min(2 * state.window, max_window_);
+  state.window = std::max(state.window, 1U);
+  state.next_idx = chunk_idx + 1;
+  state.prefetch_idx = std::max(state.prefetch_idx, state.next_idx);
+
+  const unsigned end_idx = std::min(state.next_idx + state.window, num_chunks);
+  if (state.prefetch_idx < end_idx) {
+    Job job;
+    job.path = chunks.path.ToString();
+    job.compression_alg = chunks.compression_alg;
+    job.external_data = chunks.external_data;
+    job.object_type = object_type;
+    while (state.prefetch_idx < end_idx) {
+      job.chunk = *chunks.list->AtPtr(state.prefetch_idx);
+      if (!ScheduleUnlocked(job))
+        break;
+      state.prefetch_idx++;
+    }
+  }
+  handles_.Insert(handle, state);
+}
+
+
+void ChunkPrefetcher::ProcessJob(const Job &job) {
+  const string verbose_path = "Part of " + job.path;
+  Fetcher *this_fetcher = job.external_data ? external_fetcher_ : fetcher_;
+  int fd;
+  if (job.external_data) {
+    fd = this_fetcher->Fetch(job.chunk.content_hash(),
+                             job.chunk.size(),
+                             verbose_path,
+                             job.compression_alg,
+                             job.object_type,
+                             job.path,
+                             job.chunk.offset());
+  } else {
+    fd = this_fetcher->Fetch(job.chunk.content_hash(),
+                             job.chunk.size(),
+                             verbose_path,
+                             job.compression_alg,
+                             job.object_type);
+  }
+  if (fd < 0) {
+    LogCvmfs(kLogCvmfs, kLogDebug, "failed to prefetch chunk %s of %s (%d)",
+             job.chunk.content_hash().ToString().c_str(), job.path.c_str(),
+             fd);
+    perf::Inc(n_failed_);
+    return;
+  }
+  this_fetcher->cache_mgr()->Close(fd);
+  perf::Xadd(sz_prefetched_, job.chunk.size());
+}
+
+
+/**
+ * Returns false if the job does not fit into the memory budget.  A single job
+ * is always accepted, even if it is larger than the budget.
+ */
+bool ChunkPrefetcher::ScheduleUnlocked(const Job &job) {
+  if ((bytes_scheduled_ > 0) &&
+      (bytes_scheduled_ + job.chunk.size() > max_bytes_))
+  {
+    perf::Inc(n_throttled_);
+    return false;
+  }
+  bytes_scheduled_ += job.chunk.size();
+  jobs_.push_back(job);
+  perf::Inc(n_scheduled_);
+  int retval = pthread_cond_signal(&cond_jobs_);
+  assert(retval == 0);
+  return true;
+}
+
+
+void ChunkPrefetcher::Spawn() {
+  assert(workers_.empty());
+  for (unsigned i = 0; i < num_workers_; ++i) {
+    pthread_t thread;
+    int retval = pthread_create(&thread, NULL, MainWorker, this);
+    assert(retval == 0);
+    workers_.push_back(thread);
+  }
+}
+
+}  // namespace cvmfs
@@ -0,0 +1,145 @@
+/**
+ * This file is part of the CernVM File System.
+ *
+ * Readahead of file chunks for sequentially read chunked files.
+ */
+
+#ifndef CVMFS_CHUNK_PREFETCH_H_
+#define CVMFS_CHUNK_PREFETCH_H_
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "cache.h"
+#include "compression.h"
+#include "file_chunk.h"
+#include "gtest/gtest_prod.h"
+#include "smallhash.h"
+#include "statistics.h"
+#include "util/mutex.h"
+#include "util/single_copy.h"
+
+namespace cvmfs {
+
+class Fetcher;
+
+/**
+ * Watches the order in which open chunked file handles move from chunk to
+ * chunk.  Once a handle walks its chunk list sequentially, the following chunks
+ * are fetched into the cache by a small set of worker threads, so that the
+ * reader does not stall for a full round trip on every chunk boundary.
+ *
+ * The readahead window of a handle starts with a single chunk and doubles
+ * every time a prefetched chunk is actually used, up to max_window chunks.  A
+ * non-sequential access resets the window.  Concurrent downloads of the same
+ * chunk by a reader and a worker are collapsed by the Fetcher.
+ *
+ * Prefetched chunks are regular cache objects; the worker closes its file
+ * descriptor right after the download.  The number of open file descriptors is
+ * thus bounded by the number of workers and the amount of scheduled but not yet
+ * downloaded data is bounded by max_bytes.
+ */
+class ChunkPrefetcher : SingleCopy {
+  FRIEND_TEST(T_ChunkPrefetcher, SequentialAccess);
+  FRIEND_TEST(T_ChunkPrefetcher, RandomAccess);
+  FRIEND_TEST(T_ChunkPrefetcher, Budget);
+
+ public:
+  static const unsigned kDefaultNumWorkers = 2;
+  static const uint64_t kDefaultMaxBytes = 128 * 1024 * 1024;  // 128MB
+
+  ChunkPrefetcher(Fetcher *fetcher,
+                  Fetcher *external_fetcher,
+                  const unsigned max_window,
+                  const unsigned num_workers,
+                  const uint64_t max_bytes,
+                  perf::StatisticsTemplate statistics);
+  ~ChunkPrefetcher();
+
+  void Spawn();
+
+  /**
+   * Called by the reader whenever the file descriptor of a chunk handle is
+   * moved to a different chunk.  The chunk list is copied as needed, it does
+   * not need to survive the call.
+   */
+  void OnChunkAccess(const uint64_t handle,
+                     const FileChunkReflist &chunks,
+                     const unsigned chunk_idx,
+                     const CacheManager::ObjectType object_type);
+  /**
+   * Called when a chunk handle is closed.
+   */
+  void Forget(const uint64_t handle);
+
+  unsigned max_window() const { return max_window_; }
+  uint64_t bytes_scheduled() {
+    MutexLockGuard m(&lock_);
+    return bytes_scheduled_;
+  }
+
+ private:
+  /**
+   * Per chunk handle access pattern.  Chunks in [next_idx, prefetch_idx) have
+   * been scheduled but not yet been used by the reader.
+   */
+  struct HandleState {
+    HandleState() : next_idx(0), prefetch_idx(0), window(0) { }
+    unsigned next_idx;
+    unsigned prefetch_idx;
+    unsigned window;
+  };
+
+  struct Job {
+    Job()
+      : compression_alg(zlib::kZlibDefault)
+      , external_data(false)
+      , object_type(CacheManager::kTypeRegular)
+    { }
+    FileChunk chunk;
+    std::string path;
+    zlib::Algorithms compression_alg;
+    bool external_data;
+    CacheManager::ObjectType object_type;
+  };
+
+  static void *MainWorker(void *data);
+  bool ScheduleUnlocked(const Job &job);
+  void CountWastedUnlocked(const HandleState &state, const unsigned chunk_idx);
+  void ProcessJob(const Job &job);
+
+  Fetcher *fetcher_;
+  Fetcher *external_fetcher_;
+  unsigned max_window_;
+  unsigned num_workers_;
+  uint64_t max_bytes_;
+
+  /**
+   * Protects handles_, jobs_, bytes_scheduled_ and terminate_
+   */
+  pthread_mutex_t lock_;
+  pthread_cond_t cond_jobs_;
+  SmallHashDynamic<uint64_t, HandleState> handles_;
+  std::deque<Job> jobs_;
+  /**
+   * Sum of the chunk sizes of queued jobs and jobs in progress
+   */
+  uint64_t bytes_scheduled_;
+  bool terminate_;
+  std::vector<pthread_t> workers_;
+
+  perf::Counter *n_scheduled_;
+  perf::Counter *n_hits_;
+  perf::Counter *n_wasted_;
+  perf::Counter *n_failed_;
+  perf::Counter *n_throttled_;
+  perf::Counter *sz_prefetched_;
+};
+
+}  // namespace cvmfs
+
+#endif  // CVMFS_CHUNK_PREFETCH_H_
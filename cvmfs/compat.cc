@@ -171,6 +171,26 @@ void Migrate(InodeTracker *old_tracker, glue::InodeTracker *new_tracker) {
 //------------------------------------------------------------------------------
 
 
+/**
+ * Distributes the entries of an unsharded map of older chunk tables over the
+ * shards of the current chunk tables.  Handle and inode maps are spread by the
+ * same function.
+ */
+template <typename ValueT>
+static void MigrateToShards(
+  const SmallHashDynamic<uint64_t, ValueT> &old_map,
+  SmallHashDynamic<uint64_t, ValueT> (::ChunkTables::Shard::*new_map),
+  ::ChunkTables *new_tables)
+{
+  for (unsigned keyno = 0; keyno < old_map.capacity(); ++keyno) {
+    const uint64_t key = old_map.keys()[keyno];
+    if (key == old_map.empty_key()) continue;
+    (new_tables->Key2Shard(key)->*new_map).Insert(key,
+                                                  old_map.values()[keyno]);
+  }
+}
+
+
 namespace chunk_tables {
 
 ChunkTables::~ChunkTables() {
@@ -184,8 +204,10 @@ ChunkTables::~ChunkTables() {
 
 void Migrate(ChunkTables *old_tables, ::ChunkTables *new_tables) {
   new_tables->next_handle = old_tables->next_handle;
-  new_tables->handle2fd = old_tables->handle2fd;
-  new_tables->inode2references = old_tables->inode2references;
+  MigrateToShards(old_tables->handle2fd, &::ChunkTables::Shard::handle2fd,
+                  new_tables);
+  MigrateToShards(old_tables->inode2references,
+                  &::ChunkTables::Shard::inode2references, new_tables);
 
   SmallHashDynamic<uint64_t, FileChunkReflist> *old_inode2chunks =
     &old_tables->inode2chunks;
@@ -207,7 +229,7 @@ void Migrate(ChunkTables *old_tables, ::ChunkTables *new_tables) {
     delete old_list;
     ::FileChunkReflist new_reflist(new_list, old_reflist->path,
                                    zlib::kZlibDefault, false);
-    new_tables->inode2chunks.Insert(inode, new_reflist);
+    new_tables->Inode2Shard(inode)->inode2chunks.Insert(inode, new_reflist);
   }
 }
 
@@ -230,8 +252,10 @@ ChunkTables::~ChunkTables() {
 
 void Migrate(ChunkTables *old_tables, ::ChunkTables *new_tables) {
   new_tables->next_handle = old_tables->next_handle;
-  new_tables->handle2fd = old_tables->handle2fd;
-  new_tables->inode2references = old_tables->inode2references;
+  MigrateToShards(old_tables->handle2fd, &::ChunkTables::Shard::handle2fd,
+                  new_tables);
+  MigrateToShards(old_tables->inode2references,
+                  &::ChunkTables::Shard::inode2references, new_tables);
 
   SmallHashDynamic<uint64_t, FileChunkReflist> *old_inode2chunks =
     &old_tables->inode2chunks;
@@ -253,7 +277,7 @@ void Migrate(ChunkTables *old_tables, ::ChunkTables *new_tables) {
     delete old_list;
     ::FileChunkReflist new_reflist(new_list, old_reflist->path,
                                    zlib::kZlibDefault, false);
-    new_tables->inode2chunks.Insert(inode, new_reflist);
+    new_tables->Inode2Shard(inode)->inode2chunks.Insert(inode, new_reflist);
   }
 }
 
@@ -276,11 +300,43 @@ ChunkTables::~ChunkTables() {
 
 void Migrate(ChunkTables *old_tables, ::ChunkTables *new_tables) {
   new_tables->next_handle = old_tables->next_handle;
-  new_tables->handle2fd = old_tables->handle2fd;
-  new_tables->inode2chunks = old_tables->inode2chunks;
-  new_tables->inode2references = old_tables->inode2references;
+  MigrateToShards(old_tables->handle2fd, &::ChunkTables::Shard::handle2fd,
+                  new_tables);
+  MigrateToShards(old_tables->inode2chunks,
+                  &::ChunkTables::Shard::inode2chunks, new_tables);
+  MigrateToShards(old_tables->inode2references,
+                  &::ChunkTables::Shard::inode2references, new_tables);
 }
 
 }  // namespace chunk_tables_v3
 
+
+//------------------------------------------------------------------------------
+
+
+namespace chunk_tables_v4 {
+
+ChunkTables::~ChunkTables() {
+  pthread_mutex_destroy(lock);
+  free(lock);
+  for (unsigned i = 0; i < kNumHandleLocks; ++i) {
+    pthread_mutex_destroy(handle_locks.At(i));
+    free(handle_locks.At(i));
+  }
+}
+
+void Migrate(ChunkTables *old_tables, ::ChunkTables *new_tables) {
+  new_tables->next_handle = old_tables->next_handle;
+  MigrateToShards(old_tables->handle2uniqino,
+                  &::ChunkTables::Shard::handle2uniqino, new_tables);
+  MigrateToShards(old_tables->handle2fd, &::ChunkTables::Shard::handle2fd,
+                  new_tables);
+  MigrateToShards(old_tables->inode2chunks,
+                  &::ChunkTables::Shard::inode2chunks, new_tables);
+  MigrateToShards(old_tables->inode2references,
+                  &::ChunkTables::Shard::inode2references, new_tables);
+}
+
+}  // namespace chunk_tables_v4
+
 }  // namespace compat
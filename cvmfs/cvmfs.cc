@@ -71,6 +71,7 @@
 #include "backoff.h"
 #include "cache.h"
 #include "catalog_mgr_client.h"
+#include "chunk_prefetch.h"
 #include "clientctx.h"
 #include "compat.h"
 #include "compression.h"
@@ -1006,9 +1007,10 @@ static void cvmfs_open(fuse_req_t req, fuse_ino_t ino,
     const uint64_t unique_inode = dirent_origin.inode();
 
     ChunkTables *chunk_tables = mount_point_->chunk_tables();
-    chunk_tables->Lock();
-    if (!chunk_tables->inode2chunks.Contains(unique_inode)) {
-      chunk_tables->Unlock();
+    ChunkTables::Shard *inode_shard = chunk_tables->Inode2Shard(unique_inode);
+    inode_shard->Lock();
+    if (!inode_shard->inode2chunks.Contains(unique_inode)) {
+      inode_shard->Unlock();
 
       // Retrieve File chunks from the catalog
       UniquePtr<FileChunkList> chunks(new FileChunkList());
@@ -1024,46 +1026,50 @@ static void cvmfs_open(fuse_req_t req, fuse_ino_t ino,
       }
       fuse_remounter_->fence()->Leave();
 
-      chunk_tables->Lock();
+      inode_shard->Lock();
       // Check again to avoid race
-      if (!chunk_tables->inode2chunks.Contains(unique_inode)) {
-        chunk_tables->inode2chunks.Insert(
+      if (!inode_shard->inode2chunks.Contains(unique_inode)) {
+        inode_shard->inode2chunks.Insert(
           unique_inode, FileChunkReflist(chunks.Release(), path,
                                          dirent.compression_algorithm(),
                                          dirent.IsExternalFile()));
-        chunk_tables->inode2references.Insert(unique_inode, 1);
+        inode_shard->inode2references.Insert(unique_inode, 1);
       } else {
         uint32_t refctr;
         bool retval =
-          chunk_tables->inode2references.Lookup(unique_inode, &refctr);
+          inode_shard->inode2references.Lookup(unique_inode, &refctr);
         assert(retval);
-        chunk_tables->inode2references.Insert(unique_inode, refctr+1);
+        inode_shard->inode2references.Insert(unique_inode, refctr+1);
       }
     } else {
       fuse_remounter_->fence()->Leave();
       uint32_t refctr;
       bool retval =
-        chunk_tables->inode2references.Lookup(unique_inode, &refctr);
+        inode_shard->inode2references.Lookup(unique_inode, &refctr);
       assert(retval);
-      chunk_tables->inode2references.Insert(unique_inode, refctr+1);
+      inode_shard->inode2references.Insert(unique_inode, refctr+1);
     }
 
-    // Update the chunk handle list
-    LogCvmfs(kLogCvmfs, kLogDebug,
-             "linking chunk handle %d to unique inode: %" PRIu64,
-             chunk_tables->next_handle, uint64_t(unique_inode));
-    chunk_tables->handle2fd.Insert(chunk_tables->next_handle, ChunkFd());
-    chunk_tables->handle2uniqino.Insert(chunk_tables->next_handle,
-                                        unique_inode);
-
     // Generate artificial content hash as hash over chunk hashes
     // TODO(jblomer): we may want to cache the result in the chunk tables
     FileChunkReflist chunk_reflist;
     bool retval =
-        chunk_tables->inode2chunks.Lookup(unique_inode, &chunk_reflist);
+        inode_shard->inode2chunks.Lookup(unique_inode, &chunk_reflist);
     assert(retval);
+    inode_shard->Unlock();
 
-    fi->fh = chunk_tables->next_handle;
+    // Update the chunk handle list
+    const uint64_t chunk_handle = chunk_tables->NextHandle();
+    LogCvmfs(kLogCvmfs, kLogDebug,
+             "linking chunk handle %" PRIu64 " to unique inode: %" PRIu64,
+             chunk_handle, uint64_t(unique_inode));
+    ChunkTables::Shard *handle_shard = chunk_tables->Handle2Shard(chunk_handle);
+    handle_shard->Lock();
+    handle_shard->handle2fd.Insert(chunk_handle, ChunkFd());
+    handle_shard->handle2uniqino.Insert(chunk_handle, unique_inode);
+    handle_shard->Unlock();
+
+    fi->fh = chunk_handle;
     if (dirent.IsDirectIo()) {
       open_directives = mount_point_->page_cache_tracker()->OpenDirect();
     } else {
@@ -1072,8 +1078,6 @@ static void cvmfs_open(fuse_req_t req, fuse_ino_t ino,
     }
     FillOpenFlags(open_directives, fi);
     fi->fh = static_cast<uint64_t>(-static_cast<int64_t>(fi->fh));
-    ++chunk_tables->next_handle;
-    chunk_tables->Unlock();
 
     fuse_reply_open(req, fi);
     return;
@@ -1126,6 +1130,38 @@ static void cvmfs_open(fuse_req_t req, fuse_ino_t ino,
 }
 
 
+/**
+ * Replies to a read request by handing the cache file descriptor to libfuse,
+ * which splices the data into the fuse device without copying it through
+ * user space.  Returns false if splicing is disabled or if the cache manager
+ * cannot provide a plain file descriptor for fd.  In this case nothing has
+ * been sent and the caller falls back to Pread() and fuse_reply_buf().
+ */
+static bool ReplyFromSpliceFd(fuse_req_t req, int fd, size_t size, off_t off) {
+#if (FUSE_VERSION >= 29)
+  if (!mount_point_->fuse_splice())
+    return false;
+  const int splice_fd = file_system_->cache_mgr()->GetSpliceFd(fd);
+  if (splice_fd < 0)
+    return false;
+
+  struct fuse_bufvec bufvec = FUSE_BUFVEC_INIT(size);
+  bufvec.buf[0].flags =
+    static_cast<fuse_buf_flags>(FUSE_BUF_IS_FD | FUSE_BUF_FD_SEEK);
+  bufvec.buf[0].fd = splice_fd;
+  bufvec.buf[0].pos = off;
+  // Read errors and short reads at the end of the file are handled by libfuse
+  int retval =
+    fuse_reply_data(req, &bufvec, static_cast<fuse_buf_copy_flags>(0));
+  LogCvmfs(kLogCvmfs, kLogDebug, "spliced up to %u bytes from fd %d (%d)",
+           size, splice_fd, retval);
+  return true;
+#else
+  return false;
+#endif
+}
+
+
 /**
  * Redirected to pread into cache.
  */
@@ -1162,25 +1198,29 @@ static void cvmfs_read(fuse_req_t req, fuse_ino_t ino, size_t size, off_t off,
 
     // Fetch unique inode, chunk list and file descriptor
     ChunkTables *chunk_tables = mount_point_->chunk_tables();
-    chunk_tables->Lock();
-    retval = chunk_tables->handle2uniqino.Lookup(chunk_handle, &unique_inode);
+    ChunkTables::Shard *handle_shard = chunk_tables->Handle2Shard(chunk_handle);
+    handle_shard->Lock();
+    retval = handle_shard->handle2uniqino.Lookup(chunk_handle, &unique_inode);
+    handle_shard->Unlock();
     if (!retval) {
       LogCvmfs(kLogCvmfs, kLogDebug, "no unique inode, fall back to fuse ino");
       unique_inode = ino;
     }
-    retval = chunk_tables->inode2chunks.Lookup(unique_inode, &chunks);
+    ChunkTables::Shard *inode_shard = chunk_tables->Inode2Shard(unique_inode);
+    inode_shard->Lock();
+    retval = inode_shard->inode2chunks.Lookup(unique_inode, &chunks);
     assert(retval);
-    chunk_tables->Unlock();
+    inode_shard->Unlock();
 
     unsigned chunk_idx = chunks.FindChunkIdx(off);
 
     // Lock chunk handle
     pthread_mutex_t *handle_lock = chunk_tables->Handle2Lock(chunk_handle);
     MutexLockGuard m(handle_lock);
-    chunk_tables->Lock();
-    retval = chunk_tables->handle2fd.Lookup(chunk_handle, &chunk_fd);
+    handle_shard->Lock();
+    retval = handle_shard->handle2fd.Lookup(chunk_handle, &chunk_fd);
     assert(retval);
-    chunk_tables->Unlock();
+    handle_shard->Unlock();
 
     // Fetch all needed chunks and read the requested data
     off_t offset_in_chunk = off - chunks.list->AtPtr(chunk_idx)->offset();
@@ -1188,6 +1228,15 @@ static void cvmfs_read(fuse_req_t req, fuse_ino_t ino, size_t size, off_t off,
       // Open file descriptor to chunk
       if ((chunk_fd.fd == -1) || (chunk_fd.chunk_idx != chunk_idx)) {
         if (chunk_fd.fd != -1) file_system_->cache_mgr()->Close(chunk_fd.fd);
+        const CacheManager::ObjectType object_type =
+          mount_point_->catalog_mgr()->volatile_flag()
+            ? CacheManager::kTypeVolatile
+            : CacheManager::kTypeRegular;
+        // Schedule the readahead before blocking on the current chunk
+        if (mount_point_->chunk_prefetcher() != NULL) {
+          mount_point_->chunk_prefetcher()->OnChunkAccess(
+            chunk_handle, chunks, chunk_idx, object_type);
+        }
         string verbose_path = "Part of " + chunks.path.ToString();
         if (chunks.external_data) {
           chunk_fd.fd = mount_point_->external_fetcher()->Fetch(
@@ -1195,9 +1244,7 @@ static void cvmfs_read(fuse_req_t req, fuse_ino_t ino, size_t size, off_t off,
             chunks.list->AtPtr(chunk_idx)->size(),
             verbose_path,
             chunks.compression_alg,
-            mount_point_->catalog_mgr()->volatile_flag()
-              ? CacheManager::kTypeVolatile
-              : CacheManager::kTypeRegular,
+            object_type,
             chunks.path.ToString(),
             chunks.list->AtPtr(chunk_idx)->offset());
         } else {
@@ -1206,15 +1253,13 @@ static void cvmfs_read(fuse_req_t req, fuse_ino_t ino, size_t size, off_t off,
             chunks.list->AtPtr(chunk_idx)->size(),
             verbose_path,
             chunks.compression_alg,
-            mount_point_->catalog_mgr()->volatile_flag()
-              ? CacheManager::kTypeVolatile
-              : CacheManager::kTypeRegular);
+            object_type);
         }
         if (chunk_fd.fd < 0) {
           chunk_fd.fd = -1;
-          chunk_tables->Lock();
-          chunk_tables->handle2fd.Insert(chunk_handle, chunk_fd);
-          chunk_tables->Unlock();
+          handle_shard->Lock();
+          handle_shard->handle2fd.Insert(chunk_handle, chunk_fd);
+          handle_shard->Unlock();
           fuse_reply_err(req, EIO);
           return;
         }
@@ -1229,6 +1274,21 @@ static void cvmfs_read(fuse_req_t req, fuse_ino_t ino, size_t size, off_t off,
         chunks.list->AtPtr(chunk_idx)->size() - offset_in_chunk;
       size_t bytes_to_read_in_chunk =
         std::min(bytes_to_read, remaining_bytes_in_chunk);
+      // Zero-copy reply if the request does not cross a chunk boundary
+      if (mount_point_->fuse_splice() && (overall_bytes_fetched == 0) &&
+          ((bytes_to_read_in_chunk == size) ||
+           (chunk_idx + 1 == chunks.list->size())))
+      {
+        handle_shard->Lock();
+        handle_shard->handle2fd.Insert(chunk_handle, chunk_fd);
+        handle_shard->Unlock();
+        // Still holding the handle lock, so chunk_fd.fd stays open
+        if (ReplyFromSpliceFd(req, chunk_fd.fd, bytes_to_read_in_chunk,
+                              offset_in_chunk))
+        {
+          return;
+        }
+      }
       const int64_t bytes_fetched = file_system_->cache_mgr()->Pread(
         chunk_fd.fd,
         data + overall_bytes_fetched,
@@ -1238,9 +1298,9 @@ static void cvmfs_read(fuse_req_t req, fuse_ino_t ino, size_t size, off_t off,
       if (bytes_fetched < 0) {
         LogCvmfs(kLogCvmfs, kLogSyslogErr, "read err no %" PRId64 " (%s)",
                  bytes_fetched, chunks.path.ToString().c_str());
-        chunk_tables->Lock();
-        chunk_tables->handle2fd.Insert(chunk_handle, chunk_fd);
-        chunk_tables->Unlock();
+        handle_shard->Lock();
+        handle_shard->handle2fd.Insert(chunk_handle, chunk_fd);
+        handle_shard->Unlock();
         fuse_reply_err(req, -bytes_fetched);
         return;
       }
@@ -1253,12 +1313,14 @@ static void cvmfs_read(fuse_req_t req, fuse_ino_t ino, size_t size, off_t off,
              (chunk_idx < chunks.list->size()));
 
     // Update chunk file descriptor
-    chunk_tables->Lock();
-    chunk_tables->handle2fd.Insert(chunk_handle, chunk_fd);
-    chunk_tables->Unlock();
+    handle_shard->Lock();
+    handle_shard->handle2fd.Insert(chunk_handle, chunk_fd);
+    handle_shard->Unlock();
     LogCvmfs(kLogCvmfs, kLogDebug, "released chunk file descriptor %d",
              chunk_fd.fd);
   } else {
+    if (ReplyFromSpliceFd(req, abs_fd, size, off))
+      return;
     int64_t nbytes = file_system_->cache_mgr()->Pread(abs_fd, data, size, off);
     if (nbytes < 0) {
       fuse_reply_err(req, -nbytes);
@@ -1303,37 +1365,43 @@ static void cvmfs_release(fuse_req_t req, fuse_ino_t ino,
     bool retval;
 
     ChunkTables *chunk_tables = mount_point_->chunk_tables();
-    chunk_tables->Lock();
-    retval = chunk_tables->handle2uniqino.Lookup(chunk_handle, &unique_inode);
+    ChunkTables::Shard *handle_shard = chunk_tables->Handle2Shard(chunk_handle);
+    handle_shard->Lock();
+    retval = handle_shard->handle2uniqino.Lookup(chunk_handle, &unique_inode);
     if (!retval) {
       LogCvmfs(kLogCvmfs, kLogDebug, "no unique inode, fall back to fuse ino");
       unique_inode = ino;
     } else {
-      chunk_tables->handle2uniqino.Erase(chunk_handle);
+      handle_shard->handle2uniqino.Erase(chunk_handle);
     }
-    retval = chunk_tables->handle2fd.Lookup(chunk_handle, &chunk_fd);
+    retval = handle_shard->handle2fd.Lookup(chunk_handle, &chunk_fd);
     assert(retval);
-    chunk_tables->handle2fd.Erase(chunk_handle);
+    handle_shard->handle2fd.Erase(chunk_handle);
+    handle_shard->Unlock();
 
-    retval = chunk_tables->inode2references.Lookup(unique_inode, &refctr);
+    ChunkTables::Shard *inode_shard = chunk_tables->Inode2Shard(unique_inode);
+    inode_shard->Lock();
+    retval = inode_shard->inode2references.Lookup(unique_inode, &refctr);
     assert(retval);
     refctr--;
     if (refctr == 0) {
       LogCvmfs(kLogCvmfs, kLogDebug, "releasing chunk list for inode %" PRIu64,
                uint64_t(unique_inode));
       FileChunkReflist to_delete;
-      retval = chunk_tables->inode2chunks.Lookup(unique_inode, &to_delete);
+      retval = inode_shard->inode2chunks.Lookup(unique_inode, &to_delete);
       assert(retval);
-      chunk_tables->inode2references.Erase(unique_inode);
-      chunk_tables->inode2chunks.Erase(unique_inode);
+      inode_shard->inode2references.Erase(unique_inode);
+      inode_shard->inode2chunks.Erase(unique_inode);
       delete to_delete.list;
     } else {
-      chunk_tables->inode2references.Insert(unique_inode, refctr);
+      inode_shard->inode2references.Insert(unique_inode, refctr);
     }
-    chunk_tables->Unlock();
+    inode_shard->Unlock();
 
     if (chunk_fd.fd != -1)
       file_system_->cache_mgr()->Close(chunk_fd.fd);
+    if (mount_point_->chunk_prefetcher() != NULL)
+      mount_point_->chunk_prefetcher()->Forget(chunk_handle);
     perf::Dec(file_system_->no_open_files());
   } else {
     if (file_system_->cache_mgr()->Close(abs_fd) == 0) {
@@ -1619,6 +1687,15 @@ static void cvmfs_init(void *userdata, struct fuse_conn_info *conn) {
   conn->want |= FUSE_CAP_EXPORT_SUPPORT;
 #endif
 
+#ifdef FUSE_CAP_SPLICE_WRITE
+  if (mount_point_->fuse_splice() &&
+      (conn->capable & FUSE_CAP_SPLICE_WRITE))
+  {
+    conn->want |= FUSE_CAP_SPLICE_WRITE;
+    LogCvmfs(kLogCvmfs, kLogDebug, "splicing read replies");
+  }
+#endif
+
   if (mount_point_->enforce_acls()) {
 #ifdef FUSE_CAP_POSIX_ACL
     if ((conn->capable & FUSE_CAP_POSIX_ACL) == 0) {
@@ -1968,6 +2045,8 @@ static void Spawn() {
 
   cvmfs::mount_point_->download_mgr()->Spawn();
   cvmfs::mount_point_->external_download_mgr()->Spawn();
+  if (cvmfs::mount_point_->chunk_prefetcher() != NULL)
+    cvmfs::mount_point_->chunk_prefetcher()->Spawn();
   if (cvmfs::mount_point_->resolv_conf_watcher() != NULL)
     cvmfs::mount_point_->resolv_conf_watcher()->Spawn();
   QuotaManager *quota_mgr = cvmfs::file_system_->cache_mgr()->quota_mgr();
@@ -2139,7 +2218,7 @@ static bool SaveState(const int fd_progress, loader::StateList *saved_states) {
   ChunkTables *saved_chunk_tables = new ChunkTables(
     *cvmfs::mount_point_->chunk_tables());
   loader::SavedState *state_chunk_tables = new loader::SavedState();
-  state_chunk_tables->state_id = loader::kStateOpenChunksV4;
+  state_chunk_tables->state_id = loader::kStateOpenChunksV5;
   state_chunk_tables->state = saved_chunk_tables;
   saved_states->push_back(state_chunk_tables);
 
@@ -2263,33 +2342,42 @@ static bool RestoreState(const int fd_progress,
     ChunkTables *chunk_tables = cvmfs::mount_point_->chunk_tables();
 
     if (saved_states[i]->state_id == loader::kStateOpenChunks) {
-      SendMsg2Socket(fd_progress, "Migrating chunk tables (v1 to v4)... ");
+      SendMsg2Socket(fd_progress, "Migrating chunk tables (v1 to v5)... ");
       compat::chunk_tables::ChunkTables *saved_chunk_tables =
         (compat::chunk_tables::ChunkTables *)saved_states[i]->state;
       compat::chunk_tables::Migrate(saved_chunk_tables, chunk_tables);
       SendMsg2Socket(fd_progress,
-        StringifyInt(chunk_tables->handle2fd.size()) + " handles\n");
+        StringifyInt(chunk_tables->NumHandles()) + " handles\n");
     }
 
     if (saved_states[i]->state_id == loader::kStateOpenChunksV2) {
-      SendMsg2Socket(fd_progress, "Migrating chunk tables (v2 to v4)... ");
+      SendMsg2Socket(fd_progress, "Migrating chunk tables (v2 to v5)... ");
       compat::chunk_tables_v2::ChunkTables *saved_chunk_tables =
         (compat::chunk_tables_v2::ChunkTables *)saved_states[i]->state;
       compat::chunk_tables_v2::Migrate(saved_chunk_tables, chunk_tables);
       SendMsg2Socket(fd_progress,
-        StringifyInt(chunk_tables->handle2fd.size()) + " handles\n");
+        StringifyInt(chunk_tables->NumHandles()) + " handles\n");
     }
 
     if (saved_states[i]->state_id == loader::kStateOpenChunksV3) {
-      SendMsg2Socket(fd_progress, "Migrating chunk tables (v3 to v4)... ");
+      SendMsg2Socket(fd_progress, "Migrating chunk tables (v3 to v5)... ");
       compat::chunk_tables_v3::ChunkTables *saved_chunk_tables =
         (compat::chunk_tables_v3::ChunkTables *)saved_states[i]->state;
       compat::chunk_tables_v3::Migrate(saved_chunk_tables, chunk_tables);
       SendMsg2Socket(fd_progress,
-        StringifyInt(chunk_tables->handle2fd.size()) + " handles\n");
+        StringifyInt(chunk_tables->NumHandles()) + " handles\n");
     }
 
     if (saved_states[i]->state_id == loader::kStateOpenChunksV4) {
+      SendMsg2Socket(fd_progress, "Migrating chunk tables (v4 to v5)... ");
+      compat::chunk_tables_v4::ChunkTables *saved_chunk_tables =
+        (compat::chunk_tables_v4::ChunkTables *)saved_states[i]->state;
+      compat::chunk_tables_v4::Migrate(saved_chunk_tables, chunk_tables);
+      SendMsg2Socket(fd_progress,
+        StringifyInt(chunk_tables->NumHandles()) + " handles\n");
+    }
+
+    if (saved_states[i]->state_id == loader::kStateOpenChunksV5) {
       SendMsg2Socket(fd_progress, "Restoring chunk tables... ");
       chunk_tables->~ChunkTables();
       ChunkTables *saved_chunk_tables = reinterpret_cast<ChunkTables *>(
@@ -2397,6 +2485,11 @@ static void FreeSavedState(const int fd_progress,
           saved_states[i]->state);
         break;
       case loader::kStateOpenChunksV4:
+        SendMsg2Socket(fd_progress, "Releasing chunk tables (version 4)\n");
+        delete static_cast<compat::chunk_tables_v4::ChunkTables *>(
+          saved_states[i]->state);
+        break;
+      case loader::kStateOpenChunksV5:
         SendMsg2Socket(fd_progress, "Releasing chunk tables\n");
         delete static_cast<ChunkTables *>(saved_states[i]->state);
         break;
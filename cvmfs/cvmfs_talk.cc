@@ -155,6 +155,7 @@ static void Usage(const std::string &exe) {
     "  cache list             gets files in cache                      \n"
     "  cache list pinned      gets pinned file catalogs in cache       \n"
     "  cache list catalogs    gets all file catalogs in cache          \n"
+    "  cache rebuild          progress of the last cache db rebuild    \n"
     "  cleanup <MB>           cleans file cache until size <= <MB>     \n"
     "  cleanup rate <period>  n.o. cleanups in the last <period> min   \n"
     "  evict <path>           removes <path> from the cache            \n"
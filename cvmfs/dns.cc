@@ -906,7 +906,7 @@ void CaresResolver::DoResolve(
 
 bool CaresResolver::SetResolvers(const vector<string> &resolvers) {
   string address_list = JoinStrings(resolvers, ",");
-  int retval = ares_set_servers_csv(*channel_, address_list.c_str());
+  int retval = ares_set_servers_ports_csv(*channel_, address_list.c_str());
   if (retval != ARES_SUCCESS)
     return false;
 
@@ -43,9 +43,11 @@
 
 #include <algorithm>
 #include <cassert>
+#include <climits>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <deque>
 #include <map>
 #include <set>
 #include <utility>
@@ -56,6 +58,8 @@
 #include "hash.h"
 #include "interrupt.h"
 #include "logging.h"
+#include "murmur.hxx"
+#include "platform.h"
 #include "prng.h"
 #include "sanitizer.h"
 #include "smalloc.h"
@@ -189,13 +193,17 @@ static size_t CallbackCurlHeader(void *ptr, size_t size, size_t nmemb,
   // LogCvmfs(kLogDownload, kLogDebug, "REMOVE-ME: Header callback with %s",
   //          header_line.c_str());
 
-  // Check http status codes
-  if (HasPrefix(header_line, "HTTP/1.", false)) {
-    if (header_line.length() < 10)
+  // Check http status codes, "HTTP/1.1 200 OK" or "HTTP/2 200"
+  if (HasPrefix(header_line, "HTTP/1.", false) ||
+      HasPrefix(header_line, "HTTP/2", false))
+  {
+    const size_t version_end = header_line.find(' ');
+    if ((version_end == string::npos) || (header_line.length() < 10))
       return 0;
 
     unsigned i;
-    for (i = 8; (i < header_line.length()) && (header_line[i] == ' '); ++i) {}
+    for (i = version_end; (i < header_line.length()) && (header_line[i] == ' ');
+         ++i) {}
 
     // Code is initialized to -1
     if (header_line.length() > i+2) {
@@ -203,6 +211,16 @@ static size_t CallbackCurlHeader(void *ptr, size_t size, size_t nmemb,
     }
 
     if ((info->http_code / 100) == 2) {
+      if ((info->range_offset != -1) && info->range_size &&
+          (info->http_code != 206))
+      {
+        // The server or proxy ignored the range request and sends the
+        // entire object
+        LogCvmfs(kLogDownload, kLogDebug, "range request ignored: %s",
+                 header_line.c_str());
+        info->error_code = kFailTooBig;
+        return 0;
+      }
       return num_bytes;
     } else if ((info->http_code == 301) ||
                (info->http_code == 302) ||
@@ -282,21 +300,25 @@ static size_t CallbackCurlHeader(void *ptr, size_t size, size_t nmemb,
 
 
 /**
- * Called by curl for every received data chunk.
+ * Pre-warming requests only establish the connection, their reply is dropped.
  */
-static size_t CallbackCurlData(void *ptr, size_t size, size_t nmemb,
-                               void *info_link)
+static size_t CallbackCurlDiscard(void *ptr, size_t size, size_t nmemb,
+                                  void *info_link)
 {
-  const size_t num_bytes = size*nmemb;
-  JobInfo *info = static_cast<JobInfo *>(info_link);
-
-  // LogCvmfs(kLogDownload, kLogDebug, "Data callback,  %d bytes", num_bytes);
+  return size*nmemb;
+}
 
-  if (num_bytes == 0)
-    return 0;
 
+/**
+ * Hashes the received data and writes it to the destination of the transfer.
+ * Runs in the I/O thread or, for transfers with a pipeline, in the pipeline
+ * worker of the transfer.
+ */
+static Failures ConsumeData(const void *ptr, const size_t num_bytes,
+                            JobInfo *info)
+{
   if (info->expected_hash) {
-    shash::Update(reinterpret_cast<unsigned char *>(ptr),
+    shash::Update(reinterpret_cast<const unsigned char *>(ptr),
                   num_bytes, info->hash_context);
   }
 
@@ -308,21 +330,18 @@ static size_t CallbackCurlData(void *ptr, size_t size, size_t nmemb,
       if (retval == zlib::kStreamDataError) {
         LogCvmfs(kLogDownload, kLogSyslogErr, "failed to decompress %s",
                  info->url->c_str());
-        info->error_code = kFailBadData;
-        return 0;
+        return kFailBadData;
       } else if (retval == zlib::kStreamIOError) {
         LogCvmfs(kLogDownload, kLogSyslogErr,
                  "decompressing %s, local IO error", info->url->c_str());
-        info->error_code = kFailLocalIO;
-        return 0;
+        return kFailLocalIO;
       }
     } else {
       int64_t written = info->destination_sink->Write(ptr, num_bytes);
       if ((written < 0) || (static_cast<uint64_t>(written) != num_bytes)) {
         LogCvmfs(kLogDownload, kLogDebug, "Failed to perform write on %s (%"
                  PRId64 ")", info->url->c_str(), written);
-        info->error_code = kFailLocalIO;
-        return 0;
+        return kFailLocalIO;
       }
     }
   } else if (info->destination == kDestinationMem) {
@@ -339,8 +358,7 @@ static size_t CallbackCurlData(void *ptr, size_t size, size_t nmemb,
                  num_bytes,
                  info->destination_mem.size);
       }
-      info->error_code = kFailBadData;
-      return 0;
+      return kFailBadData;
     }
     memcpy(info->destination_mem.data + info->destination_mem.pos,
            ptr, num_bytes);
@@ -356,25 +374,58 @@ static size_t CallbackCurlData(void *ptr, size_t size, size_t nmemb,
       if (retval == zlib::kStreamDataError) {
         LogCvmfs(kLogDownload, kLogSyslogErr, "failed to decompress %s",
                  info->url->c_str());
-        info->error_code = kFailBadData;
-        return 0;
+        return kFailBadData;
       } else if (retval == zlib::kStreamIOError) {
         LogCvmfs(kLogDownload, kLogSyslogErr,
                  "decompressing %s, local IO error", info->url->c_str());
-        info->error_code = kFailLocalIO;
-        return 0;
+        return kFailLocalIO;
       }
     } else {
       if (fwrite(ptr, 1, num_bytes, info->destination_file) != num_bytes) {
        LogCvmfs(kLogDownload, kLogSyslogErr,
                  "downloading %s, IO failure: %s (errno=%d)",
                  info->url->c_str(), strerror(errno), errno);
-        info->error_code = kFailLocalIO;
-        return 0;
+        return kFailLocalIO;
       }
     }
   }
 
+  return kFailOk;
+}
+
+
+/**
+ * Called by curl for every received data chunk.  For transfers with a
+ * pipeline, only a copy of the data is queued for the pipeline worker.
+ */
+static size_t CallbackCurlData(void *ptr, size_t size, size_t nmemb,
+                               void *info_link)
+{
+  const size_t num_bytes = size*nmemb;
+  JobInfo *info = static_cast<JobInfo *>(info_link);
+
+  // LogCvmfs(kLogDownload, kLogDebug, "Data callback,  %d bytes", num_bytes);
+
+  if (num_bytes == 0)
+    return 0;
+
+  if (info->pipeline != NULL) {
+    const int32_t pipeline_error = atomic_read32(&info->pipeline_error);
+    if (pipeline_error != kFailOk) {
+      info->error_code = static_cast<Failures>(pipeline_error);
+      return 0;
+    }
+    unsigned char *data = static_cast<unsigned char *>(smalloc(num_bytes));
+    memcpy(data, ptr, num_bytes);
+    info->pipeline->Dispatch(new PipelineBlock(info, data, num_bytes, NULL));
+    return num_bytes;
+  }
+
+  const Failures result = ConsumeData(ptr, num_bytes, info);
+  if (result != kFailOk) {
+    info->error_code = result;
+    return 0;
+  }
   return num_bytes;
 }
 
@@ -426,61 +477,62 @@ int DownloadManager::CallbackCurlSocket(CURL * /* easy */,
 {
   // LogCvmfs(kLogDownload, kLogDebug, "CallbackCurlSocket called with easy "
   //          "handle %p, socket %d, action %d", easy, s, action);
-  DownloadManager *download_mgr = static_cast<DownloadManager *>(userp);
+  IoThread *io_thread = static_cast<IoThread *>(userp);
   if (action == CURL_POLL_NONE)
     return 0;
 
-  // Find s in watch_fds_
+  // Find s in watch_fds
   unsigned index;
-  for (index = 0; index < download_mgr->watch_fds_inuse_; ++index) {
-    if (download_mgr->watch_fds_[index].fd == s)
+  for (index = 0; index < io_thread->watch_fds_inuse; ++index) {
+    if (io_thread->watch_fds[index].fd == s)
       break;
   }
   // Or create newly
-  if (index == download_mgr->watch_fds_inuse_) {
+  if (index == io_thread->watch_fds_inuse) {
     // Extend array if necessary
-    if (download_mgr->watch_fds_inuse_ == download_mgr->watch_fds_size_)
+    if (io_thread->watch_fds_inuse == io_thread->watch_fds_size)
     {
-      assert(download_mgr->watch_fds_size_ > 0);
-      download_mgr->watch_fds_size_ *= 2;
-      download_mgr->watch_fds_ = static_cast<struct pollfd *>(
-        srealloc(download_mgr->watch_fds_,
-                 download_mgr->watch_fds_size_ * sizeof(struct pollfd)));
+      assert(io_thread->watch_fds_size > 0);
+      io_thread->watch_fds_size *= 2;
+      io_thread->watch_fds = static_cast<struct pollfd *>(
+        srealloc(io_thread->watch_fds,
+                 io_thread->watch_fds_size * sizeof(struct pollfd)));
     }
-    download_mgr->watch_fds_[download_mgr->watch_fds_inuse_].fd = s;
-    download_mgr->watch_fds_[download_mgr->watch_fds_inuse_].events = 0;
-    download_mgr->watch_fds_[download_mgr->watch_fds_inuse_].revents = 0;
-    download_mgr->watch_fds_inuse_++;
+    io_thread->watch_fds[io_thread->watch_fds_inuse].fd = s;
+    io_thread->watch_fds[io_thread->watch_fds_inuse].events = 0;
+    io_thread->watch_fds[io_thread->watch_fds_inuse].revents = 0;
+    io_thread->watch_fds_inuse++;
   }
 
   switch (action) {
     case CURL_POLL_IN:
-      download_mgr->watch_fds_[index].events = POLLIN | POLLPRI;
+      io_thread->watch_fds[index].events = POLLIN | POLLPRI;
       break;
     case CURL_POLL_OUT:
-      download_mgr->watch_fds_[index].events = POLLOUT | POLLWRBAND;
+      io_thread->watch_fds[index].events = POLLOUT | POLLWRBAND;
       break;
     case CURL_POLL_INOUT:
-      download_mgr->watch_fds_[index].events =
+      io_thread->watch_fds[index].events =
         POLLIN | POLLPRI | POLLOUT | POLLWRBAND;
       break;
     case CURL_POLL_REMOVE:
-      if (index < download_mgr->watch_fds_inuse_-1) {
-        download_mgr->watch_fds_[index] =
-          download_mgr->watch_fds_[download_mgr->watch_fds_inuse_-1];
+      if (index < io_thread->watch_fds_inuse-1) {
+        io_thread->watch_fds[index] =
+          io_thread->watch_fds[io_thread->watch_fds_inuse-1];
       }
-      download_mgr->watch_fds_inuse_--;
+      io_thread->watch_fds_inuse--;
       // Shrink array if necessary
-      if ((download_mgr->watch_fds_inuse_ > download_mgr->watch_fds_max_) &&
-          (download_mgr->watch_fds_inuse_ < download_mgr->watch_fds_size_/2))
+      if ((io_thread->watch_fds_inuse >
+           io_thread->download_mgr->watch_fds_max_) &&
+          (io_thread->watch_fds_inuse < io_thread->watch_fds_size/2))
       {
-        download_mgr->watch_fds_size_ /= 2;
-        // LogCvmfs(kLogDownload, kLogDebug, "shrinking watch_fds_ (%d)",
+        io_thread->watch_fds_size /= 2;
+        // LogCvmfs(kLogDownload, kLogDebug, "shrinking watch_fds (%d)",
         //          watch_fds_size_);
-        download_mgr->watch_fds_ = static_cast<struct pollfd *>(
-          srealloc(download_mgr->watch_fds_,
-                   download_mgr->watch_fds_size_*sizeof(struct pollfd)));
-        // LogCvmfs(kLogDownload, kLogDebug, "shrinking watch_fds_ done",
+        io_thread->watch_fds = static_cast<struct pollfd *>(
+          srealloc(io_thread->watch_fds,
+                   io_thread->watch_fds_size*sizeof(struct pollfd)));
+        // LogCvmfs(kLogDownload, kLogDebug, "shrinking watch_fds done",
         //          watch_fds_size_);
       }
       break;
@@ -497,18 +549,22 @@ int DownloadManager::CallbackCurlSocket(CURL * /* easy */,
  */
 void *DownloadManager::MainDownload(void *data) {
   LogCvmfs(kLogDownload, kLogDebug, "download I/O thread started");
-  DownloadManager *download_mgr = static_cast<DownloadManager *>(data);
-
-  download_mgr->watch_fds_ =
-    static_cast<struct pollfd *>(smalloc(2 * sizeof(struct pollfd)));
-  download_mgr->watch_fds_size_ = 2;
-  download_mgr->watch_fds_[0].fd = download_mgr->pipe_terminate_[0];
-  download_mgr->watch_fds_[0].events = POLLIN | POLLPRI;
-  download_mgr->watch_fds_[0].revents = 0;
-  download_mgr->watch_fds_[1].fd = download_mgr->pipe_jobs_[0];
-  download_mgr->watch_fds_[1].events = POLLIN | POLLPRI;
-  download_mgr->watch_fds_[1].revents = 0;
-  download_mgr->watch_fds_inuse_ = 2;
+  IoThread *io_thread = static_cast<IoThread *>(data);
+  DownloadManager *download_mgr = io_thread->download_mgr;
+
+  io_thread->watch_fds =
+    static_cast<struct pollfd *>(smalloc(3 * sizeof(struct pollfd)));
+  io_thread->watch_fds_size = 3;
+  io_thread->watch_fds[0].fd = download_mgr->pipe_terminate_[0];
+  io_thread->watch_fds[0].events = POLLIN | POLLPRI;
+  io_thread->watch_fds[0].revents = 0;
+  io_thread->watch_fds[1].fd = io_thread->pipe_jobs[0];
+  io_thread->watch_fds[1].events = POLLIN | POLLPRI;
+  io_thread->watch_fds[1].revents = 0;
+  io_thread->watch_fds[2].fd = io_thread->pipe_prewarm[0];
+  io_thread->watch_fds[2].events = POLLIN | POLLPRI;
+  io_thread->watch_fds[2].revents = 0;
+  io_thread->watch_fds_inuse = 3;
 
   int still_running = 0;
   struct timeval timeval_start, timeval_stop;
@@ -533,7 +589,7 @@ void *DownloadManager::MainDownload(void *data) {
         1000 * DiffTimeSeconds(timeval_start, timeval_stop));
       perf::Xadd(download_mgr->counters_->sz_transfer_time, delta);
     }
-    int retval = poll(download_mgr->watch_fds_, download_mgr->watch_fds_inuse_,
+    int retval = poll(io_thread->watch_fds, io_thread->watch_fds_inuse,
                       timeout);
     if (retval < 0) {
       continue;
@@ -541,29 +597,49 @@ void *DownloadManager::MainDownload(void *data) {
 
     // Handle timeout
     if (retval == 0) {
-      curl_multi_socket_action(download_mgr->curl_multi_,
+      curl_multi_socket_action(io_thread->curl_multi,
                                CURL_SOCKET_TIMEOUT,
                                0,
                                &still_running);
     }
 
     // Terminate I/O thread
-    if (download_mgr->watch_fds_[0].revents)
+    if (io_thread->watch_fds[0].revents)
       break;
 
     // New job arrives
-    if (download_mgr->watch_fds_[1].revents) {
-      download_mgr->watch_fds_[1].revents = 0;
+    if (io_thread->watch_fds[1].revents) {
+      io_thread->watch_fds[1].revents = 0;
       JobInfo *info;
       // NOLINTNEXTLINE(bugprone-sizeof-expression)
-      ReadPipe(download_mgr->pipe_jobs_[0], &info, sizeof(info));
+      ReadPipe(io_thread->pipe_jobs[0], &info, sizeof(info));
       if (!still_running)
         gettimeofday(&timeval_start, NULL);
-      CURL *handle = download_mgr->AcquireCurlHandle();
+      CURL *handle = download_mgr->AcquireCurlHandle(io_thread);
       download_mgr->InitializeRequest(info, handle);
       download_mgr->SetUrlOptions(info);
-      curl_multi_add_handle(download_mgr->curl_multi_, handle);
-      curl_multi_socket_action(download_mgr->curl_multi_,
+      curl_multi_add_handle(io_thread->curl_multi, handle);
+      if (download_mgr->opt_hedge_percentile_ > 0) {
+        info->start_ms = platform_monotonic_time_ns() / (1000 * 1000);
+        if (download_mgr->IsHedgeCandidate(info))
+          io_thread->hedge_candidates->insert(info);
+      }
+      curl_multi_socket_action(io_thread->curl_multi,
+                               CURL_SOCKET_TIMEOUT,
+                               0,
+                               &still_running);
+    }
+
+    // Pre-warming requested by RequestPrewarmUnlocked(); several requests
+    // collapse into one
+    if (io_thread->watch_fds[2].revents) {
+      io_thread->watch_fds[2].revents = 0;
+      char buf[16];
+      while (read(io_thread->pipe_prewarm[0], buf, sizeof(buf)) > 0) { }
+      if (!still_running)
+        gettimeofday(&timeval_start, NULL);
+      download_mgr->PrewarmConnections(io_thread);
+      curl_multi_socket_action(io_thread->curl_multi,
                                CURL_SOCKET_TIMEOUT,
                                0,
                                &still_running);
@@ -571,56 +647,91 @@ void *DownloadManager::MainDownload(void *data) {
 
     // Activity on curl sockets
     // Within this loop the curl_multi_socket_action() may cause socket(s)
-    // to be removed from watch_fds_. If a socket is removed it is replaced
+    // to be removed from watch_fds. If a socket is removed it is replaced
     // by the socket at the end of the array and the inuse count is decreased.
     // Therefore loop over the array in reverse order.
-    for (int64_t i = download_mgr->watch_fds_inuse_-1; i >= 2; --i) {
-      if (i >= download_mgr->watch_fds_inuse_) {
+    for (int64_t i = io_thread->watch_fds_inuse-1; i >= 3; --i) {
+      if (i >= io_thread->watch_fds_inuse) {
         continue;
       }
-      if (download_mgr->watch_fds_[i].revents) {
+      if (io_thread->watch_fds[i].revents) {
         int ev_bitmask = 0;
-        if (download_mgr->watch_fds_[i].revents & (POLLIN | POLLPRI))
+        if (io_thread->watch_fds[i].revents & (POLLIN | POLLPRI))
           ev_bitmask |= CURL_CSELECT_IN;
-        if (download_mgr->watch_fds_[i].revents & (POLLOUT | POLLWRBAND))
+        if (io_thread->watch_fds[i].revents & (POLLOUT | POLLWRBAND))
           ev_bitmask |= CURL_CSELECT_OUT;
-        if (download_mgr->watch_fds_[i].revents &
+        if (io_thread->watch_fds[i].revents &
             (POLLERR | POLLHUP | POLLNVAL))
         {
           ev_bitmask |= CURL_CSELECT_ERR;
         }
-        download_mgr->watch_fds_[i].revents = 0;
+        io_thread->watch_fds[i].revents = 0;
 
-        curl_multi_socket_action(download_mgr->curl_multi_,
-                                 download_mgr->watch_fds_[i].fd,
+        curl_multi_socket_action(io_thread->curl_multi,
+                                 io_thread->watch_fds[i].fd,
                                  ev_bitmask,
                                  &still_running);
       }
     }
 
+    // Duplicate requests that exceeded the hedging deadline
+    if (!io_thread->hedge_candidates->empty() &&
+        download_mgr->StartHedges(io_thread))
+    {
+      curl_multi_socket_action(io_thread->curl_multi,
+                               CURL_SOCKET_TIMEOUT,
+                               0,
+                               &still_running);
+    }
+
     // Check if transfers are completed
     CURLMsg *curl_msg;
     int msgs_in_queue;
-    while ((curl_msg = curl_multi_info_read(download_mgr->curl_multi_,
+    while ((curl_msg = curl_multi_info_read(io_thread->curl_multi,
                                             &msgs_in_queue)))
     {
       if (curl_msg->msg == CURLMSG_DONE) {
-        perf::Inc(download_mgr->counters_->n_requests);
         JobInfo *info;
         CURL *easy_handle = curl_msg->easy_handle;
         int curl_error = curl_msg->data.result;
         curl_easy_getinfo(easy_handle, CURLINFO_PRIVATE, &info);
 
-        curl_multi_remove_handle(download_mgr->curl_multi_, easy_handle);
+        curl_multi_remove_handle(io_thread->curl_multi, easy_handle);
+        if (info == NULL) {
+          // Pre-warming request, the connection stays in the multi handle
+          download_mgr->UpdateStatistics(easy_handle);
+          io_thread->pool_handles_inuse->erase(easy_handle);
+          curl_easy_cleanup(easy_handle);
+          continue;
+        }
+        if (info->hedge_primary) {
+          // A duplicate request; if it wins, the original one is complete
+          JobInfo *primary = info->hedge_primary;
+          if (download_mgr->FinishHedge(io_thread, info, curl_error)) {
+            download_mgr->ReleaseCurlHandle(io_thread, primary->curl_handle);
+            WritePipe(primary->wait_at[1], &primary->error_code,
+                      sizeof(primary->error_code));
+          }
+          curl_multi_socket_action(io_thread->curl_multi,
+                                   CURL_SOCKET_TIMEOUT,
+                                   0,
+                                   &still_running);
+          continue;
+        }
+        if (info->hedge)
+          download_mgr->CancelHedge(io_thread, info);
+        io_thread->hedge_candidates->erase(info);
+        perf::Inc(download_mgr->counters_->n_requests);
         if (download_mgr->VerifyAndFinalize(curl_error, info)) {
-          curl_multi_add_handle(download_mgr->curl_multi_, easy_handle);
-          curl_multi_socket_action(download_mgr->curl_multi_,
+          curl_multi_add_handle(io_thread->curl_multi, easy_handle);
+          curl_multi_socket_action(io_thread->curl_multi,
                                    CURL_SOCKET_TIMEOUT,
                                    0,
                                    &still_running);
         } else {
+          download_mgr->RecordLatency(info);
           // Return easy handle into pool and write result back
-          download_mgr->ReleaseCurlHandle(easy_handle);
+          download_mgr->ReleaseCurlHandle(io_thread, easy_handle);
 
           WritePipe(info->wait_at[1], &info->error_code,
                     sizeof(info->error_code));
@@ -629,20 +740,86 @@ void *DownloadManager::MainDownload(void *data) {
     }
   }
 
-  for (set<CURL *>::iterator i = download_mgr->pool_handles_inuse_->begin(),
-       iEnd = download_mgr->pool_handles_inuse_->end(); i != iEnd; ++i)
+  for (set<CURL *>::iterator i = io_thread->pool_handles_inuse->begin(),
+       iEnd = io_thread->pool_handles_inuse->end(); i != iEnd; ++i)
   {
-    curl_multi_remove_handle(download_mgr->curl_multi_, *i);
+    curl_multi_remove_handle(io_thread->curl_multi, *i);
     curl_easy_cleanup(*i);
   }
-  download_mgr->pool_handles_inuse_->clear();
-  free(download_mgr->watch_fds_);
+  io_thread->pool_handles_inuse->clear();
+  free(io_thread->watch_fds);
 
   LogCvmfs(kLogDownload, kLogDebug, "download I/O thread terminated");
   return NULL;
 }
 
 
+/**
+ * Resolves the proxy names of the current load-balance group before they
+ * expire or when an I/O thread found an expired name.
+ */
+void *DownloadManager::MainDnsRefresh(void *data) {
+  LogCvmfs(kLogDownload, kLogDebug, "DNS refresh thread started");
+  DownloadManager *download_mgr = static_cast<DownloadManager *>(data);
+
+  struct pollfd watch_fds[2];
+  watch_fds[0].fd = download_mgr->pipe_terminate_[0];
+  watch_fds[0].events = POLLIN | POLLPRI;
+  watch_fds[1].fd = download_mgr->pipe_dns_refresh_[0];
+  watch_fds[1].events = POLLIN | POLLPRI;
+  while (true) {
+    watch_fds[0].revents = watch_fds[1].revents = 0;
+    int retval = poll(watch_fds, 2, download_mgr->GetDnsRefreshTimeoutMs());
+    if (retval < 0)
+      continue;
+    if (watch_fds[0].revents)
+      break;
+    if (watch_fds[1].revents) {
+      char buf;
+      ReadPipe(download_mgr->pipe_dns_refresh_[0], &buf, 1);
+    }
+    download_mgr->RefreshProxyHosts();
+  }
+
+  LogCvmfs(kLogDownload, kLogDebug, "DNS refresh thread terminated");
+  return NULL;
+}
+
+
+/**
+ * Processes the received data of the transfers dispatched to this worker's
+ * tube.  A block without a transfer terminates the worker.
+ */
+void *DownloadManager::MainPipeline(void *data) {
+  LogCvmfs(kLogDownload, kLogDebug, "download pipeline worker started");
+  Tube<PipelineBlock> *tube = static_cast<Tube<PipelineBlock> *>(data);
+
+  while (true) {
+    PipelineBlock *block = tube->PopFront();
+    JobInfo *info = block->info;
+    if (info == NULL) {
+      delete block;
+      break;
+    }
+    if (block->data == NULL) {
+      block->flushed->Wakeup();
+      delete block;
+      continue;
+    }
+    if (atomic_read32(&info->pipeline_error) == kFailOk) {
+      const Failures result = ConsumeData(block->data, block->size, info);
+      if (result != kFailOk)
+        atomic_write32(&info->pipeline_error, result);
+    }
+    free(block->data);
+    delete block;
+  }
+
+  LogCvmfs(kLogDownload, kLogDebug, "download pipeline worker terminated");
+  return NULL;
+}
+
+
 //------------------------------------------------------------------------------
 
 
@@ -785,18 +962,55 @@ string DownloadManager::ProxyInfo::Print() {
   } else {
     result += " (:unresolved:, " + expinfo + ")";
   }
+  if (num_samples > 0) {
+    result += " [rtt " + StringifyInt(static_cast<int64_t>(rtt_ms)) + "ms";
+    if (throughput > 0.0) {
+      result += ", " +
+        StringifyInt(static_cast<int64_t>(throughput / 1024.0)) + "kB/s";
+    }
+    result += "]";
+  }
   return result;
 }
 
 
+void DownloadManager::ProxyInfo::AddSample(
+  const float sample_rtt_ms,
+  const float sample_throughput)
+{
+  const float decay = 1.0 / kProxyEstimateDecay;
+  if (num_samples == 0)
+    rtt_ms = sample_rtt_ms;
+  else
+    rtt_ms += decay * (sample_rtt_ms - rtt_ms);
+  if (sample_throughput > 0.0) {
+    if (throughput == 0.0)
+      throughput = sample_throughput;
+    else
+      throughput += decay * (sample_throughput - throughput);
+  }
+  num_samples++;
+}
+
+
+float DownloadManager::ProxyInfo::EstimateCostMs() const {
+  if (num_samples == 0)
+    return 0.0;
+  float cost = rtt_ms;
+  if (throughput > 0.0)
+    cost += 1000.0 * kProxyCostReferenceSize / throughput;
+  return cost;
+}
+
+
 /**
  * Gets an idle CURL handle from the pool. Creates a new one and adds it to
  * the pool if necessary.
  */
-CURL *DownloadManager::AcquireCurlHandle() {
+CURL *DownloadManager::AcquireCurlHandle(IoThread *io_thread) {
   CURL *handle;
 
-  if (pool_handles_idle_->empty()) {
+  if (io_thread->pool_handles_idle->empty()) {
     // Create a new handle
     handle = curl_easy_init();
     assert(handle != NULL);
@@ -806,27 +1020,108 @@ CURL *DownloadManager::AcquireCurlHandle() {
     curl_easy_setopt(handle, CURLOPT_HEADERFUNCTION, CallbackCurlHeader);
     curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, CallbackCurlData);
   } else {
-    handle = *(pool_handles_idle_->begin());
-    pool_handles_idle_->erase(pool_handles_idle_->begin());
+    handle = *(io_thread->pool_handles_idle->begin());
+    io_thread->pool_handles_idle->erase(io_thread->pool_handles_idle->begin());
   }
 
-  pool_handles_inuse_->insert(handle);
+  io_thread->pool_handles_inuse->insert(handle);
 
   return handle;
 }
 
 
-void DownloadManager::ReleaseCurlHandle(CURL *handle) {
-  set<CURL *>::iterator elem = pool_handles_inuse_->find(handle);
-  assert(elem != pool_handles_inuse_->end());
+void DownloadManager::ReleaseCurlHandle(IoThread *io_thread, CURL *handle) {
+  set<CURL *>::iterator elem = io_thread->pool_handles_inuse->find(handle);
+  assert(elem != io_thread->pool_handles_inuse->end());
 
-  if (pool_handles_idle_->size() > pool_max_handles_) {
+  if (io_thread->pool_handles_idle->size() > pool_max_handles_) {
     curl_easy_cleanup(*elem);
   } else {
-    pool_handles_idle_->insert(*elem);
+    io_thread->pool_handles_idle->insert(*elem);
   }
 
-  pool_handles_inuse_->erase(elem);
+  io_thread->pool_handles_inuse->erase(elem);
+}
+
+
+DownloadManager::IoThread::IoThread()
+  : download_mgr(NULL)
+  , curl_multi(NULL)
+  , pool_handles_idle(NULL)
+  , pool_handles_inuse(NULL)
+  , watch_fds(NULL)
+  , watch_fds_size(0)
+  , watch_fds_inuse(0)
+  , hedge_candidates(NULL)
+{
+  pipe_jobs[0] = pipe_jobs[1] = -1;
+  pipe_prewarm[0] = pipe_prewarm[1] = -1;
+}
+
+
+DownloadManager::IoThread *DownloadManager::CreateIoThread(
+  const unsigned max_connections)
+{
+  IoThread *io_thread = new IoThread();
+  io_thread->download_mgr = this;
+  io_thread->pool_handles_idle = new set<CURL *>;
+  io_thread->pool_handles_inuse = new set<CURL *>;
+  io_thread->hedge_candidates = new set<JobInfo *>;
+  io_thread->curl_multi = curl_multi_init();
+  assert(io_thread->curl_multi != NULL);
+  curl_multi_setopt(io_thread->curl_multi, CURLMOPT_SOCKETFUNCTION,
+                    CallbackCurlSocket);
+  curl_multi_setopt(io_thread->curl_multi, CURLMOPT_SOCKETDATA,
+                    static_cast<void *>(io_thread));
+  curl_multi_setopt(io_thread->curl_multi, CURLMOPT_MAXCONNECTS,
+                    watch_fds_max_);
+  curl_multi_setopt(io_thread->curl_multi, CURLMOPT_MAX_TOTAL_CONNECTIONS,
+                    max_connections);
+  if (opt_multiplex_) {
+    curl_multi_setopt(io_thread->curl_multi, CURLMOPT_PIPELINING,
+                      CURLPIPE_MULTIPLEX);
+  }
+  return io_thread;
+}
+
+
+/**
+ * The I/O thread must not be running anymore.
+ */
+void DownloadManager::DestroyIoThread(IoThread *io_thread) {
+  for (set<CURL *>::iterator i = io_thread->pool_handles_idle->begin(),
+       iEnd = io_thread->pool_handles_idle->end(); i != iEnd; ++i)
+  {
+    curl_easy_cleanup(*i);
+  }
+  delete io_thread->pool_handles_idle;
+  delete io_thread->pool_handles_inuse;
+  delete io_thread->hedge_candidates;
+  curl_multi_cleanup(io_thread->curl_multi);
+  if (io_thread->pipe_jobs[0] >= 0)
+    ClosePipe(io_thread->pipe_jobs);
+  if (io_thread->pipe_prewarm[0] >= 0)
+    ClosePipe(io_thread->pipe_prewarm);
+  delete io_thread;
+}
+
+
+/**
+ * Jobs for the same object always go to the same I/O thread.  Jobs without
+ * an expected hash are spread by their URL.
+ */
+DownloadManager::IoThread *DownloadManager::SelectIoThread(
+  const JobInfo *info)
+{
+  if (io_threads_.size() == 1)
+    return io_threads_[0];
+  uint32_t key;
+  if (info->expected_hash) {
+    key = info->expected_hash->Partial32();
+  } else {
+    key = MurmurHash2(info->url->data(), info->url->length(), 0x07387a4f);
+  }
+  return io_threads_[key % io_threads_.size()];
 }
 
 
@@ -844,9 +1139,12 @@ void DownloadManager::InitializeRequest(JobInfo *info, CURL *handle) {
   info->num_used_hosts = 1;
   info->num_retries = 0;
   info->backoff_ms = 0;
-  info->headers = header_lists_->DuplicateList(default_headers_);
-  if (info->info_header) {
-    header_lists_->AppendHeader(info->headers, info->info_header);
+  {
+    MutexLockGuard m(lock_header_lists_);
+    info->headers = header_lists_->DuplicateList(default_headers_);
+    if (info->info_header) {
+      header_lists_->AppendHeader(info->headers, info->info_header);
+    }
   }
   if (info->force_nocache) {
     SetNocache(info);
@@ -860,6 +1158,11 @@ void DownloadManager::InitializeRequest(JobInfo *info, CURL *handle) {
     assert(info->hash_context.buffer != NULL);
     shash::Init(info->hash_context);
   }
+  info->pipeline = IsPipelineCandidate(info) ? pipeline_ : NULL;
+  if (info->pipeline != NULL) {
+    info->pipeline_tag = atomic_xadd32(&pipeline_next_tag_, 1);
+    atomic_write32(&info->pipeline_error, kFailOk);
+  }
 
   if ((info->range_offset != -1) && (info->range_size)) {
     char byte_range_array[100];
@@ -895,6 +1198,11 @@ void DownloadManager::InitializeRequest(JobInfo *info, CURL *handle) {
     curl_easy_setopt(handle, CURLOPT_FOLLOWLOCATION, 1);
     curl_easy_setopt(handle, CURLOPT_MAXREDIRS, 4);
   }
+  if (opt_multiplex_) {
+    // Rather wait for a connection that can be multiplexed than open a new one
+    curl_easy_setopt(handle, CURLOPT_PIPEWAIT, 1L);
+    curl_easy_setopt(handle, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+  }
 }
 
 
@@ -917,6 +1225,7 @@ void DownloadManager::SetUrlOptions(JobInfo *info) {
       opt_proxy_groups_current_ = 0;
       opt_timestamp_backup_proxies_ = 0;
       RebalanceProxiesUnlocked("reset proxy group");
+      RequestDnsRefreshUnlocked();
     }
   }
   // Check if load-balanced proxies within the group need to be reset
@@ -1060,6 +1369,9 @@ void DownloadManager::SetUrlOptions(JobInfo *info) {
  * the load-balance group on the fly.  In the latter case, also rebalance the
  * proxies.  The options mutex needs to be open.
  *
+ * In multi-threaded mode, an expired host with usable addresses is handed to
+ * the DNS refresh thread and the stale addresses remain in use meanwhile.
+ *
  * Returns true if proxies may have changed.
  */
 bool DownloadManager::ValidateProxyIpsUnlocked(
@@ -1068,11 +1380,38 @@ bool DownloadManager::ValidateProxyIpsUnlocked(
 {
   if (!host.IsExpired())
     return false;
+  if ((host.status() == dns::kFailOk) &&
+      (atomic_read32(&multi_threaded_) == 1))
+  {
+    RequestDnsRefreshUnlocked();
+    return false;
+  }
   LogCvmfs(kLogDownload, kLogDebug, "validate DNS entry for %s",
            host.name().c_str());
 
+  dns::Host new_host;
+  {
+    MutexLockGuard m(lock_resolver_);
+    new_host = resolver_->Resolve(host.name());
+  }
+  return UpdateProxyHostUnlocked(url, host, new_host);
+}
+
+
+/**
+ * Replaces host by the freshly resolved new_host in the current load-balance
+ * group.  If resolving failed, the old addresses are kept for another minimum
+ * TTL.  The options mutex needs to be open.
+ *
+ * Returns true if proxies may have changed.
+ */
+bool DownloadManager::UpdateProxyHostUnlocked(
+  const string &url,
+  const dns::Host &host,
+  const dns::Host &resolved_host)
+{
   unsigned group_idx = opt_proxy_groups_current_;
-  dns::Host new_host = resolver_->Resolve(host.name());
+  dns::Host new_host = resolved_host;
 
   bool update_only = true;  // No changes to the list of IP addresses.
   if (new_host.status() != dns::kFailOk) {
@@ -1123,10 +1462,116 @@ bool DownloadManager::ValidateProxyIpsUnlocked(
 }
 
 
+/**
+ * Wakes up the DNS refresh thread unless a refresh is already pending.  The
+ * refresh thread recomputes its poll timeout on every wake-up, so this needs
+ * to be called whenever the current load-balance group changes.  The options
+ * mutex needs to be open.
+ */
+void DownloadManager::RequestDnsRefreshUnlocked() {
+  if (atomic_read32(&multi_threaded_) == 0)
+    return;
+  if (dns_refresh_requested_)
+    return;
+  dns_refresh_requested_ = true;
+  char buf = 'R';
+  WritePipe(pipe_dns_refresh_[1], &buf, 1);
+}
+
+
+/**
+ * Time until the first proxy name of the current load-balance group enters
+ * its refresh margin, but at least kDnsRefreshMinIntervalMs.  -1 if there is
+ * nothing to resolve.
+ */
+int DownloadManager::GetDnsRefreshTimeoutMs() {
+  MutexLockGuard m(lock_options_);
+  if (!opt_proxy_groups_)
+    return -1;
+  const time_t margin = resolver_->min_ttl() / kDnsRefreshMarginDivisor;
+  vector<ProxyInfo> *group = current_proxy_group();
+  time_t next_refresh = 0;
+  for (unsigned i = 0; i < group->size(); ++i) {
+    if ((*group)[i].url == "DIRECT")
+      continue;
+    const time_t due = (*group)[i].host.deadline() - margin;
+    if ((next_refresh == 0) || (due < next_refresh))
+      next_refresh = due;
+  }
+  if (next_refresh == 0)
+    return -1;
+  const int64_t timeout_ms =
+    1000 * (static_cast<int64_t>(next_refresh) - time(NULL));
+  if (timeout_ms < kDnsRefreshMinIntervalMs)
+    return kDnsRefreshMinIntervalMs;
+  return (timeout_ms > INT_MAX) ? INT_MAX : timeout_ms;
+}
+
+
+/**
+ * If any proxy name of the current load-balance group is due, resolves all of
+ * them in a single batch.  The resolver runs without the options mutex, so
+ * that transfers continue with the old addresses in the meantime.
+ */
+void DownloadManager::RefreshProxyHosts() {
+  vector<string> names;
+  vector<string> urls;
+  vector<dns::Host> old_hosts;
+  {
+    MutexLockGuard m(lock_options_);
+    dns_refresh_requested_ = false;
+    if (!opt_proxy_groups_)
+      return;
+    const time_t margin = resolver_->min_ttl() / kDnsRefreshMarginDivisor;
+    const time_t now = time(NULL);
+    bool is_due = false;
+    vector<ProxyInfo> *group = current_proxy_group();
+    for (unsigned i = 0; i < group->size(); ++i) {
+      const ProxyInfo &proxy = (*group)[i];
+      if ((proxy.url == "DIRECT") ||
+          (find(names.begin(), names.end(), proxy.host.name()) != names.end()))
+      {
+        continue;
+      }
+      names.push_back(proxy.host.name());
+      urls.push_back(proxy.url);
+      old_hosts.push_back(proxy.host);
+      if (proxy.host.deadline() - margin <= now)
+        is_due = true;
+    }
+    if (!is_due)
+      return;
+  }
+
+  LogCvmfs(kLogDownload, kLogDebug, "refreshing %u proxy names", names.size());
+  vector<dns::Host> new_hosts;
+  {
+    MutexLockGuard m(lock_resolver_);
+    resolver_->ResolveMany(names, &new_hosts);
+  }
+  perf::Inc(counters_->n_dns_refresh);
+
+  MutexLockGuard m(lock_options_);
+  for (unsigned i = 0; i < names.size(); ++i) {
+    // The group might have changed while resolving
+    vector<ProxyInfo> *group = current_proxy_group();
+    bool is_current = false;
+    for (unsigned j = 0; j < group->size(); ++j) {
+      if ((*group)[j].host.id() == old_hosts[i].id()) {
+        is_current = true;
+        break;
+      }
+    }
+    if (is_current)
+      UpdateProxyHostUnlocked(urls[i], old_hosts[i], new_hosts[i]);
+  }
+}
+
+
 /**
  * Adds transfer time and downloaded bytes to the global counters.
  */
-void DownloadManager::UpdateStatistics(CURL *handle) {
+void DownloadManager::UpdateStatistics(CURL *handle, const JobInfo *info) {
   double val;
   int retval;
   int64_t sum = 0;
@@ -1138,6 +1583,92 @@ void DownloadManager::UpdateStatistics(CURL *handle) {
   assert(retval == CURLE_OK);
   sum += static_cast<int64_t>(val);*/
   perf::Xadd(counters_->sz_transferred_bytes, sum);
+
+  long num_connects = 0;  // NOLINT(runtime/int)
+  retval = curl_easy_getinfo(handle, CURLINFO_NUM_CONNECTS, &num_connects);
+  assert(retval == CURLE_OK);
+  if (num_connects > 0)
+    perf::Xadd(counters_->n_connections, num_connects);
+  else
+    perf::Inc(counters_->n_connection_reuses);
+  long http_version = 0;  // NOLINT(runtime/int)
+  retval = curl_easy_getinfo(handle, CURLINFO_HTTP_VERSION, &http_version);
+  if ((retval == CURLE_OK) && (http_version == CURL_HTTP_VERSION_2_0))
+    perf::Inc(counters_->n_http2_requests);
+
+  if (info && !info->proxy.empty() && (info->proxy != "DIRECT"))
+    UpdateProxyEstimates(handle, info->proxy);
+}
+
+
+/**
+ * With latency-aware proxy selection, adds the time to the first byte and the
+ * transfer speed of a successful request to the estimates of the proxy that
+ * served it and periodically rebuilds the load-balancing map from the
+ * estimates.  Otherwise, lock_options_ is not taken on the completion path.
+ */
+void DownloadManager::UpdateProxyEstimates(CURL *handle, const string &proxy) {
+  if (!opt_proxy_latency_aware_)
+    return;
+  long http_code = 0;  // NOLINT(runtime/int)
+  int retval = curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &http_code);
+  if ((retval != CURLE_OK) || (http_code < 200) || (http_code >= 300))
+    return;
+  double pretransfer_time = 0.0;
+  double starttransfer_time = 0.0;
+  double total_time = 0.0;
+  double size = 0.0;
+  curl_easy_getinfo(handle, CURLINFO_PRETRANSFER_TIME, &pretransfer_time);
+  curl_easy_getinfo(handle, CURLINFO_STARTTRANSFER_TIME, &starttransfer_time);
+  curl_easy_getinfo(handle, CURLINFO_TOTAL_TIME, &total_time);
+  curl_easy_getinfo(handle, CURLINFO_SIZE_DOWNLOAD, &size);
+  if (starttransfer_time < pretransfer_time)
+    return;
+  const float rtt_ms = 1000.0 * (starttransfer_time - pretransfer_time);
+  float throughput = 0.0;
+  const double transfer_time = total_time - starttransfer_time;
+  if ((size >= kProxyMinThroughputSize) && (transfer_time >= 0.001))
+    throughput = size / transfer_time;
+
+  MutexLockGuard m(lock_options_);
+  if (!opt_proxy_groups_)
+    return;
+  vector<ProxyInfo> *group = current_proxy_group();
+  for (unsigned i = 0; i < group->size(); ++i) {
+    if ((*group)[i].url == proxy) {
+      (*group)[i].AddSample(rtt_ms, throughput);
+      break;
+    }
+  }
+
+  const time_t now = time(NULL);
+  if (opt_timestamp_proxy_reweight_ == 0) {
+    opt_timestamp_proxy_reweight_ = now;
+    return;
+  }
+  if (now < opt_timestamp_proxy_reweight_ +
+            static_cast<time_t>(kProxyReweightIntervalSec))
+  {
+    return;
+  }
+  opt_timestamp_proxy_reweight_ = now;
+  if (opt_proxy_shard_) {
+    UpdateProxiesUnlocked("reweight");
+    return;
+  }
+  // Without sharding, only move away from a proxy that fell behind, so that
+  // clients stick to their proxy as long as the proxies are roughly equal
+  const unsigned num_alive =
+    group->size() - opt_proxy_groups_current_burned_;
+  vector<unsigned> weights;
+  GetProxyWeightsUnlocked(num_alive, &weights);
+  ProxyInfo *current = ChooseProxyUnlocked(NULL);
+  for (unsigned i = 0; i < num_alive; ++i) {
+    if ((&(*group)[i] == current) && (weights[i] < kProxyMapScale)) {
+      UpdateProxiesUnlocked("slow proxy");
+      break;
+    }
+  }
 }
 
 
@@ -1163,16 +1694,19 @@ bool DownloadManager::CanRetry(const JobInfo *info) {
 void DownloadManager::Backoff(JobInfo *info) {
   unsigned backoff_init_ms = 0;
   unsigned backoff_max_ms = 0;
+  unsigned backoff_random_ms = 0;
   {
+    // Also protects prng_ against concurrent access by the I/O threads
     MutexLockGuard m(lock_options_);
     backoff_init_ms = opt_backoff_init_ms_;
     backoff_max_ms = opt_backoff_max_ms_;
+    backoff_random_ms = prng_.Next(backoff_init_ms + 1);
   }
 
   info->num_retries++;
   perf::Inc(counters_->n_retries);
   if (info->backoff_ms == 0) {
-    info->backoff_ms = prng_.Next(backoff_init_ms + 1);  // Must be != 0
+    info->backoff_ms = backoff_random_ms;  // Must be != 0
   } else {
     info->backoff_ms *= 2;
   }
@@ -1185,8 +1719,11 @@ void DownloadManager::Backoff(JobInfo *info) {
 void DownloadManager::SetNocache(JobInfo *info) {
   if (info->nocache)
     return;
-  header_lists_->AppendHeader(info->headers, "Pragma: no-cache");
-  header_lists_->AppendHeader(info->headers, "Cache-Control: no-cache");
+  {
+    MutexLockGuard m(lock_header_lists_);
+    header_lists_->AppendHeader(info->headers, "Pragma: no-cache");
+    header_lists_->AppendHeader(info->headers, "Cache-Control: no-cache");
+  }
   curl_easy_setopt(info->curl_handle, CURLOPT_HTTPHEADER, info->headers);
   info->nocache = true;
 }
@@ -1199,8 +1736,11 @@ void DownloadManager::SetNocache(JobInfo *info) {
 void DownloadManager::SetRegularCache(JobInfo *info) {
   if (info->nocache == false)
     return;
-  header_lists_->CutHeader("Pragma: no-cache", &(info->headers));
-  header_lists_->CutHeader("Cache-Control: no-cache", &(info->headers));
+  {
+    MutexLockGuard m(lock_header_lists_);
+    header_lists_->CutHeader("Pragma: no-cache", &(info->headers));
+    header_lists_->CutHeader("Cache-Control: no-cache", &(info->headers));
+  }
   curl_easy_setopt(info->curl_handle, CURLOPT_HTTPHEADER, info->headers);
   info->nocache = false;
 }
@@ -1225,11 +1765,20 @@ void DownloadManager::ReleaseCredential(JobInfo *info) {
  *
  * \return true if another download should be performed, false otherwise
  */
-bool DownloadManager::VerifyAndFinalize(const int curl_error, JobInfo *info) {
+bool DownloadManager::VerifyAndFinalize(int curl_error, JobInfo *info) {
   LogCvmfs(kLogDownload, kLogDebug,
            "Verify downloaded url %s, proxy %s (curl error %d)",
            info->url->c_str(), info->proxy.c_str(), curl_error);
-  UpdateStatistics(info->curl_handle);
+  UpdateStatistics(info->curl_handle, info);
+
+  if (info->pipeline != NULL) {
+    FlushPipeline(info);
+    const int32_t pipeline_error = atomic_read32(&info->pipeline_error);
+    if ((pipeline_error != kFailOk) && (curl_error == CURLE_OK)) {
+      info->error_code = static_cast<Failures>(pipeline_error);
+      curl_error = CURLE_WRITE_ERROR;
+    }
+  }
 
   // Verification and error classification
   switch (curl_error) {
@@ -1381,6 +1930,7 @@ bool DownloadManager::VerifyAndFinalize(const int curl_error, JobInfo *info) {
               opt_proxy_groups_current_ = 0;
               opt_timestamp_backup_proxies_ = 0;
               RebalanceProxiesUnlocked("reset proxies for host failover");
+              RequestDnsRefreshUnlocked();
             }
           }
 
@@ -1399,37 +1949,14 @@ bool DownloadManager::VerifyAndFinalize(const int curl_error, JobInfo *info) {
     LogCvmfs(kLogDownload, kLogDebug, "Trying again on same curl handle, "
              "same url: %d, error code %d", same_url_retry, info->error_code);
     // Reset internal state and destination
-    if ((info->destination == kDestinationMem) && info->destination_mem.data) {
-      free(info->destination_mem.data);
-      info->destination_mem.data = NULL;
-      info->destination_mem.size = 0;
-      info->destination_mem.pos = 0;
+    if (!ResetDestination(info)) {
+      info->error_code = kFailLocalIO;
+      goto verify_and_finalize_stop;
     }
     if (info->interrupt_cue && info->interrupt_cue->IsCanceled()) {
       info->error_code = kFailCanceled;
       goto verify_and_finalize_stop;
     }
-    if ((info->destination == kDestinationFile) ||
-        (info->destination == kDestinationPath))
-    {
-      if ((fflush(info->destination_file) != 0) ||
-          (ftruncate(fileno(info->destination_file), 0) != 0))
-      {
-        info->error_code = kFailLocalIO;
-        goto verify_and_finalize_stop;
-      }
-      rewind(info->destination_file);
-    }
-    if (info->destination == kDestinationSink) {
-      if (info->destination_sink->Reset() != 0) {
-        info->error_code = kFailLocalIO;
-        goto verify_and_finalize_stop;
-      }
-    }
-    if (info->expected_hash)
-      shash::Init(info->hash_context);
-    if (info->compressed)
-      zlib::DecompressInit(&info->zstream);
     SetRegularCache(info);
 
     // Failure handling
@@ -1499,6 +2026,7 @@ bool DownloadManager::VerifyAndFinalize(const int curl_error, JobInfo *info) {
     zlib::DecompressFini(&info->zstream);
 
   if (info->headers) {
+    MutexLockGuard m(lock_header_lists_);
     header_lists_->PutList(info->headers);
     info->headers = NULL;
   }
@@ -1507,30 +2035,96 @@ bool DownloadManager::VerifyAndFinalize(const int curl_error, JobInfo *info) {
 }
 
 
+/**
+ * Discards the data received so far by a request, so that the download can
+ * start over.  Returns false on local I/O errors.
+ */
+bool DownloadManager::ResetDestination(JobInfo *info) {
+  if (info->pipeline != NULL) {
+    FlushPipeline(info);
+    atomic_write32(&info->pipeline_error, kFailOk);
+  }
+  if ((info->destination == kDestinationMem) && info->destination_mem.data) {
+    free(info->destination_mem.data);
+    info->destination_mem.data = NULL;
+    info->destination_mem.size = 0;
+    info->destination_mem.pos = 0;
+  }
+  if ((info->destination == kDestinationFile) ||
+      (info->destination == kDestinationPath))
+  {
+    if ((fflush(info->destination_file) != 0) ||
+        (ftruncate(fileno(info->destination_file), 0) != 0))
+    {
+      return false;
+    }
+    rewind(info->destination_file);
+  }
+  if (info->destination == kDestinationSink) {
+    if (info->destination_sink->Reset() != 0)
+      return false;
+  }
+  if (info->expected_hash)
+    shash::Init(info->hash_context);
+  if (info->compressed)
+    zlib::DecompressInit(&info->zstream);
+  return true;
+}
+
+
+/**
+ * Only downloads to a file or a sink that need hashing or decompression use
+ * the pipeline.  Memory destinations are small and decompressed at the end
+ * anyway.
+ */
+bool DownloadManager::IsPipelineCandidate(const JobInfo *info) {
+  return (pipeline_ != NULL) &&
+         (info->expected_hash || info->compressed) &&
+         ((info->destination == kDestinationFile) ||
+          (info->destination == kDestinationPath) ||
+          (info->destination == kDestinationSink));
+}
+
+
+/**
+ * Blocks until the pipeline worker processed all the data received so far
+ * for the transfer.  Typically only the last few buffers are outstanding.
+ */
+void DownloadManager::FlushPipeline(JobInfo *info) {
+  Signal flushed;
+  info->pipeline->Dispatch(new PipelineBlock(info, NULL, 0, &flushed));
+  flushed.Wait();
+}
+
+
 DownloadManager::DownloadManager() {
-  pool_handles_idle_ = NULL;
-  pool_handles_inuse_ = NULL;
   pool_max_handles_ = 0;
-  curl_multi_ = NULL;
   default_headers_ = NULL;
 
   atomic_init32(&multi_threaded_);
   pipe_terminate_[0] = pipe_terminate_[1] = -1;
-
-  pipe_jobs_[0] = pipe_jobs_[1] = -1;
-  watch_fds_ = NULL;
-  watch_fds_size_ = 0;
-  watch_fds_inuse_ = 0;
   watch_fds_max_ = 0;
 
   lock_options_ =
   reinterpret_cast<pthread_mutex_t *>(smalloc(sizeof(pthread_mutex_t)));
   int retval = pthread_mutex_init(lock_options_, NULL);
   assert(retval == 0);
+  lock_header_lists_ =
+  reinterpret_cast<pthread_mutex_t *>(smalloc(sizeof(pthread_mutex_t)));
+  retval = pthread_mutex_init(lock_header_lists_, NULL);
+  assert(retval == 0);
   lock_synchronous_mode_ =
   reinterpret_cast<pthread_mutex_t *>(smalloc(sizeof(pthread_mutex_t)));
   retval = pthread_mutex_init(lock_synchronous_mode_, NULL);
   assert(retval == 0);
+  lock_hedge_ =
+  reinterpret_cast<pthread_mutex_t *>(smalloc(sizeof(pthread_mutex_t)));
+  retval = pthread_mutex_init(lock_hedge_, NULL);
+  assert(retval == 0);
+  lock_resolver_ =
+  reinterpret_cast<pthread_mutex_t *>(smalloc(sizeof(pthread_mutex_t)));
+  retval = pthread_mutex_init(lock_resolver_, NULL);
+  assert(retval == 0);
 
   opt_dns_server_ = "";
   opt_ip_preference_ = dns::kIpPreferSystem;
@@ -1545,14 +2139,29 @@ DownloadManager::DownloadManager() {
   opt_proxy_groups_current_burned_ = 0;
   opt_num_proxies_ = 0;
   opt_proxy_shard_ = false;
+  opt_proxy_latency_aware_ = false;
+  opt_timestamp_proxy_reweight_ = 0;
   opt_max_retries_ = 0;
   opt_backoff_init_ms_ = 0;
   opt_backoff_max_ms_ = 0;
+  opt_num_io_threads_ = 1;
+  opt_parallel_streams_ = 1;
+  opt_parallel_threshold_ = 0;
+  opt_hedge_percentile_ = 0;
+  opt_hedge_budget_ = kDefaultHedgeBudget;
+  hedge_num_latencies_ = 0;
+  hedge_deadline_ms_ = kHedgeDefaultDeadlineMs;
   enable_info_header_ = false;
   opt_ipv4_only_ = false;
   follow_redirects_ = false;
+  opt_multiplex_ = false;
 
   resolver_ = NULL;
+  pipe_dns_refresh_[0] = pipe_dns_refresh_[1] = -1;
+  dns_refresh_requested_ = false;
+  opt_pipeline_threads_ = 0;
+  pipeline_ = NULL;
+  atomic_init32(&pipeline_next_tag_);
 
   opt_timestamp_backup_proxies_ = 0;
   opt_timestamp_failover_proxies_ = 0;
@@ -1568,9 +2177,15 @@ DownloadManager::DownloadManager() {
 
 DownloadManager::~DownloadManager() {
   pthread_mutex_destroy(lock_options_);
+  pthread_mutex_destroy(lock_header_lists_);
   pthread_mutex_destroy(lock_synchronous_mode_);
+  pthread_mutex_destroy(lock_hedge_);
+  pthread_mutex_destroy(lock_resolver_);
   free(lock_options_);
+  free(lock_header_lists_);
   free(lock_synchronous_mode_);
+  free(lock_hedge_);
+  free(lock_resolver_);
 }
 
 void DownloadManager::InitHeaders() {
@@ -1609,8 +2224,6 @@ void DownloadManager::Init(const unsigned max_pool_handles,
   atomic_init32(&multi_threaded_);
   int retval = curl_global_init(CURL_GLOBAL_ALL);
   assert(retval == CURLE_OK);
-  pool_handles_idle_ = new set<CURL *>;
-  pool_handles_inuse_ = new set<CURL *>;
   pool_max_handles_ = max_pool_handles;
   watch_fds_max_ = 4*pool_max_handles_;
 
@@ -1621,6 +2234,8 @@ void DownloadManager::Init(const unsigned max_pool_handles,
   opt_proxy_groups_current_burned_ = 0;
   opt_num_proxies_ = 0;
   opt_proxy_shard_ = false;
+  opt_proxy_latency_aware_ = false;
+  opt_timestamp_proxy_reweight_ = 0;
   opt_host_chain_current_ = 0;
   opt_ip_preference_ = dns::kIpPreferSystem;
 
@@ -1629,14 +2244,8 @@ void DownloadManager::Init(const unsigned max_pool_handles,
   user_agent_ = NULL;
   InitHeaders();
 
-  curl_multi_ = curl_multi_init();
-  assert(curl_multi_ != NULL);
-  curl_multi_setopt(curl_multi_, CURLMOPT_SOCKETFUNCTION, CallbackCurlSocket);
-  curl_multi_setopt(curl_multi_, CURLMOPT_SOCKETDATA,
-                    static_cast<void *>(this));
-  curl_multi_setopt(curl_multi_, CURLMOPT_MAXCONNECTS, watch_fds_max_);
-  curl_multi_setopt(curl_multi_, CURLMOPT_MAX_TOTAL_CONNECTIONS,
-                    pool_max_handles_);
+  // More I/O threads are created in Spawn()
+  io_threads_.push_back(CreateIoThread(pool_max_handles_));
 
   prng_.InitLocaltime();
 
@@ -1654,28 +2263,34 @@ void DownloadManager::Init(const unsigned max_pool_handles,
 
 void DownloadManager::Fini() {
   if (atomic_xadd32(&multi_threaded_, 0) == 1) {
-    // Shutdown I/O thread
+    // Shutdown I/O threads; the terminate pipe is never drained, so that every
+    // I/O thread sees it
     char buf = 'T';
     WritePipe(pipe_terminate_[1], &buf, 1);
-    pthread_join(thread_download_, NULL);
+    for (unsigned i = 0; i < io_threads_.size(); ++i)
+      pthread_join(io_threads_[i]->thread, NULL);
+    pthread_join(thread_dns_refresh_, NULL);
     // All handles are removed from the multi stack
     close(pipe_terminate_[1]);
     close(pipe_terminate_[0]);
-    close(pipe_jobs_[1]);
-    close(pipe_jobs_[0]);
+    ClosePipe(pipe_dns_refresh_);
+    pipe_dns_refresh_[0] = pipe_dns_refresh_[1] = -1;
+    dns_refresh_requested_ = false;
+
+    // The I/O threads are gone, so no more blocks arrive
+    for (unsigned i = 0; i < pipeline_tubes_.size(); ++i)
+      pipeline_tubes_[i]->EnqueueBack(new PipelineBlock(NULL, NULL, 0, NULL));
+    for (unsigned i = 0; i < pipeline_threads_.size(); ++i)
+      pthread_join(pipeline_threads_[i], NULL);
+    delete pipeline_;
+    pipeline_ = NULL;
+    pipeline_tubes_.clear();
+    pipeline_threads_.clear();
   }
 
-  for (set<CURL *>::iterator i = pool_handles_idle_->begin(),
-       iEnd = pool_handles_idle_->end(); i != iEnd; ++i)
-  {
-    curl_easy_cleanup(*i);
-  }
-  delete pool_handles_idle_;
-  delete pool_handles_inuse_;
-  curl_multi_cleanup(curl_multi_);
-  pool_handles_idle_ = NULL;
-  pool_handles_inuse_ = NULL;
-  curl_multi_ = NULL;
+  for (unsigned i = 0; i < io_threads_.size(); ++i)
+    DestroyIoThread(io_threads_[i]);
+  io_threads_.clear();
 
   FiniHeaders();
   if (user_agent_)
@@ -1706,9 +2321,45 @@ void DownloadManager::Fini() {
  */
 void DownloadManager::Spawn() {
   MakePipe(pipe_terminate_);
-  MakePipe(pipe_jobs_);
 
-  int retval = pthread_create(&thread_download_, NULL, MainDownload,
+  if (opt_pipeline_threads_ > 0) {
+    pipeline_ = new TubeGroup<PipelineBlock>();
+    pipeline_threads_.resize(opt_pipeline_threads_);
+    for (unsigned i = 0; i < opt_pipeline_threads_; ++i) {
+      Tube<PipelineBlock> *tube = new Tube<PipelineBlock>(kPipelineTubeLimit);
+      pipeline_->TakeTube(tube);
+      pipeline_tubes_.push_back(tube);
+      int retval = pthread_create(&pipeline_threads_[i], NULL, MainPipeline,
+                                  static_cast<void *>(tube));
+      assert(retval == 0);
+    }
+    pipeline_->Activate();
+    LogCvmfs(kLogDownload, kLogDebug, "spawned %u download pipeline workers",
+             opt_pipeline_threads_);
+  }
+
+  // Split the connections among the I/O threads
+  const unsigned max_connections = (pool_max_handles_ > opt_num_io_threads_) ?
+    (pool_max_handles_ / opt_num_io_threads_) : 1;
+  curl_multi_setopt(io_threads_[0]->curl_multi, CURLMOPT_MAX_TOTAL_CONNECTIONS,
+                    max_connections);
+  while (io_threads_.size() < opt_num_io_threads_)
+    io_threads_.push_back(CreateIoThread(max_connections));
+
+  for (unsigned i = 0; i < io_threads_.size(); ++i) {
+    MakePipe(io_threads_[i]->pipe_jobs);
+    MakePipe(io_threads_[i]->pipe_prewarm);
+    Block2Nonblock(io_threads_[i]->pipe_prewarm[0]);
+    Block2Nonblock(io_threads_[i]->pipe_prewarm[1]);
+    int retval = pthread_create(&io_threads_[i]->thread, NULL, MainDownload,
+                                static_cast<void *>(io_threads_[i]));
+    assert(retval == 0);
+  }
+  LogCvmfs(kLogDownload, kLogDebug, "spawned %u download I/O threads",
+           opt_num_io_threads_);
+
+  MakePipe(pipe_dns_refresh_);
+  int retval = pthread_create(&thread_dns_refresh_, NULL, MainDnsRefresh,
                               static_cast<void *>(this));
   assert(retval == 0);
 
@@ -1749,6 +2400,21 @@ Failures DownloadManager::Fetch(JobInfo *info) {
     info->info_header[header_size-1] = '\0';
   }
 
+  if (IsParallelCandidate(info)) {
+    result = FetchParallel(info);
+    if (result == kFailOk) {
+      info->error_code = kFailOk;
+      return kFailOk;
+    }
+    LogCvmfs(kLogDownload, kLogDebug, "parallel download of %s failed (%s), "
+             "falling back to a single stream", info->url->c_str(),
+             Code2Ascii(result));
+    if (info->destination_sink->Reset() != 0) {
+      info->error_code = kFailLocalIO;
+      return kFailLocalIO;
+    }
+  }
+
   if (atomic_xadd32(&multi_threaded_, 0) == 1) {
     if (info->wait_at[0] == -1) {
       MakePipe(info->wait_at);
@@ -1757,12 +2423,12 @@ Failures DownloadManager::Fetch(JobInfo *info) {
     // LogCvmfs(kLogDownload, kLogDebug, "send job to thread, pipe %d %d",
     //          info->wait_at[0], info->wait_at[1]);
     // NOLINTNEXTLINE(bugprone-sizeof-expression)
-    WritePipe(pipe_jobs_[1], &info, sizeof(info));
+    WritePipe(SelectIoThread(info)->pipe_jobs[1], &info, sizeof(info));
     ReadPipe(info->wait_at[0], &result, sizeof(result));
     // LogCvmfs(kLogDownload, kLogDebug, "got result %d", result);
   } else {
     MutexLockGuard l(lock_synchronous_mode_);
-    CURL *handle = AcquireCurlHandle();
+    CURL *handle = AcquireCurlHandle(io_threads_[0]);
     InitializeRequest(info, handle);
     SetUrlOptions(info);
     // curl_easy_setopt(handle, CURLOPT_VERBOSE, 1);
@@ -1778,7 +2444,7 @@ Failures DownloadManager::Fetch(JobInfo *info) {
       }
     } while (VerifyAndFinalize(retval, info));
     result = info->error_code;
-    ReleaseCurlHandle(info->curl_handle);
+    ReleaseCurlHandle(io_threads_[0], info->curl_handle);
   }
 
   if (result != kFailOk) {
@@ -1799,6 +2465,379 @@ Failures DownloadManager::Fetch(JobInfo *info) {
 }
 
 
+namespace {
+
+/**
+ * Collects one range of a parallel download in memory.  Data beyond the
+ * expected size results in a short write, which makes curl abort the transfer.
+ */
+class RangeSink : public cvmfs::Sink {
+ public:
+  explicit RangeSink(const uint64_t capacity) : capacity_(capacity) {
+    data_.reserve(capacity);
+  }
+  virtual int64_t Write(const void *buf, uint64_t sz) {
+    const uint64_t nbytes = std::min(sz, capacity_ - data_.size());
+    data_.append(static_cast<const char *>(buf), nbytes);
+    return nbytes;
+  }
+  virtual int Reset() {
+    data_.clear();
+    return 0;
+  }
+  const std::string &data() const { return data_; }
+
+ private:
+  const uint64_t capacity_;
+  std::string data_;
+};
+
+struct ParallelRange {
+  ParallelRange(const JobInfo &parent, const uint64_t offset,
+                const uint64_t size)
+    : sink(size)
+    , job(parent.url, false, parent.probe_hosts, &sink, NULL)
+  {
+    job.range_offset = offset;
+    job.range_size = size;
+    job.force_nocache = parent.force_nocache;
+    job.pid = parent.pid;
+    job.uid = parent.uid;
+    job.gid = parent.gid;
+    job.interrupt_cue = parent.interrupt_cue;
+    job.info_header = parent.info_header;
+  }
+  RangeSink sink;
+  JobInfo job;
+};
+
+}  // anonymous namespace
+
+
+/**
+ * Only uncompressed downloads into a sink can be split, because the ranges
+ * are hashed and written in order.  The size needs to be known upfront.
+ */
+bool DownloadManager::IsParallelCandidate(const JobInfo *info) {
+  return (opt_parallel_streams_ > 1) &&
+         (atomic_read32(&multi_threaded_) == 1) &&
+         (info->destination == kDestinationSink) &&
+         !info->compressed && !info->head_request &&
+         (info->range_size > 0) &&
+         (static_cast<uint64_t>(info->range_size) >= opt_parallel_threshold_) &&
+         (static_cast<uint64_t>(info->range_size) > kParallelRangeSize);
+}
+
+
+/**
+ * Fetches the object in ranges of kParallelRangeSize with up to
+ * opt_parallel_streams_ concurrent requests.  The ranges are spread over the
+ * I/O threads.  Completed ranges are written to the sink in order and the
+ * content hash is verified over the whole object.  On failure, the sink may
+ * contain a prefix of the object.
+ */
+Failures DownloadManager::FetchParallel(JobInfo *info) {
+  const uint64_t base = (info->range_offset >= 0) ? info->range_offset : 0;
+  const uint64_t total = info->range_size;
+  const uint64_t num_ranges =
+    (total + kParallelRangeSize - 1) / kParallelRangeSize;
+  LogCvmfs(kLogDownload, kLogDebug, "fetching %s in %" PRIu64 " ranges "
+           "with %u streams", info->url->c_str(), num_ranges,
+           opt_parallel_streams_);
+
+  shash::ContextPtr hash_context;
+  if (info->expected_hash) {
+    hash_context.algorithm = info->expected_hash->algorithm;
+    hash_context.size = shash::GetContextSize(hash_context.algorithm);
+    hash_context.buffer = alloca(hash_context.size);
+    shash::Init(hash_context);
+  }
+
+  Failures result = kFailOk;
+  std::deque<ParallelRange *> in_flight;
+  uint64_t next = 0;
+  while (true) {
+    while ((result == kFailOk) && (next < num_ranges) &&
+           (in_flight.size() < opt_parallel_streams_))
+    {
+      const uint64_t offset = next * kParallelRangeSize;
+      ParallelRange *range = new ParallelRange(*info, base + offset,
+        std::min(static_cast<uint64_t>(kParallelRangeSize), total - offset));
+      MakePipe(range->job.wait_at);
+      JobInfo *job = &range->job;
+      // NOLINTNEXTLINE(bugprone-sizeof-expression)
+      WritePipe(io_threads_[next % io_threads_.size()]->pipe_jobs[1], &job,
+                sizeof(job));
+      in_flight.push_back(range);
+      next++;
+    }
+    if (in_flight.empty())
+      break;
+
+    ParallelRange *range = in_flight.front();
+    in_flight.pop_front();
+    Failures range_result;
+    ReadPipe(range->job.wait_at[0], &range_result, sizeof(range_result));
+    if (result == kFailOk) {
+      const std::string &data = range->sink.data();
+      if (range_result != kFailOk) {
+        result = range_result;
+      } else if (data.length() != static_cast<uint64_t>(range->job.range_size))
+      {
+        // The server or proxy ignored the range request
+        result = kFailBadData;
+      } else {
+        if (info->expected_hash) {
+          shash::Update(reinterpret_cast<const unsigned char *>(data.data()),
+                        data.length(), hash_context);
+        }
+        const int64_t written =
+          info->destination_sink->Write(data.data(), data.length());
+        if ((written < 0) || (static_cast<uint64_t>(written) != data.length()))
+          result = kFailLocalIO;
+      }
+    }
+    delete range;
+  }
+
+  if ((result == kFailOk) && info->expected_hash) {
+    shash::Any match_hash;
+    shash::Final(hash_context, &match_hash);
+    if (match_hash != *(info->expected_hash)) {
+      LogCvmfs(kLogDownload, kLogDebug,
+               "hash verification of %s failed (expected %s, got %s)",
+               info->url->c_str(), info->expected_hash->ToString().c_str(),
+               match_hash.ToString().c_str());
+      result = kFailBadData;
+    }
+  }
+  return result;
+}
+
+
+/**
+ * Only small, complete objects fetched through a proxy are hedged.  The
+ * duplicate is buffered in memory, so objects known to be larger than
+ * kMaxMemSize are excluded.  Called after SetUrlOptions().
+ */
+bool DownloadManager::IsHedgeCandidate(const JobInfo *info) {
+  if (info->head_request || (info->destination == kDestinationNone) ||
+      (info->range_offset != -1) || (info->proxy == "DIRECT"))
+  {
+    return false;
+  }
+  return (info->range_size < 0) ||
+         (static_cast<uint64_t>(info->range_size) <= kMaxMemSize);
+}
+
+
+/**
+ * Sends a duplicate for every candidate that exceeded the hedging deadline,
+ * as long as the budget allows.  A request is hedged at most once.  Returns
+ * true if a duplicate was added to the multi handle.
+ */
+bool DownloadManager::StartHedges(IoThread *io_thread) {
+  unsigned deadline_ms;
+  {
+    MutexLockGuard m(lock_hedge_);
+    deadline_ms = hedge_deadline_ms_;
+  }
+  const uint64_t now_ms = platform_monotonic_time_ns() / (1000 * 1000);
+  bool started = false;
+  set<JobInfo *>::iterator i = io_thread->hedge_candidates->begin();
+  while (i != io_thread->hedge_candidates->end()) {
+    JobInfo *primary = *i;
+    if (now_ms < primary->start_ms + deadline_ms) {
+      ++i;
+      continue;
+    }
+    io_thread->hedge_candidates->erase(i++);
+
+    const int64_t num_hedges = counters_->n_hedges->Get();
+    const int64_t num_requests = counters_->n_requests->Get();
+    if ((num_hedges + 1) * 100 > opt_hedge_budget_ * num_requests)
+      continue;
+
+    JobInfo *hedge = new JobInfo(primary->url, false /* compressed */,
+                                 primary->probe_hosts, primary->expected_hash);
+    hedge->hedge_primary = primary;
+    hedge->force_nocache = primary->nocache;
+    hedge->pid = primary->pid;
+    hedge->uid = primary->uid;
+    hedge->gid = primary->gid;
+    hedge->info_header = primary->info_header;
+    if (primary->expected_hash) {
+      hedge->hash_context =
+        shash::ContextPtr(primary->expected_hash->algorithm);
+      hedge->hash_context.buffer = smalloc(hedge->hash_context.size);
+    }
+    CURL *handle = AcquireCurlHandle(io_thread);
+    InitializeRequest(hedge, handle);
+    SetUrlOptions(hedge);
+    if (!SetHedgeProxy(hedge, primary->proxy)) {
+      DeleteHedge(io_thread, hedge);
+      continue;
+    }
+    LogCvmfs(kLogDownload, kLogDebug, "hedging %s after %u ms via %s",
+             primary->url->c_str(), deadline_ms, hedge->proxy.c_str());
+    primary->hedge = hedge;
+    curl_multi_add_handle(io_thread->curl_multi, handle);
+    perf::Inc(counters_->n_hedges);
+    started = true;
+  }
+  return started;
+}
+
+
+/**
+ * Points the duplicate to the proxy that follows the proxy of the original
+ * request in the current load-balancing group.  Returns false if there is no
+ * other usable proxy.
+ */
+bool DownloadManager::SetHedgeProxy(JobInfo *hedge,
+                                    const string &primary_proxy)
+{
+  MutexLockGuard m(lock_options_);
+  if (!opt_proxy_groups_)
+    return false;
+  vector<ProxyInfo> *group = current_proxy_group();
+  const unsigned num_alive = group->size() - opt_proxy_groups_current_burned_;
+  unsigned idx = 0;
+  for (; idx < num_alive; ++idx) {
+    if ((*group)[idx].url == primary_proxy)
+      break;
+  }
+  for (unsigned i = 1; i <= num_alive; ++i) {
+    const ProxyInfo &proxy = (*group)[(idx + i) % num_alive];
+    if ((proxy.url == primary_proxy) || (proxy.url == "DIRECT") ||
+        (proxy.host.status() != dns::kFailOk))
+    {
+      continue;
+    }
+    hedge->proxy = proxy.url;
+    curl_easy_setopt(hedge->curl_handle, CURLOPT_PROXY, hedge->proxy.c_str());
+    return true;
+  }
+  return false;
+}
+
+
+/**
+ * Called when a duplicate request completes.  If the duplicate was served
+ * successfully and verified, its data replaces whatever the original request
+ * received so far and the original request is finalized.  Returns true if the
+ * original request is complete and needs to be returned to Fetch().
+ */
+bool DownloadManager::FinishHedge(
+  IoThread *io_thread,
+  JobInfo *hedge,
+  const int curl_error)
+{
+  JobInfo *primary = hedge->hedge_primary;
+  primary->hedge = NULL;
+  UpdateStatistics(hedge->curl_handle, hedge);
+  bool verified = (curl_error == CURLE_OK) && (hedge->error_code == kFailOk);
+  if (verified && hedge->expected_hash) {
+    shash::Any match_hash;
+    shash::Final(hedge->hash_context, &match_hash);
+    verified = (match_hash == *(hedge->expected_hash));
+  }
+  if (!verified) {
+    LogCvmfs(kLogDownload, kLogDebug, "hedged request for %s via %s failed",
+             hedge->url->c_str(), hedge->proxy.c_str());
+    DeleteHedge(io_thread, hedge);
+    return false;
+  }
+
+  perf::Inc(counters_->n_hedge_wins);
+  curl_multi_remove_handle(io_thread->curl_multi, primary->curl_handle);
+  int replay_error = CURLE_OK;
+  if (!ResetDestination(primary)) {
+    primary->error_code = kFailLocalIO;
+    replay_error = CURLE_WRITE_ERROR;
+  } else {
+    primary->error_code = kFailOk;
+    const size_t size = hedge->destination_mem.pos;
+    if ((primary->destination == kDestinationMem) && (size > 0)) {
+      primary->destination_mem.data = static_cast<char *>(smalloc(size));
+      primary->destination_mem.size = size;
+    }
+    if ((size > 0) &&
+        (CallbackCurlData(hedge->destination_mem.data, 1, size, primary) !=
+         size))
+    {
+      replay_error = CURLE_WRITE_ERROR;
+    }
+  }
+  DeleteHedge(io_thread, hedge);
+
+  perf::Inc(counters_->n_requests);
+  if (VerifyAndFinalize(replay_error, primary)) {
+    curl_multi_add_handle(io_thread->curl_multi, primary->curl_handle);
+    return false;
+  }
+  RecordLatency(primary);
+  return true;
+}
+
+
+/**
+ * Stops the duplicate of a request that completed on its own.
+ */
+void DownloadManager::CancelHedge(IoThread *io_thread, JobInfo *info) {
+  curl_multi_remove_handle(io_thread->curl_multi, info->hedge->curl_handle);
+  DeleteHedge(io_thread, info->hedge);
+  info->hedge = NULL;
+}
+
+
+/**
+ * The duplicate's handle must not be part of the multi handle anymore.
+ */
+void DownloadManager::DeleteHedge(IoThread *io_thread, JobInfo *hedge) {
+  ReleaseCredential(hedge);
+  if (hedge->headers) {
+    MutexLockGuard m(lock_header_lists_);
+    header_lists_->PutList(hedge->headers);
+    hedge->headers = NULL;
+  }
+  ReleaseCurlHandle(io_thread, hedge->curl_handle);
+  free(hedge->destination_mem.data);
+  if (hedge->expected_hash)
+    free(hedge->hash_context.buffer);
+  delete hedge;
+}
+
+
+/**
+ * Adds the latency of a successful request to the window of measurements and
+ * periodically recomputes the hedging deadline.
+ */
+void DownloadManager::RecordLatency(const JobInfo *info) {
+  if ((info->start_ms == 0) || (info->error_code != kFailOk))
+    return;
+  const uint64_t now_ms = platform_monotonic_time_ns() / (1000 * 1000);
+  const uint32_t latency_ms = now_ms - info->start_ms;
+
+  MutexLockGuard m(lock_hedge_);
+  if (hedge_latencies_.size() < kHedgeWindow)
+    hedge_latencies_.push_back(latency_ms);
+  else
+    hedge_latencies_[hedge_num_latencies_ % kHedgeWindow] = latency_ms;
+  hedge_num_latencies_++;
+  if ((hedge_num_latencies_ < kHedgeMinSamples) ||
+      (hedge_num_latencies_ % kHedgeRefresh != 0))
+  {
+    return;
+  }
+  vector<uint32_t> sorted(hedge_latencies_);
+  const unsigned pos = (sorted.size() - 1) * opt_hedge_percentile_ / 100;
+  nth_element(sorted.begin(), sorted.begin() + pos, sorted.end());
+  hedge_deadline_ms_ = std::max(static_cast<uint32_t>(kHedgeMinDeadlineMs),
+                                sorted[pos]);
+}
+
+
 /**
  * Used by the client to connect the authz session manager to the download
  * manager.
@@ -1827,6 +2866,7 @@ void DownloadManager::SetDnsServer(const string &address) {
 
     vector<string> servers;
     servers.push_back(address);
+    MutexLockGuard m_resolver(lock_resolver_);
     bool retval = resolver_->SetResolvers(servers);
     assert(retval);
   }
@@ -1842,6 +2882,7 @@ void DownloadManager::SetDnsParameters(
   const unsigned timeout_ms)
 {
   MutexLockGuard m(lock_options_);
+  MutexLockGuard m_resolver(lock_resolver_);
   if ((resolver_->retries() == retries) &&
       (resolver_->timeout_ms() == timeout_ms))
   {
@@ -1860,6 +2901,7 @@ void DownloadManager::SetDnsTtlLimits(
   const unsigned max_seconds)
 {
   MutexLockGuard m(lock_options_);
+  MutexLockGuard m_resolver(lock_resolver_);
   resolver_->set_min_ttl(min_seconds);
   resolver_->set_max_ttl(max_seconds);
 }
@@ -1896,6 +2938,61 @@ void DownloadManager::SetLowSpeedLimit(const unsigned low_speed_limit) {
 }
 
 
+/**
+ * Number of I/O threads started by Spawn(), each one driving its own curl
+ * multi handle.  Needs to be called before Spawn().
+ */
+void DownloadManager::SetNumIoThreads(const unsigned num_io_threads) {
+  assert(atomic_read32(&multi_threaded_) == 0);
+  opt_num_io_threads_ = num_io_threads;
+  if (opt_num_io_threads_ == 0)
+    opt_num_io_threads_ = 1;
+  if (opt_num_io_threads_ > kMaxIoThreads)
+    opt_num_io_threads_ = kMaxIoThreads;
+}
+
+
+/**
+ * Downloads of at least threshold bytes are split into ranges that are fetched
+ * by num_streams concurrent requests.  Needs to be called before Spawn().
+ */
+void DownloadManager::SetParallelRanges(
+  const unsigned num_streams,
+  const uint64_t threshold)
+{
+  assert(atomic_read32(&multi_threaded_) == 0);
+  opt_parallel_streams_ = (num_streams == 0) ? 1 : num_streams;
+  opt_parallel_threshold_ = threshold;
+}
+
+
+/**
+ * Enables hedged requests at the given latency percentile (1-99) with at most
+ * budget_percent duplicate requests.  A percentile of zero disables hedging.
+ * Needs to be called before Spawn().
+ */
+void DownloadManager::SetHedging(
+  const unsigned percentile,
+  const unsigned budget_percent)
+{
+  assert(atomic_read32(&multi_threaded_) == 0);
+  opt_hedge_percentile_ = (percentile > 99) ? 99 : percentile;
+  opt_hedge_budget_ = budget_percent;
+}
+
+
+/**
+ * Moves hashing, decompression, and writing of file and sink downloads into
+ * num_threads pipeline workers.  Zero threads keeps the work in the I/O
+ * threads.  Needs to be called before Spawn().
+ */
+void DownloadManager::SetPipelineThreads(const unsigned num_threads) {
+  assert(atomic_read32(&multi_threaded_) == 0);
+  opt_pipeline_threads_ = (num_threads > kMaxPipelineThreads) ?
+                          kMaxPipelineThreads : num_threads;
+}
+
+
 /**
  * Receives the currently active timeout values.
  */
@@ -2010,6 +3107,7 @@ void DownloadManager::SwitchProxy(JobInfo *info) {
         }
         opt_timestamp_failover_proxies_ = 0;
       }
+      RequestDnsRefreshUnlocked();
     }
   } else {
     // Record failover time
@@ -2022,6 +3120,7 @@ void DownloadManager::SwitchProxy(JobInfo *info) {
   UpdateProxiesUnlocked("failed proxy");
   LogCvmfs(kLogDownload, kLogDebug, "%d proxies remain in group",
            current_proxy_group()->size() - opt_proxy_groups_current_burned_);
+  RequestPrewarmUnlocked();
 }
 
 
@@ -2069,6 +3168,7 @@ void DownloadManager::SwitchHost(JobInfo *info) {
       opt_timestamp_backup_host_ = 0;
     }
   }
+  RequestPrewarmUnlocked();
 }
 
 void DownloadManager::SwitchHost() {
@@ -2314,6 +3414,7 @@ bool DownloadManager::ProbeGeo() {
   }
 
   UpdateProxiesUnlocked("geosort");
+  RequestDnsRefreshUnlocked();
 
   delete opt_host_chain_rtt_;
   opt_host_chain_rtt_ = new vector<int>(host_chain.size(), kProbeGeo);
@@ -2496,7 +3597,10 @@ void DownloadManager::SetProxyChain(
   vector<dns::Host> hosts;
   LogCvmfs(kLogDownload, kLogDebug, "resolving %u proxy addresses",
            hostnames.size());
-  resolver_->ResolveMany(hostnames, &hosts);
+  {
+    MutexLockGuard m_resolver(lock_resolver_);
+    resolver_->ResolveMany(hostnames, &hosts);
+  }
 
   // Construct opt_proxy_groups_: traverse proxy list in same order and expand
   // names to resolved IP addresses.
@@ -2550,6 +3654,7 @@ void DownloadManager::SetProxyChain(
     // Select random start proxy from the first group.
     UpdateProxiesUnlocked("set proxies");
   }
+  RequestDnsRefreshUnlocked();
 }
 
 
@@ -2622,16 +3727,20 @@ void DownloadManager::UpdateProxiesUnlocked(const string &reason) {
   // Rebuild proxy map and URL list
   opt_proxy_map_.clear();
   opt_proxy_urls_.clear();
+  vector<unsigned> weights;
+  GetProxyWeightsUnlocked(num_alive, &weights);
   const uint32_t max_key = 0xffffffffUL;
   if (opt_proxy_shard_) {
-    // Build a consistent map with multiple entries for each proxy
+    // Build a consistent map with multiple entries for each proxy.  A proxy
+    // with a lower weight keeps a prefix of its entries, so that only its
+    // share of keys moves to other proxies.
     for (unsigned i = 0; i < num_alive; ++i) {
       ProxyInfo *proxy = &(*group)[i];
       shash::Any proxy_hash(shash::kSha1);
       HashString(proxy->url, &proxy_hash);
       Prng prng;
       prng.InitSeed(proxy_hash.Partial32());
-      for (unsigned j = 0; j < kProxyMapScale; ++j) {
+      for (unsigned j = 0; j < weights[i]; ++j) {
         const std::pair<uint32_t, ProxyInfo *> entry(prng.Next(max_key), proxy);
         opt_proxy_map_.insert(entry);
       }
@@ -2642,8 +3751,17 @@ void DownloadManager::UpdateProxiesUnlocked(const string &reason) {
     const std::pair<uint32_t, ProxyInfo *> last_entry(max_key, first_proxy);
     opt_proxy_map_.insert(last_entry);
   } else {
-    // Build a map with a single entry for one randomly selected proxy
-    unsigned select = prng_.Next(num_alive);
+    // Build a map with a single entry for one randomly selected proxy,
+    // weighted by the proxy estimates
+    unsigned sum_weights = 0;
+    for (unsigned i = 0; i < num_alive; ++i)
+      sum_weights += weights[i];
+    unsigned pick = prng_.Next(sum_weights);
+    unsigned select = 0;
+    while (pick >= weights[select]) {
+      pick -= weights[select];
+      select++;
+    }
     ProxyInfo *proxy = &(*group)[select];
     const std::pair<uint32_t, ProxyInfo *> entry(max_key, proxy);
     opt_proxy_map_.insert(entry);
@@ -2662,6 +3780,39 @@ void DownloadManager::UpdateProxiesUnlocked(const string &reason) {
   }
 }
 
+/**
+ * Every alive proxy gets kProxyMapScale entries in the load-balancing map.
+ * With latency-aware selection, proxies that are more than
+ * kProxyCostTolerance times as expensive as the best measured proxy get
+ * proportionally fewer entries, but at least one.  Unmeasured proxies count
+ * as good ones so that they get a chance to be measured.
+ */
+void DownloadManager::GetProxyWeightsUnlocked(const unsigned num_alive,
+                                              vector<unsigned> *weights)
+{
+  weights->assign(num_alive, static_cast<unsigned>(kProxyMapScale));
+  if (!opt_proxy_latency_aware_)
+    return;
+
+  vector<ProxyInfo> *group = current_proxy_group();
+  float best_cost = 0.0;
+  for (unsigned i = 0; i < num_alive; ++i) {
+    const float cost = (*group)[i].EstimateCostMs();
+    if ((cost > 0.0) && ((best_cost == 0.0) || (cost < best_cost)))
+      best_cost = cost;
+  }
+  if (best_cost == 0.0)
+    return;
+  for (unsigned i = 0; i < num_alive; ++i) {
+    const float cost = (*group)[i].EstimateCostMs();
+    if (cost <= kProxyCostTolerance * best_cost)
+      continue;
+    const unsigned weight =
+      static_cast<unsigned>(kProxyMapScale * best_cost / cost);
+    (*weights)[i] = (weight > 0) ? weight : 1;
+  }
+}
+
 /**
  * Enable proxy sharding
  */
@@ -2704,6 +3855,7 @@ void DownloadManager::SwitchProxyGroup() {
   opt_proxy_groups_->size();
   opt_timestamp_backup_proxies_ = time(NULL);
   RebalanceProxiesUnlocked("switch proxy group");
+  RequestDnsRefreshUnlocked();
 }
 
 
@@ -2739,6 +3891,7 @@ void DownloadManager::SetRetryParameters(const unsigned max_retries,
 
 void DownloadManager::SetMaxIpaddrPerProxy(unsigned limit) {
   MutexLockGuard m(lock_options_);
+  MutexLockGuard m_resolver(lock_resolver_);
   resolver_->set_throttle(limit);
 }
 
@@ -2762,6 +3915,128 @@ void DownloadManager::EnableRedirects() {
   follow_redirects_ = true;
 }
 
+
+/**
+ * Requests HTTP/2 for https connections and lets concurrent requests to the
+ * same server share a connection.  Plain http connections, e.g. to a forward
+ * proxy, remain HTTP/1.1 with keep-alive.  Needs to be called before Spawn().
+ */
+void DownloadManager::EnableMultiplexing() {
+  assert(atomic_read32(&multi_threaded_) == 0);
+  curl_version_info_data *version = curl_version_info(CURLVERSION_NOW);
+  if (!(version->features & CURL_VERSION_HTTP2)) {
+    LogCvmfs(kLogDownload, kLogDebug | kLogSyslogWarn,
+             "libcurl %s does not support HTTP/2, multiplexing disabled",
+             version->version);
+  }
+  opt_multiplex_ = true;
+  for (unsigned i = 0; i < io_threads_.size(); ++i) {
+    curl_multi_setopt(io_threads_[i]->curl_multi, CURLMOPT_PIPELINING,
+                      CURLPIPE_MULTIPLEX);
+  }
+}
+
+
+/**
+ * Weights the choice of proxies within a load-balancing group by their
+ * measured RTT and throughput, see GetProxyWeightsUnlocked().
+ */
+void DownloadManager::EnableLatencyAwareProxies() {
+  MutexLockGuard m(lock_options_);
+  opt_proxy_latency_aware_ = true;
+  opt_timestamp_proxy_reweight_ = 0;
+  RebalanceProxiesUnlocked("enable latency-aware selection");
+}
+
+
+/**
+ * Asks every I/O thread to open connections to the current host through the
+ * current proxy group, so that the requests following a fail-over do not pay
+ * for the connection setup.  Called with the options mutex held, possibly by
+ * an I/O thread itself.  The pre-warm pipes are non-blocking: if one is full,
+ * a pre-warm is already pending for that thread and the request is dropped.
+ */
+void DownloadManager::RequestPrewarmUnlocked() {
+  if (!opt_multiplex_ || (atomic_read32(&multi_threaded_) == 0))
+    return;
+  char buf = 'P';
+  for (unsigned i = 0; i < io_threads_.size(); ++i) {
+    int retval;
+    do {
+      retval = write(io_threads_[i]->pipe_prewarm[1], &buf, 1);
+    } while ((retval < 0) && (errno == EINTR));
+  }
+}
+
+
+/**
+ * Adds a HEAD request for the manifest of the current host through every
+ * active proxy of the current group to the multi handle of the I/O thread.
+ * The requests have no JobInfo attached; the I/O thread drops them once they
+ * are done and keeps the connections.
+ */
+void DownloadManager::PrewarmConnections(IoThread *io_thread) {
+  string url;
+  vector<string> proxies;
+  unsigned timeout_proxy;
+  unsigned timeout_direct;
+  {
+    MutexLockGuard m(lock_options_);
+    if (!opt_host_chain_)
+      return;
+    url = (*opt_host_chain_)[opt_host_chain_current_] + "/.cvmfspublished";
+    vector<ProxyInfo> *group = current_proxy_group();
+    if (group) {
+      for (unsigned i = 0; i < group->size() - opt_proxy_groups_current_burned_;
+           ++i)
+      {
+        if ((*group)[i].url == "DIRECT") {
+          proxies.push_back("");
+        } else if ((*group)[i].host.status() == dns::kFailOk) {
+          proxies.push_back((*group)[i].url);
+        }
+      }
+    } else {
+      proxies.push_back("");
+    }
+    timeout_proxy = opt_timeout_proxy_;
+    timeout_direct = opt_timeout_direct_;
+  }
+  if (HasPrefix(url, "file://", false))
+    return;
+
+  for (unsigned i = 0; i < proxies.size(); ++i) {
+    CURL *handle = curl_easy_init();
+    assert(handle != NULL);
+    curl_easy_setopt(handle, CURLOPT_NOSIGNAL, 1);
+    curl_easy_setopt(handle, CURLOPT_HEADERFUNCTION, CallbackCurlDiscard);
+    curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, CallbackCurlDiscard);
+    curl_easy_setopt(handle, CURLOPT_NOBODY, 1);
+    curl_easy_setopt(handle, CURLOPT_PIPEWAIT, 1L);
+    curl_easy_setopt(handle, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+    curl_easy_setopt(handle, CURLOPT_HTTPHEADER, default_headers_);
+    curl_easy_setopt(handle, CURLOPT_PROXY, proxies[i].c_str());
+    curl_easy_setopt(handle, CURLOPT_CONNECTTIMEOUT,
+                     proxies[i].empty() ? timeout_direct : timeout_proxy);
+    curl_easy_setopt(handle, CURLOPT_TIMEOUT,
+                     proxies[i].empty() ? timeout_direct : timeout_proxy);
+    if (opt_ipv4_only_)
+      curl_easy_setopt(handle, CURLOPT_IPRESOLVE, CURL_IPRESOLVE_V4);
+    if (!opt_dns_server_.empty())
+      curl_easy_setopt(handle, CURLOPT_DNS_SERVERS, opt_dns_server_.c_str());
+    curl_easy_setopt(handle, CURLOPT_SSL_VERIFYPEER, 1L);
+    if (HasPrefix(url, "https", false))
+      ssl_certificate_store_.ApplySslCertificatePath(handle);
+    curl_easy_setopt(handle, CURLOPT_URL, EscapeUrl(url).c_str());
+
+    io_thread->pool_handles_inuse->insert(handle);
+    curl_multi_add_handle(io_thread->curl_multi, handle);
+    perf::Inc(counters_->n_prewarm);
+  }
+  LogCvmfs(kLogDownload, kLogDebug, "pre-warming %u connections to %s",
+           proxies.size(), url.c_str());
+}
+
 void DownloadManager::UseSystemCertificatePath() {
   ssl_certificate_store_.UseSystemCertificatePath();
 }
@@ -2788,8 +4063,16 @@ DownloadManager *DownloadManager::Clone(
   clone->opt_max_retries_ = opt_max_retries_;
   clone->opt_backoff_init_ms_ = opt_backoff_init_ms_;
   clone->opt_backoff_max_ms_ = opt_backoff_max_ms_;
+  clone->opt_num_io_threads_ = opt_num_io_threads_;
+  clone->opt_parallel_streams_ = opt_parallel_streams_;
+  clone->opt_parallel_threshold_ = opt_parallel_threshold_;
+  clone->opt_hedge_percentile_ = opt_hedge_percentile_;
+  clone->opt_hedge_budget_ = opt_hedge_budget_;
+  clone->opt_pipeline_threads_ = opt_pipeline_threads_;
   clone->enable_info_header_ = enable_info_header_;
   clone->follow_redirects_ = follow_redirects_;
+  if (opt_multiplex_)
+    clone->EnableMultiplexing();
   if (opt_host_chain_) {
     clone->opt_host_chain_ = new vector<string>(*opt_host_chain_);
     clone->opt_host_chain_rtt_ = new vector<int>(*opt_host_chain_rtt_);
@@ -2813,6 +4096,7 @@ void DownloadManager::CloneProxyConfig(DownloadManager *clone) {
   clone->opt_proxy_groups_fallback_ = opt_proxy_groups_fallback_;
   clone->opt_num_proxies_ = opt_num_proxies_;
   clone->opt_proxy_shard_ = opt_proxy_shard_;
+  clone->opt_proxy_latency_aware_ = opt_proxy_latency_aware_;
   clone->opt_proxy_list_ = opt_proxy_list_;
   clone->opt_proxy_fallback_list_ = opt_proxy_fallback_list_;
   if (opt_proxy_groups_ == NULL)
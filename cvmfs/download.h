@@ -23,6 +23,7 @@
 #include "dns.h"
 #include "duplex_curl.h"
 #include "hash.h"
+#include "ingestion/tube.h"
 #include "prng.h"
 #include "sink.h"
 #include "ssl.h"
@@ -131,6 +132,13 @@ struct Counters {
   perf::Counter *n_retries;
   perf::Counter *n_proxy_failover;
   perf::Counter *n_host_failover;
+  perf::Counter *n_connections;
+  perf::Counter *n_connection_reuses;
+  perf::Counter *n_http2_requests;
+  perf::Counter *n_prewarm;
+  perf::Counter *n_hedges;
+  perf::Counter *n_hedge_wins;
+  perf::Counter *n_dns_refresh;
 
   explicit Counters(perf::StatisticsTemplate statistics) {
     sz_transferred_bytes = statistics.RegisterTemplated("sz_transferred_bytes",
@@ -144,10 +152,26 @@ struct Counters {
         "Number of proxy failovers");
     n_host_failover = statistics.RegisterTemplated("n_host_failover",
         "Number of host failovers");
+    n_connections = statistics.RegisterTemplated("n_connections",
+        "Number of new connections");
+    n_connection_reuses = statistics.RegisterTemplated("n_connection_reuses",
+        "Number of requests on an existing connection");
+    n_http2_requests = statistics.RegisterTemplated("n_http2_requests",
+        "Number of requests that used HTTP/2");
+    n_prewarm = statistics.RegisterTemplated("n_prewarm",
+        "Number of connections pre-warmed after a fail-over");
+    n_hedges = statistics.RegisterTemplated("n_hedges",
+        "Number of duplicate requests sent for slow requests");
+    n_hedge_wins = statistics.RegisterTemplated("n_hedge_wins",
+        "Number of duplicate requests that completed first");
+    n_dns_refresh = statistics.RegisterTemplated("n_dns_refresh",
+        "Number of background name resolutions of the proxy group");
   }
 };  // Counters
 
 
+struct PipelineBlock;
+
 /**
  * Contains all the information to specify a download job.
  */
@@ -175,7 +199,8 @@ struct JobInfo {
   const shash::Any *expected_hash;
   const std::string *extra_info;
 
-  // Allow byte ranges to be specified.
+  // Allow byte ranges to be specified.  Without an offset, range_size can
+  // carry the size of the whole object if it is known.
   off_t range_offset;
   off_t range_size;
 
@@ -215,6 +240,12 @@ struct JobInfo {
     range_offset = -1;
     range_size = -1;
     http_code = -1;
+    start_ms = 0;
+    hedge = NULL;
+    hedge_primary = NULL;
+    pipeline = NULL;
+    pipeline_tag = 0;
+    atomic_init32(&pipeline_error);
   }
 
   // One constructor per destination + head request
@@ -298,9 +329,37 @@ struct JobInfo {
   unsigned char num_retries;
   unsigned backoff_ms;
   unsigned int current_host_chain_index;
+  uint64_t start_ms;  /**< Monotonic start time if hedging is enabled */
+  JobInfo *hedge;  /**< The duplicate request in flight, if any */
+  JobInfo *hedge_primary;  /**< Set for a duplicate, the original request */
+  /**
+   * If set, received data is hashed, decompressed, and written by a pipeline
+   * worker.  The worker records the first failure in pipeline_error.
+   */
+  TubeGroup<PipelineBlock> *pipeline;
+  uint32_t pipeline_tag;
+  atomic_int32 pipeline_error;
 };  // JobInfo
 
 
+/**
+ * A copy of a buffer received by curl for a transfer with a pipeline.  Blocks
+ * of the same transfer are processed in order by the same worker.  A block
+ * without data is a flush marker: the worker wakes up the flushed signal once
+ * it reaches the marker.
+ */
+struct PipelineBlock {
+  PipelineBlock(JobInfo *i, unsigned char *d, const size_t s, Signal *f)
+    : info(i), data(d), size(s), flushed(f) { }
+  int64_t tag() { return info->pipeline_tag; }
+
+  JobInfo *info;
+  unsigned char *data;
+  size_t size;
+  Signal *flushed;
+};
+
+
 /**
  * Manages blocks of arrays of curl_slist storing header strings.  In contrast
  * to curl's slists, these ones don't take ownership of the header strings.
@@ -355,18 +414,46 @@ class CredentialsAttachment {
 class DownloadManager {  // NOLINT(clang-analyzer-optin.performance.Padding)
   FRIEND_TEST(T_Download, ValidateGeoReply);
   FRIEND_TEST(T_Download, StripDirect);
+  FRIEND_TEST(T_Download, LatencyAwareProxies);
 
  public:
   struct ProxyInfo {
-    ProxyInfo() { }
-    explicit ProxyInfo(const std::string &url) : url(url) { }
+    ProxyInfo() : rtt_ms(0.0), throughput(0.0), num_samples(0) { }
+    explicit ProxyInfo(const std::string &url)
+      : url(url)
+      , rtt_ms(0.0)
+      , throughput(0.0)
+      , num_samples(0)
+    { }
     ProxyInfo(const dns::Host &host, const std::string &url)
       : host(host)
       , url(url)
+      , rtt_ms(0.0)
+      , throughput(0.0)
+      , num_samples(0)
     { }
     std::string Print();
+    /**
+     * Folds a completed transfer into the decayed estimates.  A throughput
+     * of zero means that the transfer was too small to measure it.
+     */
+    void AddSample(const float sample_rtt_ms, const float sample_throughput);
+    /**
+     * Expected time in milliseconds to fetch kProxyCostReferenceSize bytes,
+     * zero if nothing has been measured yet.
+     */
+    float EstimateCostMs() const;
     dns::Host host;
     std::string url;
+    /**
+     * Exponentially decayed time to the first byte of a response
+     */
+    float rtt_ms;
+    /**
+     * Exponentially decayed transfer speed in bytes per second
+     */
+    float throughput;
+    unsigned num_samples;
   };
 
   enum ProxySetModes {
@@ -396,7 +483,53 @@ class DownloadManager {  // NOLINT(clang-analyzer-optin.performance.Padding)
 
   static const unsigned kDnsDefaultRetries = 1;
   static const unsigned kDnsDefaultTimeoutMs = 3000;
+  /**
+   * Proxy names are resolved again in the background once less than
+   * 1/kDnsRefreshMarginDivisor of the minimum TTL remains.  The refresh
+   * thread resolves at most once per kDnsRefreshMinIntervalMs.
+   */
+  static const unsigned kDnsRefreshMarginDivisor = 4;
+  static const unsigned kDnsRefreshMinIntervalMs = 1000;
   static const unsigned kProxyMapScale = 16;
+  /**
+   * Per-proxy estimates are decayed by 1/kProxyEstimateDecay per sample.
+   */
+  static const unsigned kProxyEstimateDecay = 8;
+  /**
+   * Transfers smaller than that only contribute to the RTT estimate.
+   */
+  static const unsigned kProxyMinThroughputSize = 64 * 1024;
+  static const unsigned kProxyCostReferenceSize = 256 * 1024;
+  /**
+   * With latency-aware proxy selection, proxies whose expected cost is within
+   * kProxyCostTolerance times the cost of the best proxy are treated as equal.
+   */
+  static const unsigned kProxyCostTolerance = 2;
+  static const unsigned kProxyReweightIntervalSec = 30;
+  static const unsigned kMaxIoThreads = 64;
+  /**
+   * Size of the ranges of a parallel download.  At most one range per stream
+   * is kept in memory.
+   */
+  static const unsigned kParallelRangeSize = 8 * 1024 * 1024;
+  /**
+   * The hedging deadline is the configured percentile of the latencies of the
+   * last kHedgeWindow requests.  It is recomputed every kHedgeRefresh
+   * requests and used once there are kHedgeMinSamples measurements;
+   * before that, kHedgeDefaultDeadlineMs applies.
+   */
+  static const unsigned kHedgeWindow = 256;
+  static const unsigned kHedgeRefresh = 16;
+  static const unsigned kHedgeMinSamples = 16;
+  static const unsigned kHedgeMinDeadlineMs = 20;
+  static const unsigned kHedgeDefaultDeadlineMs = 1000;
+  static const unsigned kDefaultHedgeBudget = 5;
+  static const unsigned kMaxPipelineThreads = 64;
+  /**
+   * Number of received buffers (up to CURL_MAX_WRITE_SIZE each) that can be
+   * queued for a pipeline worker before the I/O thread blocks.
+   */
+  static const unsigned kPipelineTubeLimit = 256;
 
   DownloadManager();
   ~DownloadManager();
@@ -419,6 +552,10 @@ class DownloadManager {  // NOLINT(clang-analyzer-optin.performance.Padding)
   void SetTimeout(const unsigned seconds_proxy, const unsigned seconds_direct);
   void GetTimeout(unsigned *seconds_proxy, unsigned *seconds_direct);
   void SetLowSpeedLimit(const unsigned low_speed_limit);
+  void SetNumIoThreads(const unsigned num_io_threads);
+  void SetParallelRanges(const unsigned num_streams, const uint64_t threshold);
+  void SetHedging(const unsigned percentile, const unsigned budget_percent);
+  void SetPipelineThreads(const unsigned num_threads);
   void SetHostChain(const std::string &host_list);
   void SetHostChain(const std::vector<std::string> &host_list);
   void GetHostInfo(std::vector<std::string> *host_chain,
@@ -452,6 +589,8 @@ class DownloadManager {  // NOLINT(clang-analyzer-optin.performance.Padding)
   void SetProxyTemplates(const std::string &direct, const std::string &forced);
   void EnableInfoHeader();
   void EnableRedirects();
+  void EnableMultiplexing();
+  void EnableLatencyAwareProxies();
   void UseSystemCertificatePath();
 
   unsigned num_hosts() {
@@ -463,10 +602,45 @@ class DownloadManager {  // NOLINT(clang-analyzer-optin.performance.Padding)
     return opt_ip_preference_;
   }
 
+  unsigned num_io_threads() const { return opt_num_io_threads_; }
+  unsigned num_parallel_streams() const { return opt_parallel_streams_; }
+
  private:
+  /**
+   * Every I/O thread runs its own event loop on its own curl multi handle with
+   * its own pool of curl handles and connections.  Jobs are spread over the
+   * I/O threads by the hash of the object, so that the work in the curl
+   * callbacks (TLS, decompression, hashing) scales with the number of cores.
+   * The proxy and host fail-over state is shared and protected by
+   * lock_options_.  Before Spawn(), the first I/O thread's handles are used by
+   * the synchronous mode.
+   */
+  struct IoThread {
+    IoThread();
+    DownloadManager *download_mgr;
+    pthread_t thread;
+    CURLM *curl_multi;
+    std::set<CURL *> *pool_handles_idle;
+    std::set<CURL *> *pool_handles_inuse;
+    int pipe_jobs[2];
+    /**
+     * Non-blocking wake-up pipe for pre-warming connections
+     */
+    int pipe_prewarm[2];
+    struct pollfd *watch_fds;
+    uint32_t watch_fds_size;
+    uint32_t watch_fds_inuse;
+    /**
+     * Requests that can still be hedged once they exceed the deadline
+     */
+    std::set<JobInfo *> *hedge_candidates;
+  };
+
   static int CallbackCurlSocket(CURL *easy, curl_socket_t s, int action,
                                 void *userp, void *socketp);
   static void *MainDownload(void *data);
+  static void *MainDnsRefresh(void *data);
+  static void *MainPipeline(void *data);
 
   bool StripDirect(const std::string &proxy_list, std::string *cleaned_list);
   bool ValidateGeoReply(const std::string &reply_order,
@@ -476,19 +650,45 @@ class DownloadManager {  // NOLINT(clang-analyzer-optin.performance.Padding)
   void SwitchProxy(JobInfo *info);
   ProxyInfo *ChooseProxyUnlocked(const shash::Any *hash);
   void UpdateProxiesUnlocked(const std::string &reason);
+  void GetProxyWeightsUnlocked(const unsigned num_alive,
+                               std::vector<unsigned> *weights);
+  void UpdateProxyEstimates(CURL *handle, const std::string &proxy);
   void RebalanceProxiesUnlocked(const std::string &reason);
-  CURL *AcquireCurlHandle();
-  void ReleaseCurlHandle(CURL *handle);
+  IoThread *CreateIoThread(const unsigned max_connections);
+  void DestroyIoThread(IoThread *io_thread);
+  IoThread *SelectIoThread(const JobInfo *info);
+  bool IsParallelCandidate(const JobInfo *info);
+  Failures FetchParallel(JobInfo *info);
+  bool IsHedgeCandidate(const JobInfo *info);
+  bool StartHedges(IoThread *io_thread);
+  bool SetHedgeProxy(JobInfo *hedge, const std::string &primary_proxy);
+  bool FinishHedge(IoThread *io_thread, JobInfo *hedge, const int curl_error);
+  void CancelHedge(IoThread *io_thread, JobInfo *info);
+  void DeleteHedge(IoThread *io_thread, JobInfo *hedge);
+  void RecordLatency(const JobInfo *info);
+  bool ResetDestination(JobInfo *info);
+  bool IsPipelineCandidate(const JobInfo *info);
+  void FlushPipeline(JobInfo *info);
+  CURL *AcquireCurlHandle(IoThread *io_thread);
+  void ReleaseCurlHandle(IoThread *io_thread, CURL *handle);
+  void RequestPrewarmUnlocked();
+  void PrewarmConnections(IoThread *io_thread);
   void ReleaseCredential(JobInfo *info);
   void InitializeRequest(JobInfo *info, CURL *handle);
   void SetUrlOptions(JobInfo *info);
   bool ValidateProxyIpsUnlocked(const std::string &url, const dns::Host &host);
-  void UpdateStatistics(CURL *handle);
+  bool UpdateProxyHostUnlocked(const std::string &url,
+                               const dns::Host &host,
+                               const dns::Host &resolved_host);
+  void RequestDnsRefreshUnlocked();
+  int GetDnsRefreshTimeoutMs();
+  void RefreshProxyHosts();
+  void UpdateStatistics(CURL *handle, const JobInfo *info = NULL);
   bool CanRetry(const JobInfo *info);
   void Backoff(JobInfo *info);
   void SetNocache(JobInfo *info);
   void SetRegularCache(JobInfo *info);
-  bool VerifyAndFinalize(const int curl_error, JobInfo *info);
+  bool VerifyAndFinalize(int curl_error, JobInfo *info);
   void InitHeaders();
   void FiniHeaders();
   void CloneProxyConfig(DownloadManager *clone);
@@ -499,26 +699,34 @@ class DownloadManager {  // NOLINT(clang-analyzer-optin.performance.Padding)
   }
 
   Prng prng_;
-  std::set<CURL *> *pool_handles_idle_;
-  std::set<CURL *> *pool_handles_inuse_;
   uint32_t pool_max_handles_;
-  CURLM *curl_multi_;
+  /**
+   * Shared by the I/O threads, protected by lock_header_lists_
+   */
   HeaderLists *header_lists_;
   curl_slist *default_headers_;
   char *user_agent_;
 
-  pthread_t thread_download_;
+  std::vector<IoThread *> io_threads_;
   atomic_int32 multi_threaded_;
+  /**
+   * Written to once in Fini(), which terminates all the I/O threads
+   */
   int pipe_terminate_[2];
-
-  int pipe_jobs_[2];
-  struct pollfd *watch_fds_;
-  uint32_t watch_fds_size_;
-  uint32_t watch_fds_inuse_;
   uint32_t watch_fds_max_;
 
   pthread_mutex_t *lock_options_;
+  pthread_mutex_t *lock_header_lists_;
   pthread_mutex_t *lock_synchronous_mode_;
+  /**
+   * Protects the latency measurements used for hedging
+   */
+  pthread_mutex_t *lock_hedge_;
+  /**
+   * Serializes the use of resolver_, which is not thread-safe.  Can be
+   * acquired while holding lock_options_ but not the other way round.
+   */
+  pthread_mutex_t *lock_resolver_;
   std::string opt_dns_server_;
   unsigned opt_timeout_proxy_;
   unsigned opt_timeout_direct_;
@@ -526,9 +734,46 @@ class DownloadManager {  // NOLINT(clang-analyzer-optin.performance.Padding)
   unsigned opt_max_retries_;
   unsigned opt_backoff_init_ms_;
   unsigned opt_backoff_max_ms_;
+  unsigned opt_num_io_threads_;
+  /**
+   * Uncompressed downloads of known size of at least opt_parallel_threshold_
+   * bytes are split into ranges that are fetched by opt_parallel_streams_
+   * concurrent requests.  A single stream disables parallel downloads.
+   */
+  unsigned opt_parallel_streams_;
+  uint64_t opt_parallel_threshold_;
+  /**
+   * If a request takes longer than the opt_hedge_percentile_ percentile of the
+   * recent request latencies, a duplicate is sent through another proxy of the
+   * group.  The number of duplicates is limited to opt_hedge_budget_ percent
+   * of the requests.  A percentile of zero disables hedging.
+   */
+  unsigned opt_hedge_percentile_;
+  unsigned opt_hedge_budget_;
+  std::vector<uint32_t> hedge_latencies_;
+  uint64_t hedge_num_latencies_;
+  unsigned hedge_deadline_ms_;
+  /**
+   * With pipeline threads, hashing, decompression, and writing of the
+   * received data of file and sink downloads moves out of the I/O threads.
+   * Every worker has its own tube; the blocks of a transfer are dispatched to
+   * the same worker by the transfer's tag.  Zero threads disables the
+   * pipeline.
+   */
+  unsigned opt_pipeline_threads_;
+  TubeGroup<PipelineBlock> *pipeline_;
+  std::vector<Tube<PipelineBlock> *> pipeline_tubes_;
+  std::vector<pthread_t> pipeline_threads_;
+  atomic_int32 pipeline_next_tag_;
   bool enable_info_header_;
   bool opt_ipv4_only_;
   bool follow_redirects_;
+  /**
+   * Negotiate HTTP/2 where possible and multiplex concurrent requests to the
+   * same server over a single connection.  After a proxy or host fail-over,
+   * connections to the new proxy group and host are opened ahead of time.
+   */
+  bool opt_multiplex_;
 
   // Host list
   std::vector<std::string> *opt_host_chain_;
@@ -579,11 +824,23 @@ class DownloadManager {  // NOLINT(clang-analyzer-optin.performance.Padding)
    * Shard requests across multiple proxies via consistent hashing
    */
   bool opt_proxy_shard_;
+  /**
+   * Prefer proxies with a lower measured RTT and a higher throughput
+   */
+  bool opt_proxy_latency_aware_;
+  time_t opt_timestamp_proxy_reweight_;
 
   /**
    * Used to resolve proxy addresses (host addresses are resolved by the proxy).
    */
   dns::NormalResolver *resolver_;
+  /**
+   * In multi-threaded mode, expiring proxy names are resolved by a background
+   * thread while the transfers keep using the stale addresses.
+   */
+  pthread_t thread_dns_refresh_;
+  int pipe_dns_refresh_[2];
+  bool dns_refresh_requested_;
 
   /**
    * If a proxy has IPv4 and IPv6 addresses, which one to prefer
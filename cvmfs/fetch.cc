@@ -49,7 +49,6 @@ void TLSDestructor(void *data) {
  * removes the pointer to it from tls_blocks_.
  */
 void Fetcher::CleanupTls(ThreadLocalStorage *tls) {
-  ClosePipe(tls->pipe_wait);
   delete tls;
 }
 
@@ -65,7 +64,6 @@ Fetcher::ThreadLocalStorage *Fetcher::GetTls() {
 
   tls = new ThreadLocalStorage();
   tls->fetcher = this;
-  MakePipe(tls->pipe_wait);
   tls->download_job.destination = download::kDestinationSink;
   tls->download_job.compressed = true;
   tls->download_job.probe_hosts = true;
@@ -86,7 +84,8 @@ int Fetcher::Fetch(
   const zlib::Algorithms compression_algorithm,
   const CacheManager::ObjectType object_type,
   const std::string &alt_url,
-  off_t range_offset)
+  off_t range_offset,
+  off_t range_size)
 {
   int fd_return;  // Read-only file descriptor that is returned
   int retval;
@@ -102,15 +101,13 @@ int Fetcher::Fetch(
   ThreadLocalStorage *tls = GetTls();
 
   // Synchronization point: either act as a master thread for this object or
-  // enqueue to the list of waiting threads.
-  pthread_mutex_lock(lock_queues_download_);
-  ThreadQueues::iterator iDownloadQueue = queues_download_.find(id);
-  if (iDownloadQueue != queues_download_.end()) {
+  // wait for the download of another thread.
+  pthread_mutex_lock(lock_inflight_downloads_);
+  InflightDownloads::iterator iDownload = inflight_downloads_.find(id);
+  if (iDownload != inflight_downloads_.end()) {
     LogCvmfs(kLogCache, kLogDebug, "waiting for download of %s", name.c_str());
-
-    iDownloadQueue->second->push_back(tls->pipe_wait[1]);
-    pthread_mutex_unlock(lock_queues_download_);
-    ReadPipe(tls->pipe_wait[0], &fd_return, sizeof(int));
+    fd_return = WaitForDownload(iDownload->second);
+    pthread_mutex_unlock(lock_inflight_downloads_);
 
     LogCvmfs(kLogCache, kLogDebug, "received from another thread fd %d for %s",
              fd_return, name.c_str());
@@ -119,13 +116,12 @@ int Fetcher::Fetch(
     // Seems we are the first one, check again in the cache (race condition)
     fd_return = OpenSelect(id, name, object_type);
     if (fd_return >= 0) {
-      pthread_mutex_unlock(lock_queues_download_);
+      pthread_mutex_unlock(lock_inflight_downloads_);
       return fd_return;
     }
 
-    // Create a new queue for this chunk
-    queues_download_[id] = &tls->other_pipes_waiting;
-    pthread_mutex_unlock(lock_queues_download_);
+    inflight_downloads_[id] = new InflightDownload();
+    pthread_mutex_unlock(lock_inflight_downloads_);
   }
 
   perf::Inc(n_downloads);
@@ -143,7 +139,7 @@ int Fetcher::Fetch(
   if (retval < 0) {
     LogCvmfs(kLogCache, kLogDebug, "could not start transaction on %s",
              name.c_str());
-    SignalWaitingThreads(retval, id, tls);
+    SignalWaitingThreads(retval, id);
     return retval;
   }
   cache_mgr_->CtrlTxn(CacheManager::ObjectInfo(object_type, name), 0, txn);
@@ -163,7 +159,8 @@ int Fetcher::Fetch(
   }
   tls->download_job.compressed = (compression_algorithm == zlib::kZlibDefault);
   tls->download_job.range_offset = range_offset;
-  tls->download_job.range_size = size;
+  // For compressed ranges, size is the size of the uncompressed object
+  tls->download_job.range_size = (range_size >= 0) ? range_size : size;
   download_mgr_->Fetch(&tls->download_job);
 
   if (tls->download_job.error_code == download::kFailOk) {
@@ -172,17 +169,17 @@ int Fetcher::Fetch(
     fd_return = cache_mgr_->OpenFromTxn(txn);
     if (fd_return < 0) {
       cache_mgr_->AbortTxn(txn);
-      SignalWaitingThreads(fd_return, id, tls);
+      SignalWaitingThreads(fd_return, id);
       return fd_return;
     }
 
     retval = cache_mgr_->CommitTxn(txn);
     if (retval < 0) {
       cache_mgr_->Close(fd_return);
-      SignalWaitingThreads(retval, id, tls);
+      SignalWaitingThreads(retval, id);
       return retval;
     }
-    SignalWaitingThreads(fd_return, id, tls);
+    SignalWaitingThreads(fd_return, id);
     return fd_return;
   }
 
@@ -193,7 +190,7 @@ int Fetcher::Fetch(
            download::Code2Ascii(tls->download_job.error_code));
   cache_mgr_->AbortTxn(txn);
   backoff_throttle_->Throttle();
-  SignalWaitingThreads(-EIO, id, tls);
+  SignalWaitingThreads(-EIO, id);
   return -EIO;
 }
 
@@ -205,7 +202,7 @@ Fetcher::Fetcher(
   perf::StatisticsTemplate statistics,
   bool external)
   : external_(external)
-  , lock_queues_download_(NULL)
+  , lock_inflight_downloads_(NULL)
   , lock_tls_blocks_(NULL)
   , cache_mgr_(cache_mgr)
   , download_mgr_(download_mgr)
@@ -214,9 +211,9 @@ Fetcher::Fetcher(
   int retval;
   retval = pthread_key_create(&thread_local_storage_, TLSDestructor);
   assert(retval == 0);
-  lock_queues_download_ = reinterpret_cast<pthread_mutex_t *>(
+  lock_inflight_downloads_ = reinterpret_cast<pthread_mutex_t *>(
     smalloc(sizeof(pthread_mutex_t)));
-  retval = pthread_mutex_init(lock_queues_download_, NULL);
+  retval = pthread_mutex_init(lock_inflight_downloads_, NULL);
   assert(retval == 0);
   lock_tls_blocks_ = reinterpret_cast<pthread_mutex_t *>(
     smalloc(sizeof(pthread_mutex_t)));
@@ -226,6 +223,8 @@ Fetcher::Fetcher(
     "overall number of downloaded files (incl. catalogs, chunks)");
   n_invocations = statistics.RegisterTemplated("n_invocations",
     "overall number of object requests (incl. catalogs, chunks)");
+  n_waiters = statistics.RegisterTemplated("n_waiters",
+    "overall number of object requests that waited for a concurrent download");
 }
 
 
@@ -242,9 +241,9 @@ Fetcher::~Fetcher() {
   assert(retval == 0);
   free(lock_tls_blocks_);
 
-  retval = pthread_mutex_destroy(lock_queues_download_);
+  retval = pthread_mutex_destroy(lock_inflight_downloads_);
   assert(retval == 0);
-  free(lock_queues_download_);
+  free(lock_inflight_downloads_);
 
   retval = pthread_key_delete(thread_local_storage_);
   assert(retval == 0);
@@ -269,18 +268,67 @@ int Fetcher::OpenSelect(
 }
 
 
-void Fetcher::SignalWaitingThreads(
-  const int fd,
-  const shash::Any &id,
-  ThreadLocalStorage *tls)
-{
-  MutexLockGuard m(lock_queues_download_);
-  for (unsigned i = 0, s = tls->other_pipes_waiting.size(); i < s; ++i) {
-    int fd_dup = (fd >= 0) ? cache_mgr_->Dup(fd) : fd;
-    WritePipe(tls->other_pipes_waiting[i], &fd_dup, sizeof(int));
+/**
+ * Publishes the result of a download to the threads waiting for it.  Waiting
+ * threads get a duplicate of fd or the error code.
+ */
+void Fetcher::SignalWaitingThreads(const int fd, const shash::Any &id) {
+  MutexLockGuard m(lock_inflight_downloads_);
+  InflightDownloads::iterator iDownload = inflight_downloads_.find(id);
+  assert(iDownload != inflight_downloads_.end());
+  InflightDownload *download = iDownload->second;
+  inflight_downloads_.erase(iDownload);
+
+  assert(download->refcnt > 0);
+  if (--download->refcnt == 0) {
+    delete download;
+    return;
+  }
+  download->result = (fd >= 0) ? cache_mgr_->Dup(fd) : fd;
+  download->done = true;
+  int retval = pthread_cond_broadcast(&download->cond_done);
+  assert(retval == 0);
+}
+
+
+/**
+ * Blocks until the downloading thread published the result.  Needs to be
+ * called with lock_inflight_downloads_ held.
+ */
+int Fetcher::WaitForDownload(InflightDownload *download) {
+  perf::Inc(n_waiters);
+  download->refcnt++;
+  while (!download->done) {
+    int retval = pthread_cond_wait(&download->cond_done,
+                                   lock_inflight_downloads_);
+    assert(retval == 0);
   }
-  tls->other_pipes_waiting.clear();
-  queues_download_.erase(id);
+
+  int fd;
+  if (--download->refcnt == 0) {
+    fd = download->result;
+    delete download;
+  } else {
+    fd = (download->result >= 0) ?
+         cache_mgr_->Dup(download->result) : download->result;
+  }
+  return fd;
+}
+
+
+Fetcher::InflightDownload::InflightDownload()
+  : done(false)
+  , result(-1)
+  , refcnt(1)
+{
+  int retval = pthread_cond_init(&cond_done, NULL);
+  assert(retval == 0);
+}
+
+
+Fetcher::InflightDownload::~InflightDownload() {
+  int retval = pthread_cond_destroy(&cond_done);
+  assert(retval == 0);
 }
 
 }  // namespace cvmfs
@@ -61,9 +61,12 @@ class TransactionSink : public Sink {
 class Fetcher : SingleCopy {
   FRIEND_TEST(T_Fetcher, GetTls);
   FRIEND_TEST(T_Fetcher, SignalWaitingThreads);
+  FRIEND_TEST(T_Fetcher, WaitForDownload);
   friend void *TestGetTls(void *data);
   friend void *TestFetchCollapse(void *data);
   friend void *TestFetchCollapse2(void *data);
+  friend void *TestWaitForDownload(void *data);
+  friend struct TestWaitForDownloadInfo;
   friend void TLSDestructor(void *data);
 
  public:
@@ -80,38 +83,20 @@ class Fetcher : SingleCopy {
             const zlib::Algorithms compression_algorithm,
             const CacheManager::ObjectType object_type,
             const std::string &alt_url = "",
-            off_t range_offset = -1);
+            off_t range_offset = -1,
+            off_t range_size = -1);
 
   CacheManager *cache_mgr() { return cache_mgr_; }
   download::DownloadManager *download_mgr() { return download_mgr_; }
 
  private:
-  /**
-   * Multiple threads might want to download the same object at the same time.
-   * If that happens, only the first thread performs the download.  The other
-   * threads wait on a pipe for a notification from the first thread.
-   */
   struct ThreadLocalStorage {
-    ThreadLocalStorage() {
-      pipe_wait[0] = -1;
-      pipe_wait[1] = -1;
-      fetcher = NULL;
-    }
+    ThreadLocalStorage() : fetcher(NULL) { }
 
     /**
      * Used during cleanup to find tls_blocks_.
      */
     Fetcher *fetcher;
-    /**
-     * Wait on the reading end if another thread is already downloading the same
-     * object.
-     */
-    int pipe_wait[2];
-    /**
-     * Writer ends of all the pipes of threads that want to download the same
-     * object.
-     */
-    std::vector<int> other_pipes_waiting;
     /**
      * It is sufficient to construct the JobInfo object once per thread, not
      * on every call to Fetch().
@@ -120,17 +105,40 @@ class Fetcher : SingleCopy {
   };
 
   /**
-   * Maps currently downloaded chunks to the other_pipes_waiting member of the
-   * thread local storage of the downloading thread.  This way, a thread can
-   * enqueue itself to such an other_pipes_waiting list and gets informed when
-   * the download is completed.
+   * Multiple threads might want to download the same object at the same time.
+   * If that happens, only the first thread performs the download.  The other
+   * threads wait on the condition variable of the download until the first
+   * thread publishes the result.
+   *
+   * The downloading thread holds one reference until it publishes the result,
+   * every waiting thread holds one reference until it took its file
+   * descriptor.  The last waiting thread takes over the file descriptor of the
+   * entry, the others get a duplicate of it.  All fields are protected by
+   * lock_inflight_downloads_.
+   */
+  struct InflightDownload {
+    InflightDownload();
+    ~InflightDownload();
+
+    pthread_cond_t cond_done;
+    bool done;
+    /**
+     * File descriptor for the waiting threads or negative error code
+     */
+    int result;
+    unsigned refcnt;
+  };
+
+  /**
+   * Maps the ids of the objects that are currently downloaded to their
+   * in-flight entry.
    */
-  typedef std::map< shash::Any, std::vector<int> * > ThreadQueues;
+  typedef std::map<shash::Any, InflightDownload *> InflightDownloads;
 
   ThreadLocalStorage *GetTls();
   void CleanupTls(ThreadLocalStorage *tls);
-  void SignalWaitingThreads(const int fd, const shash::Any &id,
-                            ThreadLocalStorage *tls);
+  int WaitForDownload(InflightDownload *download);
+  void SignalWaitingThreads(const int fd, const shash::Any &id);
   int OpenSelect(const shash::Any &id,
                  const std::string &name,
                  const CacheManager::ObjectType object_type);
@@ -147,8 +155,8 @@ class Fetcher : SingleCopy {
    */
   pthread_key_t thread_local_storage_;
 
-  ThreadQueues queues_download_;
-  pthread_mutex_t *lock_queues_download_;
+  InflightDownloads inflight_downloads_;
+  pthread_mutex_t *lock_inflight_downloads_;
 
   /**
    * All the threads register their thread local storage here, so that it can
@@ -162,6 +170,7 @@ class Fetcher : SingleCopy {
   BackoffThrottle *backoff_throttle_;
   perf::Counter *n_downloads;
   perf::Counter *n_invocations;
+  perf::Counter *n_waiters;
 };
 
 }  // namespace cvmfs
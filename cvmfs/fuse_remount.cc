@@ -82,10 +82,15 @@ FuseRemounter::Status FuseRemounter::Check() {
   }
 
   LogCvmfs(kLogCvmfs, kLogDebug, "remounting root catalog");
-  catalog::LoadError retval = mountpoint_->catalog_mgr()->Remount(true);
+  shash::Any root_hash;
+  catalog::LoadError retval =
+    mountpoint_->catalog_mgr()->Remount(true, &root_hash);
   switch (retval) {
     case catalog::kLoadNew:
       SetOfflineMode(false);
+      // Fetch the changed catalogs while the old revision is still served
+      if (atomic_read32(&drainout_mode_) == 0)
+        mountpoint_->catalog_mgr()->PrestageCatalogs(root_hash);
       if (atomic_cas32(&drainout_mode_, 0, 1)) {
         // As of this point, fuse callbacks return zero as cache timeout
         LogCvmfs(kLogCvmfs, kLogDebug,
@@ -14,8 +14,10 @@
 #include <openssl/sha.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <cstdio>
 #include <cstring>
+#include <vector>
 
 #include "duplex_ssl.h"
 #include "util/exception.h"
@@ -252,6 +254,268 @@ void Final(ContextPtr context, Any *any_digest) {
 }
 
 
+//------------------------------------------------------------------------------
+
+
+namespace {
+
+/**
+ * SHA-1 streams that are hashed in lock step share a SIMD register, one
+ * stream per lane.  The vector types rely on the GCC/clang vector extensions.
+ */
+const unsigned kSha1BlockSize = 64;
+typedef uint32_t Sha1Vec4 __attribute__((vector_size(16)));
+typedef uint32_t Sha1Vec8 __attribute__((vector_size(32)));
+
+// A macro rather than a function, so that the 256 bit vectors are never
+// passed by value outside of AVX2 code
+#define SHA1_ROTL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+inline uint32_t LoadBigEndian32(const unsigned char *p) {
+  return (static_cast<uint32_t>(p[0]) << 24) |
+         (static_cast<uint32_t>(p[1]) << 16) |
+         (static_cast<uint32_t>(p[2]) << 8) |
+         static_cast<uint32_t>(p[3]);
+}
+
+/**
+ * Runs num_blocks SHA-1 compressions on NumLanes streams at once.  state holds
+ * the five chaining values of all lanes, h0 of every lane first.
+ */
+template <typename VecT, unsigned NumLanes>
+inline __attribute__((always_inline)) void Sha1CompressLanes(
+  uint32_t *state,
+  const unsigned char * const *data,
+  const uint64_t num_blocks)
+{
+  VecT h[5];
+  memcpy(h, state, sizeof(h));
+  for (uint64_t block = 0; block < num_blocks; ++block) {
+    VecT w[16];
+    for (unsigned t = 0; t < 16; ++t) {
+      for (unsigned l = 0; l < NumLanes; ++l)
+        w[t][l] = LoadBigEndian32(data[l] + block * kSha1BlockSize + 4 * t);
+    }
+    VecT a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+#define SHA1_ROUND(t, f, k) { \
+      if ((t) >= 16) { \
+        w[(t) & 15] = SHA1_ROTL(w[((t) + 13) & 15] ^ w[((t) + 8) & 15] ^ \
+                                w[((t) + 2) & 15] ^ w[(t) & 15], 1); \
+      } \
+      const VecT tmp = SHA1_ROTL(a, 5) + (f) + e + (k) + w[(t) & 15]; \
+      e = d; \
+      d = c; \
+      c = SHA1_ROTL(b, 30); \
+      b = a; \
+      a = tmp; \
+    }
+    for (unsigned t = 0; t < 20; ++t)
+      SHA1_ROUND(t, d ^ (b & (c ^ d)), 0x5A827999)
+    for (unsigned t = 20; t < 40; ++t)
+      SHA1_ROUND(t, b ^ c ^ d, 0x6ED9EBA1)
+    for (unsigned t = 40; t < 60; ++t)
+      SHA1_ROUND(t, (b & c) | (d & (b | c)), 0x8F1BBCDC)
+    for (unsigned t = 60; t < 80; ++t)
+      SHA1_ROUND(t, b ^ c ^ d, 0xCA62C1D6)
+#undef SHA1_ROUND
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
+    h[4] += e;
+  }
+  memcpy(state, h, sizeof(h));
+}
+
+#undef SHA1_ROTL
+
+void Sha1Compress4(uint32_t *state, const unsigned char * const *data,
+                   const uint64_t num_blocks)
+{
+  Sha1CompressLanes<Sha1Vec4, 4>(state, data, num_blocks);
+}
+
+#ifdef __x86_64__
+__attribute__((target("avx2")))
+void Sha1Compress8(uint32_t *state, const unsigned char * const *data,
+                   const uint64_t num_blocks)
+{
+  Sha1CompressLanes<Sha1Vec8, 8>(state, data, num_blocks);
+}
+#endif
+
+/**
+ * OpenSSL by default.  Measured on a CPU with SHA extensions, OpenSSL hashes
+ * twice as fast as 4 SSE2 lanes; the lanes have yet to be shown to pay off on
+ * any CPU.
+ */
+unsigned g_multi_buffer_lanes = 1;
+
+/**
+ * A stream of whole SHA-1 blocks that is processed in a lane.
+ */
+struct Sha1Stream {
+  SHA_CTX *ctx;
+  const unsigned char *data;
+  uint64_t num_blocks;
+  const unsigned char *tail;
+  unsigned tail_length;
+};
+
+void Sha1AddLength(SHA_CTX *ctx, const uint64_t num_bytes) {
+  const uint64_t length = ((static_cast<uint64_t>(ctx->Nh) << 32) | ctx->Nl) +
+                          (num_bytes << 3);
+  ctx->Nl = static_cast<uint32_t>(length);
+  ctx->Nh = static_cast<uint32_t>(length >> 32);
+}
+
+/**
+ * Hashes the whole blocks of the streams, NumLanes streams at a time.  Lanes
+ * proceed by the smallest number of remaining blocks; a lane that finished is
+ * refilled with the next stream.  The last stream is finished by OpenSSL.
+ */
+template <unsigned NumLanes>
+void Sha1UpdateLanes(
+  std::vector<Sha1Stream> *streams,
+  void (*compress)(uint32_t *, const unsigned char * const *, const uint64_t))
+{
+  unsigned next = 0;
+  Sha1Stream *lanes[NumLanes];
+  unsigned num_active = 0;
+  while (true) {
+    while ((num_active < NumLanes) && (next < streams->size()))
+      lanes[num_active++] = &(*streams)[next++];
+    if (num_active < 2)
+      break;
+
+    uint32_t state[5 * NumLanes];
+    const unsigned char *data[NumLanes];
+    uint64_t num_blocks = uint64_t(-1);
+    for (unsigned l = 0; l < NumLanes; ++l) {
+      // Unused lanes repeat the first stream, their result is discarded
+      Sha1Stream *s = lanes[(l < num_active) ? l : 0];
+      state[0 * NumLanes + l] = s->ctx->h0;
+      state[1 * NumLanes + l] = s->ctx->h1;
+      state[2 * NumLanes + l] = s->ctx->h2;
+      state[3 * NumLanes + l] = s->ctx->h3;
+      state[4 * NumLanes + l] = s->ctx->h4;
+      data[l] = s->data;
+      if (s->num_blocks < num_blocks)
+        num_blocks = s->num_blocks;
+    }
+    compress(state, data, num_blocks);
+
+    unsigned num_remaining = 0;
+    for (unsigned l = 0; l < num_active; ++l) {
+      Sha1Stream *s = lanes[l];
+      s->ctx->h0 = state[0 * NumLanes + l];
+      s->ctx->h1 = state[1 * NumLanes + l];
+      s->ctx->h2 = state[2 * NumLanes + l];
+      s->ctx->h3 = state[3 * NumLanes + l];
+      s->ctx->h4 = state[4 * NumLanes + l];
+      Sha1AddLength(s->ctx, num_blocks * kSha1BlockSize);
+      s->data += num_blocks * kSha1BlockSize;
+      s->num_blocks -= num_blocks;
+      if (s->num_blocks > 0)
+        lanes[num_remaining++] = s;
+    }
+    num_active = num_remaining;
+  }
+  for (unsigned l = 0; l < num_active; ++l) {
+    SHA1_Update(lanes[l]->ctx, lanes[l]->data,
+                lanes[l]->num_blocks * kSha1BlockSize);
+  }
+}
+
+}  // anonymous namespace
+
+
+unsigned GetMultiBufferLanes() {
+  return g_multi_buffer_lanes;
+}
+
+
+void SetMultiBufferLanes(const unsigned num_lanes) {
+  switch (num_lanes) {
+    case 1:
+    case 4:
+      g_multi_buffer_lanes = num_lanes;
+      break;
+    case 8:
+#ifdef __x86_64__
+      __builtin_cpu_init();
+      if (__builtin_cpu_supports("avx2")) {
+        g_multi_buffer_lanes = 8;
+        break;
+      }
+#endif
+      g_multi_buffer_lanes = 4;
+      break;
+    default:
+      g_multi_buffer_lanes = 1;
+  }
+}
+
+
+void UpdateMulti(
+  const unsigned char * const *buffers,
+  const unsigned *buffer_lengths,
+  const ContextPtr *contexts,
+  const unsigned num_streams)
+{
+  const unsigned num_lanes = GetMultiBufferLanes();
+  std::vector<Sha1Stream> sha1_streams;
+  for (unsigned i = 0; i < num_streams; ++i) {
+    if ((num_lanes == 1) || (contexts[i].algorithm != kSha1)) {
+      Update(buffers[i], buffer_lengths[i], contexts[i]);
+      continue;
+    }
+
+    assert(contexts[i].size == sizeof(SHA_CTX));
+    SHA_CTX *ctx = reinterpret_cast<SHA_CTX *>(contexts[i].buffer);
+    const unsigned char *data = buffers[i];
+    unsigned length = buffer_lengths[i];
+    // Complete a partial block of a previous update first
+    if (ctx->num > 0) {
+      const unsigned head = std::min(length, kSha1BlockSize - ctx->num);
+      SHA1_Update(ctx, data, head);
+      data += head;
+      length -= head;
+    }
+    if (length >= kSha1BlockSize) {
+      Sha1Stream stream;
+      stream.ctx = ctx;
+      stream.data = data;
+      stream.num_blocks = length / kSha1BlockSize;
+      stream.tail = data + stream.num_blocks * kSha1BlockSize;
+      stream.tail_length = length % kSha1BlockSize;
+      sha1_streams.push_back(stream);
+    } else if (length > 0) {
+      SHA1_Update(ctx, data, length);
+    }
+  }
+  if (sha1_streams.empty())
+    return;
+
+#ifdef __x86_64__
+  if (num_lanes == 8)
+    Sha1UpdateLanes<8>(&sha1_streams, Sha1Compress8);
+  else
+    Sha1UpdateLanes<4>(&sha1_streams, Sha1Compress4);
+#else
+  Sha1UpdateLanes<4>(&sha1_streams, Sha1Compress4);
+#endif
+
+  // The remaining bytes of each stream start a new block
+  for (unsigned i = 0; i < sha1_streams.size(); ++i) {
+    if (sha1_streams[i].tail_length > 0) {
+      SHA1_Update(sha1_streams[i].ctx, sha1_streams[i].tail,
+                  sha1_streams[i].tail_length);
+    }
+  }
+}
+
+
 void HashMem(const unsigned char *buffer, const unsigned buffer_size,
              Any *any_digest)
 {
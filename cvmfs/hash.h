@@ -57,6 +57,7 @@ const char kSuffixPartial      = 'P';
 const char kSuffixTemporary    = 'T';
 const char kSuffixCertificate  = 'X';
 const char kSuffixMetainfo     = 'M';
+const char kSuffixPagedCatalog = 'G';  // index of a paged catalog
 
 
 /**
@@ -512,6 +513,26 @@ void Init(ContextPtr context);
 void Update(const unsigned char *buffer, const unsigned buffer_size,
             ContextPtr context);
 void Final(ContextPtr context, Any *any_digest);
+/**
+ * Equivalent to calling Update() for every buffer and its context, which
+ * must be distinct.  SHA-1 streams are interleaved in SIMD lanes (4 lanes with
+ * SSE2, 8 lanes with AVX2), other algorithms are updated one by one.  Pays off
+ * if the buffers span at least a few 64 byte blocks.
+ */
+void UpdateMulti(const unsigned char * const *buffers,
+                 const unsigned *buffer_lengths,
+                 const ContextPtr *contexts,
+                 const unsigned num_streams);
+/**
+ * The number of SHA-1 lanes used by UpdateMulti().  1 by default, i.e. the
+ * streams are updated one by one by OpenSSL.
+ */
+unsigned GetMultiBufferLanes();
+/**
+ * For tests and benchmarks: forces 1, 4, or 8 lanes (8 falls back to 4
+ * without AVX2).  Other values restore the default.
+ */
+void SetMultiBufferLanes(const unsigned num_lanes);
 bool HashFile(const std::string &filename, Any *any_digest);
 bool HashFd(int fd, Any *any_digest);
 void HashMem(const unsigned char *buffer, const unsigned buffer_size,
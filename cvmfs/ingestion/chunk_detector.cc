@@ -12,6 +12,52 @@
 #include "ingestion/item.h"
 
 
+bool ParseChunkingAlgorithm(const std::string &name,
+                            ChunkingAlgorithms *algorithm)
+{
+  if (name == "xor32") {
+    *algorithm = kChunkingXor32;
+    return true;
+  }
+  if (name == "fastcdc") {
+    *algorithm = kChunkingFastCdc;
+    return true;
+  }
+  return false;
+}
+
+
+std::string ChunkingAlgorithmName(const ChunkingAlgorithms algorithm) {
+  switch (algorithm) {
+    case kChunkingXor32:
+      return "xor32";
+    case kChunkingFastCdc:
+      return "fastcdc";
+    // Purposely no default statement, so that the compiler warns about new
+    // algorithms that are not handled
+  }
+  return "unknown";
+}
+
+
+ChunkDetector *ChunkDetector::Construct(
+  const ChunkingAlgorithms algorithm,
+  const uint64_t minimal_chunk_size,
+  const uint64_t average_chunk_size,
+  const uint64_t maximal_chunk_size)
+{
+  switch (algorithm) {
+    case kChunkingFastCdc:
+      return new FastCdcDetector(minimal_chunk_size, average_chunk_size,
+                                 maximal_chunk_size);
+    case kChunkingXor32:
+    default:
+      return new Xor32Detector(minimal_chunk_size, average_chunk_size,
+                               maximal_chunk_size);
+  }
+}
+
+
 uint64_t ChunkDetector::FindNextCutMark(BlockItem *block) {
   uint64_t result = DoFindNextCutMark(block);
   if (result == 0)
@@ -135,3 +181,221 @@ uint64_t Xor32Detector::DoFindNextCutMark(BlockItem *buffer) {
     return NoCut(internal_offset + offset());
   }
 }
+
+
+//------------------------------------------------------------------------------
+
+
+// Random values that map bytes to gear hash summands.  You should never change
+// this table, since it affects the definition of cut marks.
+const uint32_t FastCdcDetector::kGearTable[256] = {
+  0x92CA2F0E, 0x3CD6E3F3, 0x1B147DCC, 0x4C081DBF, 0x487981AB, 0xDB408C9D,
+  0x78BC1B8F, 0xD83072E5, 0x65CBDD54, 0x1F4B8CEF, 0x91783BB0, 0x0231739B,
+  0x2AA96DD0, 0xB42BC0B0, 0x04E90BF5, 0xE2AD51BA, 0x79F70494, 0x010B6880,
+  0xA4523835, 0xCEEB36B7, 0xD939FF68, 0xB18C6441, 0xDD507B42, 0x5DB59265,
+  0x33469494, 0xA65D9B7A, 0x57DCB96B, 0x1B486183, 0xE411DDC1, 0x3E2CF241,
+  0x9E2EA24F, 0xB7FBE3E5, 0xA452933A, 0x1E712332, 0x52DF2E19, 0x336BD315,
+  0x56D396D2, 0xF857A331, 0x4FE97DA7, 0x9B972A46, 0x9D3E0D8A, 0xA6ECE606,
+  0xC5C7990C, 0x17D886BF, 0x62CE7C21, 0x827E3843, 0xB9D7427C, 0x17891EA1,
+  0xD0F0E17A, 0x5139A741, 0xA3D32F02, 0xDB12A15C, 0x13B3ABCF, 0x730C5F25,
+  0x1DB71420, 0xF9435A88, 0x51EE6AF8, 0xAF1EA67F, 0x71D9CB92, 0x3E2C1C4E,
+  0x1D6722CF, 0xF9D656F3, 0x2F16C17E, 0xF8262992, 0x8E0CE9DF, 0xAE71F440,
+  0x578EC0A1, 0xFF95D72E, 0x09B28281, 0xAF7E56B5, 0x535A0944, 0xB7E2D8D3,
+  0xF5E7B311, 0x974B2094, 0xC73099C2, 0xB361D660, 0x171C8432, 0x7263CAD3,
+  0xC661216E, 0xB1A0EBCA, 0x6B48AA35, 0x6ED7A14A, 0xE1FEF49F, 0x86A1C4E4,
+  0xF918B5F7, 0x8A927E91, 0xCB840F04, 0xEDDFC8E4, 0xC6A57EEA, 0x52FB3D10,
+  0xA57C5997, 0x2B1613BC, 0x8A6D276D, 0x0207F551, 0xE7A5E850, 0x13CEA631,
+  0x1E8C037E, 0xF2EBE3A2, 0xEE6E1AC7, 0x45516E65, 0xF23F1FC4, 0x40F455EB,
+  0xDC72791B, 0xFC0DF56D, 0xB81049B8, 0x68F4A814, 0x7740174D, 0x8FD60C81,
+  0x59D7D340, 0xF20F0D94, 0xB28913B6, 0x5B53B292, 0x85F6B629, 0xF4E7D086,
+  0x8D4F664D, 0x5DEAC120, 0xE12DE03B, 0x180E3AC5, 0x53B4B547, 0x95236D9E,
+  0xD640B398, 0x121A5DE7, 0x00D4705E, 0xF3ADADE7, 0x394B58D3, 0x0846CD67,
+  0x263FC0DC, 0x7740D790, 0xEA96DBEE, 0xC9475489, 0xD59585DE, 0x31A2AAED,
+  0x27ED7197, 0x5F277BB1, 0x99EB0BC5, 0xFF2AAE5C, 0xDA5A360C, 0x0AA75661,
+  0x649CB1B3, 0x5EFDAD6B, 0xDD4F68D4, 0x86A72CA7, 0x4201F089, 0xC0CF4C58,
+  0x4111E2D2, 0x656DB74E, 0x20C923AD, 0x0B1FEAE4, 0x11FC38AF, 0x75C2DE95,
+  0x46511EE8, 0x1051AB6B, 0x5124132D, 0xA2BCF41C, 0x780A25CA, 0xA77AB8EF,
+  0x7568DCF2, 0x0AE6D15B, 0xCA78A349, 0xB44BD742, 0x7582DF18, 0x5411A023,
+  0x5A24EC5C, 0x1B86ACB9, 0xE3045CF5, 0xC3FCE93E, 0x68E0E9D5, 0xB134A60D,
+  0x473EC5B6, 0xC7D4310F, 0x499CE9F2, 0xE4F07DFE, 0x78C0030C, 0xD80E4856,
+  0x679081D5, 0x294C18B2, 0xF46A4DA8, 0x8D4BFDD5, 0x3CE18773, 0x164651B0,
+  0x50ECAF39, 0x7F54D75F, 0xE8FA74C9, 0x55F57765, 0xC1B3D479, 0xD78EDFBB,
+  0xCEE185E4, 0x8D3308C3, 0xDC5E7B20, 0x6F8BB72C, 0x3BA5ECFC, 0xAA3810B3,
+  0x8FE02FE6, 0x59EA6896, 0x77A409B3, 0xE4560BA4, 0x1A1CCF8F, 0x113886BF,
+  0xC60F5761, 0x91B9B088, 0x953A8F2E, 0xA7322D19, 0xED6B269A, 0x81E8ABD6,
+  0x48ED2806, 0xFD3CCD9B, 0xBBB44B1F, 0x2C74EC81, 0x5E3A84FD, 0xB16F8D03,
+  0xDBB4AD77, 0xB8A3293B, 0x32128D44, 0x7E89CBBB, 0xE974D366, 0xEB40472B,
+  0x03896F70, 0x70194B8F, 0x1D26D9CA, 0x25AD6AB3, 0xFE6533B9, 0xD8791A20,
+  0x178C7126, 0xB6A76525, 0x70A25AF9, 0xFC638B1D, 0xE09C6B34, 0x3AD8CC2F,
+  0xFEBBF8F6, 0x1BA4EF3C, 0xA53929BE, 0xFCA7A6A6, 0x0B297E98, 0x1E85EA05,
+  0x87937090, 0x241A1419, 0xFC8E41D5, 0x7090C36B, 0xC6FC0ABF, 0xECFA7355,
+  0xBCD89F9E, 0x41CCF740, 0x5B6FF5E4, 0xE6E7A8C8, 0xAEA6365A, 0xC45B4B12,
+  0x0DC59E78, 0x46E44E4C, 0x2F04AEAC, 0xA6F1D794, 0x8926BC2E, 0xFF7450DE,
+  0xED5BCF43, 0x4C7F81B9, 0x8987EB0E, 0x7970D887
+};
+
+
+FastCdcDetector::FastCdcDetector(const uint64_t minimal_chunk_size,
+                                 const uint64_t average_chunk_size,
+                                 const uint64_t maximal_chunk_size)
+  : minimal_chunk_size_(minimal_chunk_size)
+  , average_chunk_size_(average_chunk_size)
+  , maximal_chunk_size_(maximal_chunk_size)
+  , mask_small_(0)
+  , mask_large_(0)
+  , gear_ptr_(0)
+  , gear_(0)
+{
+  assert((average_chunk_size_ == 0) || (minimal_chunk_size_ > 0));
+  if (minimal_chunk_size_ > 0) {
+    assert(minimal_chunk_size_ >= kGearWindow);
+    assert(minimal_chunk_size_ < average_chunk_size_);
+    assert(average_chunk_size_ < maximal_chunk_size_);
+    unsigned bits = 0;
+    while ((uint64_t(1) << (bits + 1)) <= average_chunk_size_)
+      bits++;
+    mask_small_ = MakeMask(bits + kNormalizationLevel);
+    mask_large_ = MakeMask(bits - kNormalizationLevel);
+  }
+}
+
+
+/**
+ * The upper bits of the gear hash depend on the most bytes of the window.
+ */
+uint32_t FastCdcDetector::MakeMask(unsigned bits) {
+  bits = std::min(bits, 32U);
+  if (bits == 0)
+    return 0;
+  return ~uint32_t(0) << (32 - bits);
+}
+
+
+/**
+ * Scans kScanLanes * kScanSegment bytes from begin.  Lane 0 continues the
+ * gear hash, the other lanes restart it from the kGearWindow - 1 bytes in front
+ * of their segment, which yields the same hash values.  The lanes only record
+ * that there is a cut mark; in this rare case, the window is scanned again
+ * byte by byte to find the first one.
+ */
+unsigned FastCdcDetector::ScanLanes(
+  const unsigned char *data,
+  unsigned begin,
+  uint32_t mask,
+  uint32_t *gear)
+{
+  const unsigned char *seg0 = data + begin;
+  const unsigned char *seg1 = seg0 + kScanSegment;
+  const unsigned char *seg2 = seg1 + kScanSegment;
+  const unsigned char *seg3 = seg2 + kScanSegment;
+  uint32_t lane0 = *gear;
+  uint32_t lane1 = 0;
+  uint32_t lane2 = 0;
+  uint32_t lane3 = 0;
+  for (unsigned i = kGearWindow - 1; i > 0; --i) {
+    lane1 = Gear(lane1, seg1[-static_cast<int>(i)]);
+    lane2 = Gear(lane2, seg2[-static_cast<int>(i)]);
+    lane3 = Gear(lane3, seg3[-static_cast<int>(i)]);
+  }
+
+  // The mask covers the upper bits, so a hash without masked bits is smaller
+  // than any hash with masked bits.  Tracking the minimum is cheaper than
+  // testing every hash.  The lanes are spelled out, so that the hash chains
+  // are interleaved independent of the optimization level.
+  uint32_t min0 = ~uint32_t(0);
+  uint32_t min1 = ~uint32_t(0);
+  uint32_t min2 = ~uint32_t(0);
+  uint32_t min3 = ~uint32_t(0);
+  for (unsigned i = 0; i < kScanSegment; ++i) {
+    lane0 = Gear(lane0, seg0[i]);
+    lane1 = Gear(lane1, seg1[i]);
+    lane2 = Gear(lane2, seg2[i]);
+    lane3 = Gear(lane3, seg3[i]);
+    min0 = (lane0 < min0) ? lane0 : min0;
+    min1 = (lane1 < min1) ? lane1 : min1;
+    min2 = (lane2 < min2) ? lane2 : min2;
+    min3 = (lane3 < min3) ? lane3 : min3;
+  }
+
+  const unsigned end = begin + kScanLanes * kScanSegment;
+  const uint32_t minimum = std::min(std::min(min0, min1), std::min(min2, min3));
+  if ((minimum & mask) == 0) {
+    uint32_t g = *gear;
+    for (unsigned i = begin; i < end; ++i) {
+      g = Gear(g, data[i]);
+      if ((g & mask) == 0)
+        return i;
+    }
+    assert(false);
+  }
+  *gear = lane3;
+  return end;
+}
+
+
+unsigned FastCdcDetector::Scan(
+  const unsigned char *data,
+  unsigned begin,
+  unsigned end,
+  uint32_t mask,
+  uint32_t *gear)
+{
+  const unsigned kWindow = kScanLanes * kScanSegment;
+  unsigned i = begin;
+  while (end - i >= kWindow) {
+    const unsigned hit = ScanLanes(data, i, mask, gear);
+    if (hit < i + kWindow)
+      return hit;
+    i += kWindow;
+  }
+  uint32_t g = *gear;
+  for (; i < end; ++i) {
+    g = Gear(g, data[i]);
+    if ((g & mask) == 0)
+      break;
+  }
+  *gear = g;
+  return i;
+}
+
+
+uint64_t FastCdcDetector::DoFindNextCutMark(BlockItem *buffer) {
+  assert(minimal_chunk_size_ > 0);
+  const unsigned char *data = buffer->data();
+  const uint64_t begin = offset();
+  const uint64_t end = offset() + buffer->size();
+
+  // A byte at a position from check_begin on can be the last one of a chunk.
+  // The window in front of it is hashed without looking for cut marks.
+  const uint64_t check_begin = last_cut() + minimal_chunk_size_ - 1;
+  uint64_t pos = std::max(check_begin - (kGearWindow - 1), gear_ptr_);
+  if (pos >= end)
+    return NoCut(pos);
+  for (; (pos < check_begin) && (pos < end); ++pos)
+    gear_ = Gear(gear_, data[pos - begin]);
+  if (pos == end)
+    return NoCut(pos);
+
+  const uint64_t hard_cut = last_cut() + maximal_chunk_size_;
+  const uint64_t normal_cut = last_cut() + average_chunk_size_;
+  const uint64_t scan_end = std::min(end, hard_cut);
+  if (pos < normal_cut) {
+    const uint64_t region_end = std::min(scan_end, normal_cut);
+    const uint64_t hit = begin + Scan(data, pos - begin, region_end - begin,
+                                      mask_small_, &gear_);
+    if (hit < region_end)
+      return DoCut(hit + 1);
+    pos = region_end;
+  }
+  if (pos < scan_end) {
+    const uint64_t hit = begin + Scan(data, pos - begin, scan_end - begin,
+                                      mask_large_, &gear_);
+    if (hit < scan_end)
+      return DoCut(hit + 1);
+    pos = scan_end;
+  }
+
+  if (pos == hard_cut)
+    return DoCut(pos);
+  return NoCut(pos);
+}
@@ -11,9 +11,27 @@
 #include <cstdlib>
 
 #include <algorithm>
+#include <string>
 
 class BlockItem;
 
+/**
+ * Content-defined chunking algorithms.  The algorithm is part of the
+ * definition of the cut marks: changing it for a repository changes the chunks
+ * of all modified files.
+ */
+enum ChunkingAlgorithms {
+  kChunkingXor32 = 0,
+  kChunkingFastCdc,
+};
+
+/**
+ * Accepts "xor32" and "fastcdc".  Returns false for unknown names.
+ */
+bool ParseChunkingAlgorithm(const std::string &name,
+                            ChunkingAlgorithms *algorithm);
+std::string ChunkingAlgorithmName(const ChunkingAlgorithms algorithm);
+
 /**
  * Abstract base class for a cutmark detector. This decides on which file
  * positions a File should be chunked.
@@ -26,6 +44,14 @@ class ChunkDetector {
 
   virtual bool MightFindChunks(uint64_t size) const = 0;
 
+  /**
+   * Creates a content-defined chunk detector of the given algorithm.
+   */
+  static ChunkDetector *Construct(const ChunkingAlgorithms algorithm,
+                                  const uint64_t minimal_chunk_size,
+                                  const uint64_t average_chunk_size,
+                                  const uint64_t maximal_chunk_size);
+
  protected:
   virtual uint64_t DoFindNextCutMark(BlockItem *block) = 0;
 
@@ -135,4 +161,91 @@ class Xor32Detector : public ChunkDetector {
   uint32_t xor32_;
 };
 
+
+
+/**
+ * FastCDC [1] cuts where a gear hash of the last 32 bytes has a number of
+ * zero bits.  Chunk sizes are normalized: below the average chunk size the
+ * condition is harder to meet than above it, which narrows the chunk size
+ * distribution.  Regions below the minimal chunk size are skipped.
+ *
+ * The gear hash at a position only depends on the last 32 bytes.  Therefore,
+ * the boundary scan cuts its range into segments that are hashed in
+ * independent lanes, which keeps several hash chains in flight at once.
+ *
+ * [1]     "FastCDC: a Fast and Efficient Content-Defined Chunking Approach
+ *          for Data Deduplication", Xia et al., USENIX ATC 2016
+ */
+class FastCdcDetector : public ChunkDetector {
+  FRIEND_TEST(T_ChunkDetectors, FastCdcGear);
+  FRIEND_TEST(T_ChunkDetectors, FastCdcMasks);
+  FRIEND_TEST(T_ChunkDetectors, FastCdcChunkDetectorSlow);
+
+ public:
+  FastCdcDetector(const uint64_t minimal_chunk_size,
+                  const uint64_t average_chunk_size,
+                  const uint64_t maximal_chunk_size);
+
+  bool MightFindChunks(const uint64_t size) const {
+    return size > minimal_chunk_size_;
+  }
+
+  /**
+   * Rolls byte into the gear hash
+   */
+  static inline uint32_t Gear(const uint32_t gear, const unsigned char byte) {
+    return (gear << 1) + kGearTable[byte];
+  }
+
+ protected:
+  virtual uint64_t DoFindNextCutMark(BlockItem *buffer);
+
+  virtual uint64_t DoCut(const uint64_t offset) {
+    gear_     = 0;
+    gear_ptr_ = offset;
+    return ChunkDetector::DoCut(offset);
+  }
+
+  virtual uint64_t NoCut(const uint64_t offset) {
+    gear_ptr_ = offset;
+    return ChunkDetector::NoCut(offset);
+  }
+
+ private:
+  // The gear hash only depends on a window of the last 32 bytes
+  static const unsigned kGearWindow = 32;
+  // Mask bits added below and removed above the average chunk size
+  static const unsigned kNormalizationLevel = 2;
+  // ScanLanes() spells out the lanes
+  static const unsigned kScanLanes = 4;
+  static const unsigned kScanSegment = 4096;
+  static const uint32_t kGearTable[256];
+
+  /**
+   * Hashes data[begin..end) continuing *gear and returns the position of the
+   * first byte whose gear hash has none of the bits in mask set, or end.  If
+   * no such byte is found, *gear is the hash of the window before end.
+   */
+  static unsigned Scan(const unsigned char *data, unsigned begin, unsigned end,
+                       uint32_t mask, uint32_t *gear);
+  static unsigned ScanLanes(const unsigned char *data, unsigned begin,
+                            uint32_t mask, uint32_t *gear);
+  static uint32_t MakeMask(unsigned bits);
+
+  const uint64_t minimal_chunk_size_;
+  const uint64_t average_chunk_size_;
+  const uint64_t maximal_chunk_size_;
+  /**
+   * Used below the average chunk size
+   */
+  uint32_t mask_small_;
+  /**
+   * Used from the average chunk size on
+   */
+  uint32_t mask_large_;
+
+  uint64_t gear_ptr_;
+  uint32_t gear_;
+};
+
 #endif  // CVMFS_INGESTION_CHUNK_DETECTOR_H_
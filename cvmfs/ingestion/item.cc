@@ -4,6 +4,9 @@
 
 #include "item.h"
 
+#include <errno.h>
+#include <sys/time.h>
+
 #include <algorithm>
 #include <cassert>
 #include <cstdlib>
@@ -23,7 +26,8 @@ FileItem::FileItem(
   shash::Algorithms hash_algorithm,
   shash::Suffix hash_suffix,
   bool may_have_chunks,
-  bool has_legacy_bulk_chunk)
+  bool has_legacy_bulk_chunk,
+  ChunkingAlgorithms chunking_algorithm)
   : source_(source)
   , compression_algorithm_(compression_algorithm)
   , hash_algorithm_(hash_algorithm)
@@ -31,7 +35,8 @@ FileItem::FileItem(
   , has_legacy_bulk_chunk_(has_legacy_bulk_chunk)
   , size_(kSizeUnknown)
   , may_have_chunks_(may_have_chunks)
-  , chunk_detector_(min_chunk_size, avg_chunk_size, max_chunk_size)
+  , chunk_detector_(ChunkDetector::Construct(chunking_algorithm,
+      min_chunk_size, avg_chunk_size, max_chunk_size))
   , bulk_hash_(hash_algorithm)
   , chunks_(1)
 {
@@ -107,6 +112,9 @@ void ChunkItem::ReleaseCompressor() {
 //------------------------------------------------------------------------------
 
 atomic_int64 BlockItem::managed_bytes_ = 0;
+atomic_int32 BlockItem::n_managed_bytes_waiters_ = 0;
+pthread_mutex_t BlockItem::lock_managed_bytes_ = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t BlockItem::cond_managed_bytes_ = PTHREAD_COND_INITIALIZER;
 
 
 BlockItem::BlockItem(ItemAllocator *allocator)
@@ -138,7 +146,50 @@ BlockItem::BlockItem(int64_t tag, ItemAllocator *allocator)
 BlockItem::~BlockItem() {
   if (data_)
     allocator_->Free(data_);
-  atomic_xadd64(&managed_bytes_, -static_cast<int64_t>(capacity_));
+  ReleaseManagedBytes(capacity_);
+}
+
+
+void BlockItem::ReleaseManagedBytes(uint32_t nbytes) {
+  if (nbytes == 0)
+    return;
+  atomic_xadd64(&managed_bytes_, -static_cast<int64_t>(nbytes));
+  if (atomic_read32(&n_managed_bytes_waiters_) > 0) {
+    MutexLockGuard guard(&lock_managed_bytes_);
+    pthread_cond_broadcast(&cond_managed_bytes_);
+  }
+}
+
+
+bool BlockItem::WaitForManagedBytes(uint64_t level, unsigned timeout_ms) {
+  struct timespec deadline;
+  if (timeout_ms > 0) {
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    const uint64_t nsecs = static_cast<uint64_t>(now.tv_usec) * 1000 +
+                           static_cast<uint64_t>(timeout_ms % 1000) * 1000000;
+    deadline.tv_sec = now.tv_sec + timeout_ms / 1000 + nsecs / 1000000000;
+    deadline.tv_nsec = nsecs % 1000000000;
+  }
+
+  MutexLockGuard guard(&lock_managed_bytes_);
+  atomic_inc32(&n_managed_bytes_waiters_);
+  bool result = true;
+  while (managed_bytes() > level) {
+    if (timeout_ms == 0) {
+      pthread_cond_wait(&cond_managed_bytes_, &lock_managed_bytes_);
+      continue;
+    }
+    int retval = pthread_cond_timedwait(&cond_managed_bytes_,
+                                        &lock_managed_bytes_, &deadline);
+    if (retval == ETIMEDOUT) {
+      result = managed_bytes() <= level;
+      break;
+    }
+    assert(retval == 0);
+  }
+  atomic_dec32(&n_managed_bytes_waiters_);
+  return result;
 }
 
 
@@ -167,7 +218,8 @@ void BlockItem::MakeData(uint32_t capacity) {
 
 
 /**
- * Move data from one block to another.
+ * Move data from one block to another.  The managed capacity moves along with
+ * the data.
  */
 void BlockItem::MakeDataMove(BlockItem *other) {
   assert(type_ == kBlockHollow);
@@ -175,7 +227,8 @@ void BlockItem::MakeDataMove(BlockItem *other) {
   assert(other->size_ > 0);
 
   type_ = kBlockData;
-  capacity_ = size_ = other->size_;
+  capacity_ = other->capacity_;
+  size_ = other->size_;
   data_ = other->data_;
   allocator_ = other->allocator_;
 
@@ -205,7 +258,7 @@ void BlockItem::MakeDataCopy(
 void BlockItem::Reset() {
   assert(type_ == kBlockData);
 
-  atomic_xadd64(&managed_bytes_, -static_cast<int64_t>(capacity_));
+  ReleaseManagedBytes(capacity_);
   allocator_->Free(data_);
   data_ = NULL;
   size_ = capacity_ = 0;
@@ -42,7 +42,8 @@ class FileItem : SingleCopy {
     shash::Algorithms hash_algorithm = shash::kSha1,
     shash::Suffix hash_suffix = shash::kSuffixNone,
     bool may_have_chunks = true,
-    bool has_legacy_bulk_chunk = false);
+    bool has_legacy_bulk_chunk = false,
+    ChunkingAlgorithms chunking_algorithm = kChunkingXor32);
   ~FileItem();
 
   static FileItem *CreateQuitBeacon() {
@@ -56,7 +57,7 @@ class FileItem : SingleCopy {
 
   std::string path() { return source_->GetPath(); }
   uint64_t size() { return size_; }
-  Xor32Detector *chunk_detector() { return &chunk_detector_; }
+  ChunkDetector *chunk_detector() { return chunk_detector_.weak_ref(); }
   shash::Any bulk_hash() { return bulk_hash_; }
   zlib::Algorithms compression_algorithm() { return compression_algorithm_; }
   shash::Algorithms hash_algorithm() { return hash_algorithm_; }
@@ -100,7 +101,7 @@ class FileItem : SingleCopy {
   uint64_t size_;
   bool may_have_chunks_;
 
-  Xor32Detector chunk_detector_;
+  UniquePtr<ChunkDetector> chunk_detector_;
   shash::Any bulk_hash_;
   FileChunkList chunks_;
   /**
@@ -220,12 +221,26 @@ class BlockItem : SingleCopy {
   FileItem *file_item() { return file_item_; }
   ChunkItem *chunk_item() { return chunk_item_; }
   static uint64_t managed_bytes() { return atomic_read64(&managed_bytes_); }
+  /**
+   * Blocks until managed_bytes() dropped to level or, if timeout_ms is
+   * positive, until the timeout expired.  Returns false on timeout.
+   */
+  static bool WaitForManagedBytes(uint64_t level, unsigned timeout_ms);
 
  private:
   /**
    * Total capacity of all BlockItem()
    */
   static atomic_int64 managed_bytes_;
+  /**
+   * Threads in WaitForManagedBytes() are woken up when managed bytes are
+   * released.  The condition variable is only signaled if there are waiters.
+   */
+  static atomic_int32 n_managed_bytes_waiters_;
+  static pthread_mutex_t lock_managed_bytes_;
+  static pthread_cond_t cond_managed_bytes_;
+
+  static void ReleaseManagedBytes(uint32_t nbytes);
 
   // Forget pointer to the data
   void Discharge();
@@ -33,13 +33,30 @@ IngestionPipeline::IngestionPipeline(
   , minimal_chunk_size_(spooler_definition.min_file_chunk_size)
   , average_chunk_size_(spooler_definition.avg_file_chunk_size)
   , maximal_chunk_size_(spooler_definition.max_file_chunk_size)
+  , chunking_algorithm_(spooler_definition.chunking_algorithm)
   , spawned_(false)
   , uploader_(uploader)
   , tube_counter_(kMaxFilesInFlight)
 {
-  unsigned nfork_base = std::max(1U, GetNumberOfCpuCores() / 8);
+  const unsigned ncores = GetNumberOfCpuCores();
+  const unsigned nfork_register =
+    GetNumTasks(spooler_definition.num_register_tasks, kNforkRegister, ncores);
+  const unsigned nfork_write =
+    GetNumTasks(spooler_definition.num_write_tasks, kNforkWrite, ncores);
+  const unsigned nfork_hash =
+    GetNumTasks(spooler_definition.num_hash_tasks, kNforkHash, ncores);
+  const unsigned nfork_compress =
+    GetNumTasks(spooler_definition.num_compress_tasks, kNforkCompress, ncores);
+  const unsigned nfork_chunk =
+    GetNumTasks(spooler_definition.num_chunk_tasks, kNforkChunk, ncores);
+  const unsigned nfork_read =
+    GetNumTasks(spooler_definition.num_read_tasks, kNforkRead, ncores);
+  LogCvmfs(kLogCvmfs, kLogDebug,
+           "pipeline threads: read %u, chunk %u, compress %u, hash %u, "
+           "write %u, register %u", nfork_read, nfork_chunk, nfork_compress,
+           nfork_hash, nfork_write, nfork_register);
 
-  for (unsigned i = 0; i < nfork_base * kNforkRegister; ++i) {
+  for (unsigned i = 0; i < nfork_register; ++i) {
     Tube<FileItem> *tube = new Tube<FileItem>();
     tubes_register_.TakeTube(tube);
     TaskRegister *task = new TaskRegister(tube, &tube_counter_);
@@ -48,21 +65,21 @@ IngestionPipeline::IngestionPipeline(
   }
   tubes_register_.Activate();
 
-  for (unsigned i = 0; i < nfork_base * kNforkWrite; ++i) {
+  for (unsigned i = 0; i < nfork_write; ++i) {
     Tube<BlockItem> *t = new Tube<BlockItem>();
     tubes_write_.TakeTube(t);
     tasks_write_.TakeConsumer(new TaskWrite(t, &tubes_register_, uploader_));
   }
   tubes_write_.Activate();
 
-  for (unsigned i = 0; i < nfork_base * kNforkHash; ++i) {
+  for (unsigned i = 0; i < nfork_hash; ++i) {
     Tube<BlockItem> *t = new Tube<BlockItem>();
     tubes_hash_.TakeTube(t);
     tasks_hash_.TakeConsumer(new TaskHash(t, &tubes_write_));
   }
   tubes_hash_.Activate();
 
-  for (unsigned i = 0; i < nfork_base * kNforkCompress; ++i) {
+  for (unsigned i = 0; i < nfork_compress; ++i) {
     Tube<BlockItem> *t = new Tube<BlockItem>();
     tubes_compress_.TakeTube(t);
     tasks_compress_.TakeConsumer(
@@ -70,7 +87,9 @@ IngestionPipeline::IngestionPipeline(
   }
   tubes_compress_.Activate();
 
-  for (unsigned i = 0; i < nfork_base * kNforkChunk; ++i) {
+  // The read stage dispatches all blocks of a file to the same chunk task,
+  // which keeps the state of the file's chunk detector
+  for (unsigned i = 0; i < nfork_chunk; ++i) {
     Tube<BlockItem> *t = new Tube<BlockItem>();
     tubes_chunk_.TakeTube(t);
     tasks_chunk_.TakeConsumer(
@@ -88,7 +107,7 @@ IngestionPipeline::IngestionPipeline(
   LogCvmfs(kLogCvmfs, kLogDebug,
            "pipeline memory thresholds %" PRIu64 "/%" PRIu64 " M",
            low / (1024 * 1024), high / (1024 * 1024));
-  for (unsigned i = 0; i < nfork_base * kNforkRead; ++i) {
+  for (unsigned i = 0; i < nfork_read; ++i) {
     TaskRead *task_read =
       new TaskRead(&tube_input_, &tubes_chunk_, &item_allocator_);
     task_read->SetWatermarks(low, high);
@@ -97,6 +116,17 @@ IngestionPipeline::IngestionPipeline(
 }
 
 
+unsigned IngestionPipeline::GetNumTasks(
+  const unsigned configured,
+  const unsigned nfork,
+  const unsigned ncores)
+{
+  if (configured > 0)
+    return configured;
+  return std::max(nfork, (ncores * nfork) / 8);
+}
+
+
 IngestionPipeline::~IngestionPipeline() {
   if (spawned_) {
     tasks_read_.Terminate();
@@ -130,7 +160,8 @@ void IngestionPipeline::Process(
     hash_algorithm_,
     hash_suffix,
     allow_chunking && chunking_enabled_,
-    generate_legacy_bulk_chunks_);
+    generate_legacy_bulk_chunks_,
+    chunking_algorithm_);
   tube_counter_.EnqueueBack(file_item);
   tube_input_.EnqueueBack(file_item);
 }
@@ -23,6 +23,14 @@ struct SpoolerDefinition;
 
 class IngestionPipeline : public Observable<upload::SpoolerResult> {
  public:
+  // Number of threads per 8 CPU cores
+  static const unsigned kNforkRegister = 1;
+  static const unsigned kNforkWrite = 1;
+  static const unsigned kNforkHash = 2;
+  static const unsigned kNforkCompress = 4;
+  static const unsigned kNforkChunk = 2;
+  static const unsigned kNforkRead = 8;
+
   explicit IngestionPipeline(
     upload::AbstractUploader *uploader,
     const upload::SpoolerDefinition &spooler_definition);
@@ -35,15 +43,17 @@ class IngestionPipeline : public Observable<upload::SpoolerResult> {
 
   void OnFileProcessed(const upload::SpoolerResult &spooler_result);
 
+  /**
+   * Number of threads of a pipeline stage.  Unless configured to a non-zero
+   * value, a stage gets nfork threads per 8 CPU cores but at least nfork
+   * threads.
+   */
+  static unsigned GetNumTasks(unsigned configured, unsigned nfork,
+                              unsigned ncores);
+
  private:
   static const uint64_t kMaxPipelineMem;  // 1G
   static const unsigned kMaxFilesInFlight = 8000;
-  static const unsigned kNforkRegister = 1;
-  static const unsigned kNforkWrite = 1;
-  static const unsigned kNforkHash = 2;
-  static const unsigned kNforkCompress = 4;
-  static const unsigned kNforkChunk = 1;
-  static const unsigned kNforkRead = 8;
 
   const zlib::Algorithms compression_algorithm_;
   const shash::Algorithms hash_algorithm_;
@@ -52,6 +62,7 @@ class IngestionPipeline : public Observable<upload::SpoolerResult> {
   const size_t minimal_chunk_size_;
   const size_t average_chunk_size_;
   const size_t maximal_chunk_size_;
+  const ChunkingAlgorithms chunking_algorithm_;
 
   bool spawned_;
   upload::AbstractUploader *uploader_;
@@ -6,26 +6,65 @@
 #include "task_hash.h"
 
 #include <cstdlib>
+#include <set>
+#include <vector>
 
 #include "hash.h"
 #include "util/exception.h"
 
 
 void TaskHash::Process(BlockItem *input_block) {
-  ChunkItem *chunk = input_block->chunk_item();
-  assert(chunk != NULL);
-
-  switch (input_block->type()) {
-    case BlockItem::kBlockData:
-      shash::Update(input_block->data(), input_block->size(),
-                    chunk->hash_ctx());
-      break;
-    case BlockItem::kBlockStop:
-      shash::Final(chunk->hash_ctx(), chunk->hash_ptr());
+  std::vector<BlockItem *> batch;
+  batch.push_back(input_block);
+  // Only this task pops from the tube, so the waiting blocks are there
+  uint64_t num_waiting = tube_->size();
+  while ((num_waiting-- > 0) && (batch.size() < kMaxBatchSize)) {
+    BlockItem *block = tube_->PopFront();
+    if (block->IsQuitBeacon()) {
+      tube_->EnqueueFront(block);
       break;
-    default:
-      PANIC(NULL);
+    }
+    batch.push_back(block);
+  }
+
+  // Every round takes the first unprocessed block of every chunk
+  std::vector<bool> is_done(batch.size(), false);
+  unsigned num_done = 0;
+  while (num_done < batch.size()) {
+    std::set<ChunkItem *> chunks;
+    std::vector<const unsigned char *> buffers;
+    std::vector<unsigned> lengths;
+    std::vector<shash::ContextPtr> contexts;
+    for (unsigned i = 0; i < batch.size(); ++i) {
+      if (is_done[i])
+        continue;
+      ChunkItem *chunk = batch[i]->chunk_item();
+      assert(chunk != NULL);
+      if (!chunks.insert(chunk).second)
+        continue;
+
+      switch (batch[i]->type()) {
+        case BlockItem::kBlockData:
+          buffers.push_back(batch[i]->data());
+          lengths.push_back(batch[i]->size());
+          contexts.push_back(chunk->hash_ctx());
+          break;
+        case BlockItem::kBlockStop:
+          // All the data blocks of the chunk were hashed in previous rounds
+          shash::Final(chunk->hash_ctx(), chunk->hash_ptr());
+          break;
+        default:
+          PANIC(NULL);
+      }
+      is_done[i] = true;
+      num_done++;
+    }
+    if (!buffers.empty()) {
+      shash::UpdateMulti(&buffers[0], &lengths[0], &contexts[0],
+                         buffers.size());
+    }
   }
 
-  tubes_out_->Dispatch(input_block);
+  for (unsigned i = 0; i < batch.size(); ++i)
+    tubes_out_->Dispatch(batch[i]);
 }
@@ -8,8 +8,15 @@
 #include "ingestion/item.h"
 #include "ingestion/task.h"
 
+/**
+ * Blocks that are already waiting in the tube are hashed together, so that
+ * the blocks of independent chunks share the SIMD lanes of
+ * shash::UpdateMulti().
+ */
 class TaskHash : public TubeConsumer<BlockItem> {
  public:
+  static const unsigned kMaxBatchSize = 16;
+
   TaskHash(Tube<BlockItem> *tube_in, TubeGroup<BlockItem> *tubes_out)
     : TubeConsumer<BlockItem>(tube_in), tubes_out_(tubes_out) { }
 
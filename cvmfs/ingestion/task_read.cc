@@ -8,9 +8,9 @@
 #include <fcntl.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <cstring>
 
-#include "backoff.h"
 #include "logging.h"
 #include "platform.h"
 #include "smalloc.h"
@@ -22,12 +22,9 @@ atomic_int64 TaskRead::tag_seq_ = 0;
 
 
 void TaskRead::Process(FileItem *item) {
-  BackoffThrottle throttle(kThrottleInitMs, kThrottleMaxMs, kThrottleResetMs);
   if ((high_watermark_ > 0) && (BlockItem::managed_bytes() > high_watermark_)) {
     atomic_inc64(&n_block_);
-    do {
-      throttle.Throttle();
-    } while (BlockItem::managed_bytes() > low_watermark_);
+    BlockItem::WaitForManagedBytes(low_watermark_, 0);
   }
 
   if (item->Open() == false) {
@@ -44,24 +41,34 @@ void TaskRead::Process(FileItem *item) {
       item->chunk_detector()->MightFindChunks(item->size()));
   }
 
-  unsigned char *buffer[kBlockSize];
   uint64_t tag = atomic_xadd64(&tag_seq_, 1);
+  uint64_t remaining = size;
   ssize_t nbytes = -1;
   unsigned cnt = 0;
   do {
-    nbytes = item->Read(buffer, kBlockSize);
-    if (nbytes < 0) {
-      PANIC(kLogStderr, "failed to read %s (%d)", item->path().c_str(), errno);
-    }
-
     BlockItem *block_item = new BlockItem(tag, allocator_);
     block_item->SetFileItem(item);
+    nbytes = 0;
+    // Sized by the file, so that small files do not pin full blocks
+    if (remaining > 0) {
+      block_item->MakeData(std::min(remaining, uint64_t(kBlockSize)));
+      nbytes = item->Read(block_item->data(), block_item->capacity());
+      if (nbytes < 0) {
+        PANIC(kLogStderr, "failed to read %s (%d)", item->path().c_str(),
+              errno);
+      }
+    }
+
     if (nbytes == 0) {
+      // End of file or the file shrunk while reading
+      if (block_item->type() == BlockItem::kBlockData)
+        block_item->Reset();
       item->Close();
       block_item->MakeStop();
     } else {
-      block_item->MakeDataCopy(reinterpret_cast<unsigned char *>(buffer),
-                               nbytes);
+      block_item->set_size(nbytes);
+      remaining = (static_cast<uint64_t>(nbytes) < block_item->capacity()) ?
+                  0 : remaining - nbytes;
     }
     tubes_out_->Dispatch(block_item);
 
@@ -70,7 +77,7 @@ void TaskRead::Process(FileItem *item) {
       if ((high_watermark_ > 0) &&
           (BlockItem::managed_bytes() > high_watermark_))
       {
-        throttle.Throttle();
+        BlockItem::WaitForManagedBytes(high_watermark_, kThrottleMaxMs);
       }
     }
   } while (nbytes > 0);
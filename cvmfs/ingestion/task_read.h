@@ -15,12 +15,19 @@
 
 class ItemAllocator;
 
+/**
+ * Reads files directly into the buffers of data blocks.  The buffers are
+ * owned by the ItemAllocator and travel through the pipeline without further
+ * copies.
+ */
 class TaskRead : public TubeConsumer<FileItem> {
  public:
-  static const unsigned kThrottleInitMs = 50;
+  /**
+   * While reading a file, the task waits at most for this long for the
+   * pipeline to drain below the high watermark.
+   */
   static const unsigned kThrottleMaxMs = 500;
-  static const unsigned kThrottleResetMs = 2000;
-  static const unsigned kBlockSize = kPageSize * 4;
+  static const unsigned kBlockSize = kPageSize * 32;
 
   TaskRead(
     Tube<FileItem> *tube_in,
@@ -47,6 +47,7 @@
 #include <functional>
 #include <map>
 #include <string>
+#include <vector>
 
 #include "atomic.h"
 #include "platform.h"
@@ -517,19 +518,25 @@ class LruCache : SingleCopy {
     allocator_(cache_size),
     lru_list_(&allocator_)
   {
-    assert(cache_size > 0);
-
-    counters_.sz_size->Set(cache_size_);
-    filter_entry_ = NULL;
-    // cache_ = Cache(cache_size_);
-    cache_.Init(cache_size_, empty_key, hasher);
-    perf::Xadd(counters_.sz_allocated, allocator_.bytes_allocated() +
-                  cache_.bytes_allocated());
+    Init(empty_key, hasher);
+  }
 
-#ifdef LRU_CACHE_THREAD_SAFE
-    int retval = pthread_mutex_init(&lock_, NULL);
-    assert(retval == 0);
-#endif
+  /**
+   * Create a new LRU cache object that updates existing counters.  Used for
+   * the shards of a ShardedLruCache.
+   */
+  LruCache(const unsigned   cache_size,
+           const Key       &empty_key,
+           uint32_t (*hasher)(const Key &key),
+           const Counters  &counters) :
+    counters_(counters),
+    pause_(false),
+    cache_gauge_(0),
+    cache_size_(cache_size),
+    allocator_(cache_size),
+    lru_list_(&allocator_)
+  {
+    Init(empty_key, hasher);
   }
 
   static double GetEntrySize() {
@@ -543,6 +550,7 @@ class LruCache : SingleCopy {
 #endif
   }
 
+
   /**
    * Insert a new key-value pair to the list.
    * If the cache is already full, the least recently used object is removed;
@@ -796,6 +804,22 @@ class LruCache : SingleCopy {
   Counters counters_;
 
  private:
+  void Init(const Key &empty_key, uint32_t (*hasher)(const Key &key)) {
+    assert(cache_size_ > 0);
+
+    counters_.sz_size->Set(cache_size_);
+    filter_entry_ = NULL;
+    // cache_ = Cache(cache_size_);
+    cache_.Init(cache_size_, empty_key, hasher);
+    perf::Xadd(counters_.sz_allocated, allocator_.bytes_allocated() +
+                  cache_.bytes_allocated());
+
+#ifdef LRU_CACHE_THREAD_SAFE
+    int retval = pthread_mutex_init(&lock_, NULL);
+    assert(retval == 0);
+#endif
+  }
+
   /**
    *  this just performs a lookup in the cache
    *  WITHOUT changing the LRU order
@@ -871,6 +895,165 @@ class LruCache : SingleCopy {
 #endif
 };  // class LruCache
 
+
+/**
+ * An LRU cache that is split into several independent LruCache shards, each of
+ * them protected by its own lock.  The shard of a key is selected by the low
+ * bits of its hash value (the shards' hash tables use the high bits), so that
+ * concurrent lookups of different keys mostly take different locks.  The LRU
+ * order is only maintained per shard, i.e. the cache evicts approximately the
+ * least recently used entries.
+ *
+ * The shards update the same hit, miss, insert, update, replace, and forget
+ * counters.  The size, allocation, and drop counters refer to the sharded
+ * cache as a whole.  Every shard needs at least kMinShardSize entries, the
+ * number of shards is reduced for small caches.  Because every shard size is a
+ * multiple of 64, the capacity can be slightly smaller than cache_size.
+ *
+ * The filter interface of the LruCache is not provided.
+ */
+template<class Key, class Value>
+class ShardedLruCache : SingleCopy {
+ public:
+  static const unsigned kMinShardSize = 128;
+
+  ShardedLruCache(const unsigned   cache_size,
+                  const Key       &empty_key,
+                  uint32_t (*hasher)(const Key &key),
+                  perf::StatisticsTemplate statistics,
+                  const unsigned   num_shards) :
+    counters_(statistics),
+    hasher_(hasher)
+  {
+    assert(cache_size > 0);
+    num_shards_ = std::max(1U, std::min(num_shards,
+                                        cache_size / kMinShardSize));
+    // The shard sizes must be a multiple of 64
+    const unsigned shard_size = (num_shards_ == 1) ?
+      cache_size : ((cache_size / num_shards_) & ~63U);
+
+    // The shards share the operation counters but the size, allocation, and
+    // drop counters are maintained here.  The shards' versions of these
+    // counters end up in a private statistics object.
+    Counters shard_counters(
+      perf::StatisticsTemplate("shard", &shard_statistics_));
+    shard_counters.n_hit = counters_.n_hit;
+    shard_counters.n_miss = counters_.n_miss;
+    shard_counters.n_insert = counters_.n_insert;
+    shard_counters.n_insert_negative = counters_.n_insert_negative;
+    shard_counters.n_update = counters_.n_update;
+    shard_counters.n_update_value = counters_.n_update_value;
+    shard_counters.n_replace = counters_.n_replace;
+    shard_counters.n_forget = counters_.n_forget;
+
+    for (unsigned i = 0; i < num_shards_; ++i) {
+      shards_.push_back(
+        new LruCache<Key, Value>(shard_size, empty_key, hasher,
+                                 shard_counters));
+    }
+    counters_.sz_size->Set(static_cast<int64_t>(shard_size) * num_shards_);
+    perf::Xadd(counters_.sz_allocated, shard_counters.sz_allocated->Get());
+  }
+
+  static double GetEntrySize() {
+    return LruCache<Key, Value>::GetEntrySize();
+  }
+
+  virtual ~ShardedLruCache() {
+    for (unsigned i = 0; i < num_shards_; ++i)
+      delete shards_[i];
+  }
+
+  virtual bool Insert(const Key &key, const Value &value) {
+    return GetShard(key)->Insert(key, value);
+  }
+
+  virtual void Update(const Key &key) {
+    GetShard(key)->Update(key);
+  }
+
+  virtual bool UpdateValue(const Key &key, const Value &value) {
+    return GetShard(key)->UpdateValue(key, value);
+  }
+
+  virtual bool Lookup(const Key &key, Value *value, bool update_lru = true) {
+    return GetShard(key)->Lookup(key, value, update_lru);
+  }
+
+  virtual bool Forget(const Key &key) {
+    return GetShard(key)->Forget(key);
+  }
+
+  /**
+   * Clears all the shards one after another.  Entries inserted into an already
+   * cleared shard during the drop remain in the cache, so callers that need an
+   * empty cache pause it first.
+   */
+  virtual void Drop() {
+    for (unsigned i = 0; i < num_shards_; ++i)
+      shards_[i]->Drop();
+    perf::Inc(counters_.n_drop);
+  }
+
+  void Pause() {
+    for (unsigned i = 0; i < num_shards_; ++i)
+      shards_[i]->Pause();
+  }
+
+  void Resume() {
+    for (unsigned i = 0; i < num_shards_; ++i)
+      shards_[i]->Resume();
+  }
+
+  /**
+   * True if any of the shards is full, i.e. if the next insert might evict an
+   * entry.
+   */
+  bool IsFull() const {
+    for (unsigned i = 0; i < num_shards_; ++i) {
+      if (shards_[i]->IsFull())
+        return true;
+    }
+    return false;
+  }
+
+  bool IsEmpty() const {
+    for (unsigned i = 0; i < num_shards_; ++i) {
+      if (!shards_[i]->IsEmpty())
+        return false;
+    }
+    return true;
+  }
+
+  Counters counters() {
+    Counters result = counters_;
+    result.num_collisions = 0;
+    result.max_collisions = 0;
+    for (unsigned i = 0; i < num_shards_; ++i) {
+      Counters shard_counters = shards_[i]->counters();
+      result.num_collisions += shard_counters.num_collisions;
+      result.max_collisions =
+        std::max(result.max_collisions, shard_counters.max_collisions);
+    }
+    return result;
+  }
+
+  unsigned num_shards() const { return num_shards_; }
+
+ protected:
+  Counters counters_;
+
+ private:
+  inline LruCache<Key, Value> *GetShard(const Key &key) {
+    return shards_[hasher_(key) % num_shards_];
+  }
+
+  perf::Statistics shard_statistics_;
+  uint32_t (*hasher_)(const Key &key);
+  unsigned num_shards_;
+  std::vector<LruCache<Key, Value> *> shards_;
+};  // class ShardedLruCache
+
 }  // namespace lru
 
 #endif  // CVMFS_LRU_H_
@@ -117,6 +117,9 @@ class Manifest {
   void set_reflog_hash(const shash::Any& checksum) {
     reflog_hash_ = checksum;
   }
+  void set_paged_catalog_index(const shash::Any &paged_catalog_index) {
+    paged_catalog_index_ = paged_catalog_index;
+  }
 
   uint64_t revision() const { return revision_; }
   std::string repository_name() const { return repository_name_; }
@@ -130,6 +133,7 @@ class Manifest {
   bool has_alt_catalog_path() const { return has_alt_catalog_path_; }
   shash::Any meta_info() const { return meta_info_; }
   shash::Any reflog_hash() const { return reflog_hash_; }
+  shash::Any paged_catalog_index() const { return paged_catalog_index_; }
 
   std::string MakeCatalogPath() const {
     return has_alt_catalog_path_ ? catalog_hash_.MakeAlternativePath() :
@@ -172,6 +176,11 @@ class Manifest {
    * Hash of the reflog file
    */
   shash::Any reflog_hash_;
+
+  /**
+   * Hash of the index of the paged root catalog, see catalog_paged.h
+   */
+  shash::Any paged_catalog_index_;
 };  // class Manifest
 
 }  // namespace manifest
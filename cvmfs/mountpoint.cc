@@ -37,6 +37,7 @@
 #include "cache_tiered.h"
 #include "catalog.h"
 #include "catalog_mgr_client.h"
+#include "chunk_prefetch.h"
 #include "clientctx.h"
 #include "download.h"
 #include "duplex_sqlite3.h"
@@ -289,6 +290,12 @@ FileSystem::PosixCacheSettings FileSystem::DeterminePosixCacheSettings(
   }
   if (settings.quota_limit > 0)
     settings.is_managed = true;
+  if (options_mgr_->GetValue(MkCacheParm("CVMFS_CACHE_QUOTA_INDEX", instance),
+                             &optarg)
+      && options_mgr_->IsOn(optarg))
+  {
+    settings.quota_memory_index = true;
+  }
 
   settings.cache_path = kDefaultCacheBase;
   if (options_mgr_->GetValue(MkCacheParm("CVMFS_CACHE_BASE", instance),
@@ -931,7 +938,8 @@ bool FileSystem::SetupPosixQuotaMgr(
                   cache_workspace,
                   settings.quota_limit,
                   quota_threshold,
-                  foreground_);
+                  foreground_,
+                  settings.quota_memory_index);
     if (quota_mgr == NULL) {
       boot_error_ = "Failed to initialize shared lru cache";
       boot_status_ = loader::kFailQuota;
@@ -942,7 +950,8 @@ bool FileSystem::SetupPosixQuotaMgr(
                   cache_workspace,
                   settings.quota_limit,
                   quota_threshold,
-                  found_previous_crash_);
+                  found_previous_crash_,
+                  settings.quota_memory_index);
     if (quota_mgr == NULL) {
       boot_error_ = "Failed to initialize lru cache";
       boot_status_ = loader::kFailQuota;
@@ -1184,6 +1193,7 @@ MountPoint *MountPoint::Create(
 
   mountpoint->ReEvaluateAuthz();
   mountpoint->CreateTables();
+  mountpoint->CreateChunkPrefetcher();
   if (!mountpoint->SetupBehavior())
     return mountpoint.Release();
 
@@ -1222,6 +1232,14 @@ bool MountPoint::CreateCatalogManager() {
   string optarg;
 
   catalog_mgr_ = new catalog::ClientCatalogManager(this);
+  if (options_mgr_->GetValue("CVMFS_PAGED_CATALOGS", &optarg) &&
+      options_mgr_->IsOn(optarg))
+  {
+    catalog_mgr_->set_paged_catalogs(true);
+  }
+  if (options_mgr_->GetValue("CVMFS_PRESTAGE_CATALOGS", &optarg)) {
+    catalog_mgr_->set_prestage_parallelism(String2Uint64(optarg));
+  }
 
   SetupInodeAnnotation();
   if (!SetupOwnerMaps())
@@ -1337,6 +1355,10 @@ bool MountPoint::CreateDownloadManagers() {
       options_mgr_->IsOn(optarg)) {
     download_mgr_->ShardProxies();
   }
+  if (options_mgr_->GetValue("CVMFS_PROXY_LATENCY_AWARE", &optarg) &&
+      options_mgr_->IsOn(optarg)) {
+    download_mgr_->EnableLatencyAwareProxies();
+  }
 
   return SetupExternalDownloadMgr(do_geosort);
 }
@@ -1470,6 +1492,9 @@ void MountPoint::CreateTables() {
   uint64_t mem_cache_size = kDefaultMemcacheSize;
   if (options_mgr_->GetValue("CVMFS_MEMCACHE_SIZE", &optarg))
     mem_cache_size = String2Uint64(optarg) * 1024 * 1024;
+  unsigned num_shards = lru::kDefaultNumShards;
+  if (options_mgr_->GetValue("CVMFS_MEMCACHE_SHARDS", &optarg))
+    num_shards = std::max(1U, static_cast<unsigned>(String2Uint64(optarg)));
 
   const double memcache_unit_size =
     (static_cast<double>(kInodeCacheFactor) * lru::Md5PathCache::GetEntrySize())
@@ -1478,10 +1503,12 @@ void MountPoint::CreateTables() {
     mem_cache_size / static_cast<unsigned>(memcache_unit_size);
   // Number of cache entries must be a multiple of 64
   const unsigned mask_64 = ~((1 << 6) - 1);
-  inode_cache_ = new lru::InodeCache(memcache_num_units & mask_64, statistics_);
-  path_cache_ = new lru::PathCache(memcache_num_units & mask_64, statistics_);
+  inode_cache_ = new lru::InodeCache(memcache_num_units & mask_64, statistics_,
+                                     num_shards);
+  path_cache_ = new lru::PathCache(memcache_num_units & mask_64, statistics_,
+                                   num_shards);
   md5path_cache_ = new lru::Md5PathCache((memcache_num_units * 7) & mask_64,
-                                         statistics_);
+                                         statistics_, num_shards);
 
   inode_tracker_ = new glue::InodeTracker();
   dentry_tracker_ = new glue::DentryTracker();
@@ -1490,6 +1517,44 @@ void MountPoint::CreateTables() {
     page_cache_tracker_->Disable();
 }
 
+
+/**
+ * Chunk readahead is only used by the fuse module and only if
+ * CVMFS_CHUNK_PREFETCH_WINDOW is set to a number of chunks larger than zero.
+ */
+void MountPoint::CreateChunkPrefetcher() {
+  if (file_system_->type() != FileSystem::kFsFuse)
+    return;
+
+  string optarg;
+  unsigned window = 0;
+  if (options_mgr_->GetValue("CVMFS_CHUNK_PREFETCH_WINDOW", &optarg))
+    window = String2Uint64(optarg);
+  if (window == 0)
+    return;
+
+  unsigned num_workers = cvmfs::ChunkPrefetcher::kDefaultNumWorkers;
+  if (options_mgr_->GetValue("CVMFS_CHUNK_PREFETCH_THREADS", &optarg) &&
+      (String2Uint64(optarg) > 0))
+  {
+    num_workers = String2Uint64(optarg);
+  }
+  uint64_t max_bytes = cvmfs::ChunkPrefetcher::kDefaultMaxBytes;
+  if (options_mgr_->GetValue("CVMFS_CHUNK_PREFETCH_MAX_MB", &optarg) &&
+      (String2Uint64(optarg) > 0))
+  {
+    max_bytes = String2Uint64(optarg) * 1024 * 1024;
+  }
+
+  chunk_prefetcher_ = new cvmfs::ChunkPrefetcher(
+    fetcher_, external_fetcher_, window, num_workers, max_bytes,
+    perf::StatisticsTemplate("chunk_prefetch", statistics_));
+  LogCvmfs(kLogCvmfs, kLogDebug,
+           "chunk prefetching enabled (window %u, %u workers, %" PRIu64 "MB)",
+           window, num_workers, max_bytes / (1024 * 1024));
+}
+
+
 /**
  * Will create a tracer for the current mount point
  * Tracefile path, Trace buffer size and trace buffer flush threshold
@@ -1680,6 +1745,7 @@ MountPoint::MountPoint(
   , inode_annotation_(NULL)
   , catalog_mgr_(NULL)
   , chunk_tables_(NULL)
+  , chunk_prefetcher_(NULL)
   , simple_chunk_tables_(NULL)
   , inode_cache_(NULL)
   , path_cache_(NULL)
@@ -1693,6 +1759,7 @@ MountPoint::MountPoint(
   , kcache_timeout_sec_(static_cast<double>(kDefaultKCacheTtlSec))
   , fixed_catalog_(false)
   , enforce_acls_(false)
+  , fuse_splice_(false)
   , has_membership_req_(false)
   , talk_socket_path_(std::string("./cvmfs_io.") + fqrn)
   , talk_socket_uid_(0)
@@ -1714,6 +1781,8 @@ MountPoint::~MountPoint() {
   delete path_cache_;
   delete inode_cache_;
   delete simple_chunk_tables_;
+  // Stops the prefetch workers, must be gone before the fetchers
+  delete chunk_prefetcher_;
   delete chunk_tables_;
 
   delete catalog_mgr_;
@@ -1807,6 +1876,12 @@ bool MountPoint::SetupBehavior() {
     enforce_acls_ = true;
   }
 
+  if (options_mgr_->GetValue("CVMFS_FUSE_SPLICE", &optarg)
+      && options_mgr_->IsOn(optarg))
+  {
+    fuse_splice_ = true;
+  }
+
   if (options_mgr_->GetValue("CVMFS_TALK_SOCKET", &optarg)) {
     talk_socket_path_ = optarg;
   }
@@ -1954,6 +2029,28 @@ void MountPoint::SetupHttpTuning() {
 
   if (options_mgr_->GetValue("CVMFS_LOW_SPEED_LIMIT", &optarg))
     download_mgr_->SetLowSpeedLimit(String2Uint64(optarg));
+  if (options_mgr_->GetValue("CVMFS_DOWNLOAD_THREADS", &optarg))
+    download_mgr_->SetNumIoThreads(String2Uint64(optarg));
+  if (options_mgr_->GetValue("CVMFS_DOWNLOAD_PIPELINE_THREADS", &optarg))
+    download_mgr_->SetPipelineThreads(String2Uint64(optarg));
+  if (options_mgr_->GetValue("CVMFS_PARALLEL_DOWNLOAD_STREAMS", &optarg)) {
+    uint64_t threshold_mb = kDefaultParallelDownloadThresholdMb;
+    string threshold_opt;
+    if (options_mgr_->GetValue("CVMFS_PARALLEL_DOWNLOAD_THRESHOLD",
+                               &threshold_opt))
+    {
+      threshold_mb = String2Uint64(threshold_opt);
+    }
+    download_mgr_->SetParallelRanges(String2Uint64(optarg),
+                                     threshold_mb * 1024 * 1024);
+  }
+  if (options_mgr_->GetValue("CVMFS_HEDGE_PERCENTILE", &optarg)) {
+    unsigned budget = download::DownloadManager::kDefaultHedgeBudget;
+    string budget_opt;
+    if (options_mgr_->GetValue("CVMFS_HEDGE_BUDGET", &budget_opt))
+      budget = String2Uint64(budget_opt);
+    download_mgr_->SetHedging(String2Uint64(optarg), budget);
+  }
   if (options_mgr_->GetValue("CVMFS_PROXY_RESET_AFTER", &optarg))
     download_mgr_->SetProxyGroupResetDelay(String2Uint64(optarg));
   if (options_mgr_->GetValue("CVMFS_HOST_RESET_AFTER", &optarg))
@@ -1964,6 +2061,11 @@ void MountPoint::SetupHttpTuning() {
   {
     download_mgr_->EnableRedirects();
   }
+  if (options_mgr_->GetValue("CVMFS_HTTP_MULTIPLEXING", &optarg) &&
+      options_mgr_->IsOn(optarg))
+  {
+    download_mgr_->EnableMultiplexing();
+  }
   if (options_mgr_->GetValue("CVMFS_SEND_INFO_HEADER", &optarg) &&
       options_mgr_->IsOn(optarg))
   {
@@ -35,6 +35,7 @@ class InodeAnnotation;
 }
 struct ChunkTables;
 namespace cvmfs {
+class ChunkPrefetcher;
 class Fetcher;
 class Uuid;
 }
@@ -241,7 +242,7 @@ class FileSystem : SingleCopy, public BootFactory {
     PosixCacheSettings() :
       is_shared(false), is_alien(false), is_managed(false),
       avoid_rename(false), cache_base_defined(false), cache_dir_defined(false),
-      quota_limit(0)
+      quota_memory_index(false), quota_limit(0)
       { }
     bool is_shared;
     bool is_alien;
@@ -249,6 +250,10 @@ class FileSystem : SingleCopy, public BootFactory {
     bool avoid_rename;
     bool cache_base_defined;
     bool cache_dir_defined;
+    /**
+     * Keep the LRU order of the quota manager in memory
+     */
+    bool quota_memory_index;
     /**
      * Soft limit in bytes for the cache.  The quota manager removes half the
      * cache when the limit is exceeded.
@@ -428,6 +433,7 @@ class MountPoint : SingleCopy, public BootFactory {
   AuthzSessionManager *authz_session_mgr() { return authz_session_mgr_; }
   BackoffThrottle *backoff_throttle() { return backoff_throttle_; }
   catalog::ClientCatalogManager *catalog_mgr() { return catalog_mgr_; }
+  cvmfs::ChunkPrefetcher *chunk_prefetcher() { return chunk_prefetcher_; }
   ChunkTables *chunk_tables() { return chunk_tables_; }
   download::DownloadManager *download_mgr() { return download_mgr_; }
   download::DownloadManager *external_download_mgr() {
@@ -444,6 +450,7 @@ class MountPoint : SingleCopy, public BootFactory {
   MagicXattrManager *magic_xattr_mgr() { return magic_xattr_mgr_; }
   bool has_membership_req() { return has_membership_req_; }
   bool enforce_acls() { return enforce_acls_; }
+  bool fuse_splice() { return fuse_splice_; }
   catalog::InodeAnnotation *inode_annotation() {
     return inode_annotation_;
   }
@@ -504,6 +511,11 @@ class MountPoint : SingleCopy, public BootFactory {
   static const unsigned kDefaultRetries = 1;
   static const unsigned kDefaultBackoffInitMs = 2000;
   static const unsigned kDefaultBackoffMaxMs = 10000;
+  /**
+   * Objects of at least this size are downloaded in parallel ranges if
+   * CVMFS_PARALLEL_DOWNLOAD_STREAMS is set
+   */
+  static const unsigned kDefaultParallelDownloadThresholdMb = 64;
   /**
    * Memory buffer sizes for an activated tracer
    */
@@ -524,6 +536,7 @@ class MountPoint : SingleCopy, public BootFactory {
   void CreateFetchers();
   bool CreateCatalogManager();
   void CreateTables();
+  void CreateChunkPrefetcher();
   bool CreateTracer();
   bool SetupBehavior();
   void SetupDnsTuning(download::DownloadManager *manager);
@@ -560,6 +573,7 @@ class MountPoint : SingleCopy, public BootFactory {
   catalog::InodeAnnotation *inode_annotation_;
   catalog::ClientCatalogManager *catalog_mgr_;
   ChunkTables *chunk_tables_;
+  cvmfs::ChunkPrefetcher *chunk_prefetcher_;
   SimpleChunkTables *simple_chunk_tables_;
   lru::InodeCache *inode_cache_;
   lru::PathCache *path_cache_;
@@ -577,6 +591,11 @@ class MountPoint : SingleCopy, public BootFactory {
   double kcache_timeout_sec_;
   bool fixed_catalog_;
   bool enforce_acls_;
+  /**
+   * Reply to reads by splicing from the cache file descriptor if the cache
+   * manager supports it
+   */
+  bool fuse_splice_;
   std::string repository_tag_;
   std::vector<std::string> blacklist_paths_;
 
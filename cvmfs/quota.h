@@ -41,6 +41,8 @@ class QuotaManager : SingleCopy {
    *  - backchannel command 'R': release pinned files if possible
    * Revision 2:
    *  - add kCleanupRate command
+   * Revision 3:
+   *  - touch, insert, and pin through a ring buffer in shared memory
    */
   static const uint32_t kProtocolRevision;
 
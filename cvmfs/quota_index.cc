@@ -0,0 +1,137 @@
+/**
+ * This file is part of the CernVM File System.
+ */
+
+#include "cvmfs_config.h"
+#include "quota_index.h"
+
+#include <cassert>
+
+using namespace std;  // NOLINT
+
+
+QuotaIndex::QuotaIndex() {
+  map_.Init(1024, shash::Any(), hasher);
+}
+
+
+QuotaIndex::~QuotaIndex() {
+  List *lists[] = {&volatile_, &regular_};
+  for (unsigned i = 0; i < 2; ++i) {
+    Entry *entry = lists[i]->head;
+    while (entry != NULL) {
+      Entry *next = entry->next;
+      delete entry;
+      entry = next;
+    }
+  }
+}
+
+
+void QuotaIndex::Append(List *list, Entry *entry) {
+  entry->prev = list->tail;
+  entry->next = NULL;
+  if (list->tail != NULL)
+    list->tail->next = entry;
+  else
+    list->head = entry;
+  list->tail = entry;
+}
+
+
+bool QuotaIndex::Erase(const shash::Any &hash) {
+  Entry *entry;
+  if (!map_.Lookup(hash, &entry))
+    return false;
+  Unlink(GetList(entry->seq), entry);
+  map_.Erase(hash);
+  delete entry;
+  return true;
+}
+
+
+const QuotaIndex::Entry *QuotaIndex::Front() const {
+  return (volatile_.head != NULL) ? volatile_.head : regular_.head;
+}
+
+
+void QuotaIndex::Insert(
+  const shash::Any &hash,
+  const uint64_t size,
+  const uint64_t seq)
+{
+  Entry *entry;
+  if (map_.Lookup(hash, &entry)) {
+    Unlink(GetList(entry->seq), entry);
+  } else {
+    entry = new Entry();
+    entry->hash = hash;
+    map_.Insert(hash, entry);
+  }
+  entry->size = size;
+  entry->seq = seq;
+  entry->dirty = false;
+  Append(GetList(seq), entry);
+}
+
+
+bool QuotaIndex::Lookup(const shash::Any &hash, uint64_t *size) const {
+  Entry *entry;
+  if (!map_.Lookup(hash, &entry))
+    return false;
+  *size = entry->size;
+  return true;
+}
+
+
+const QuotaIndex::Entry *QuotaIndex::Next(const Entry *entry) const {
+  if (entry->next != NULL)
+    return entry->next;
+  if (entry == volatile_.tail)
+    return regular_.head;
+  return NULL;
+}
+
+
+void QuotaIndex::TakeDirty(vector<pair<shash::Any, uint64_t> > *dirty) {
+  dirty->clear();
+  for (unsigned i = 0; i < dirty_.size(); ++i) {
+    Entry *entry;
+    if (!map_.Lookup(dirty_[i], &entry) || !entry->dirty)
+      continue;
+    dirty->push_back(make_pair(entry->hash, entry->seq));
+    entry->dirty = false;
+  }
+  dirty_.clear();
+}
+
+
+bool QuotaIndex::Touch(const shash::Any &hash, const uint64_t seq) {
+  Entry *entry;
+  if (!map_.Lookup(hash, &entry))
+    return false;
+  List *list = GetList(entry->seq);
+  entry->seq = seq | (entry->seq & kVolatileFlag);
+  if (list->tail != entry) {
+    Unlink(list, entry);
+    Append(list, entry);
+  }
+  if (!entry->dirty) {
+    entry->dirty = true;
+    dirty_.push_back(hash);
+  }
+  return true;
+}
+
+
+void QuotaIndex::Unlink(List *list, Entry *entry) {
+  if (entry->prev != NULL)
+    entry->prev->next = entry->next;
+  else
+    list->head = entry->next;
+  if (entry->next != NULL)
+    entry->next->prev = entry->prev;
+  else
+    list->tail = entry->prev;
+  entry->prev = entry->next = NULL;
+}
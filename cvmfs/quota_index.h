@@ -0,0 +1,116 @@
+/**
+ * This file is part of the CernVM File System.
+ *
+ * An in-memory copy of the LRU order of the cache database, used by the posix
+ * quota manager to avoid an sqlite update for every touch.
+ */
+
+#ifndef CVMFS_QUOTA_INDEX_H_
+#define CVMFS_QUOTA_INDEX_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "hash.h"
+#include "smallhash.h"
+#include "util/single_copy.h"
+
+/**
+ * Keeps the cached objects in two doubly linked lists, one for volatile and
+ * one for regular objects, each in the order of the access sequence numbers.
+ * Volatile objects precede all regular objects in the LRU order, as they do in
+ * the cache database.  A hash table maps content hashes to list entries, so
+ * that touching, inserting, and removing an object is O(1) and cleanup is
+ * O(number of evicted objects).
+ *
+ * Objects whose sequence number changed since the last snapshot are dirty.
+ * The quota manager writes them back to the cache database periodically.
+ */
+class QuotaIndex : SingleCopy {
+ public:
+  /**
+   * Marks a volatile object in the sequence number, as in the cache database.
+   */
+  static const uint64_t kVolatileFlag = 1ULL << 63;
+
+  struct Entry {
+    Entry() : size(0), seq(0), dirty(false), prev(NULL), next(NULL) { }
+    shash::Any hash;
+    uint64_t size;
+    /**
+     * Includes kVolatileFlag for volatile objects
+     */
+    uint64_t seq;
+    bool dirty;
+    Entry *prev;
+    Entry *next;
+  };
+
+  QuotaIndex();
+  ~QuotaIndex();
+
+  /**
+   * Adds an object as the most recently used one of its kind or replaces an
+   * existing one.  The entry is not dirty because the caller writes new objects
+   * to the cache database immediately.  Entries of a snapshot need to be
+   * inserted in ascending order of their sequence number.
+   */
+  void Insert(const shash::Any &hash, const uint64_t size, const uint64_t seq);
+  /**
+   * Moves an object to the end of the LRU order.  Volatile objects stay
+   * volatile.  Returns false if the object is unknown.
+   */
+  bool Touch(const shash::Any &hash, const uint64_t seq);
+  bool Erase(const shash::Any &hash);
+  bool Contains(const shash::Any &hash) const { return map_.Contains(hash); }
+  bool Lookup(const shash::Any &hash, uint64_t *size) const;
+
+  /**
+   * The least recently used object, volatile objects first.  NULL if empty.
+   */
+  const Entry *Front() const;
+  /**
+   * The successor in LRU order or NULL.  Erasing an entry invalidates it, so
+   * Next() needs to be called before.
+   */
+  const Entry *Next(const Entry *entry) const;
+
+  /**
+   * Collects the dirty entries as (hash, sequence number) pairs and marks them
+   * clean.
+   */
+  void TakeDirty(std::vector<std::pair<shash::Any, uint64_t> > *dirty);
+
+  uint32_t size() const { return map_.size(); }
+  unsigned num_dirty() const { return dirty_.size(); }
+
+ private:
+  struct List {
+    List() : head(NULL), tail(NULL) { }
+    Entry *head;
+    Entry *tail;
+  };
+
+  static uint32_t hasher(const shash::Any &key) {
+    // Don't start with the first bytes, because == is using them as well
+    return (uint32_t) *(reinterpret_cast<const uint32_t *>(key.digest) + 1);
+  }
+
+  List *GetList(const uint64_t seq) {
+    return (seq & kVolatileFlag) ? &volatile_ : &regular_;
+  }
+  static void Append(List *list, Entry *entry);
+  static void Unlink(List *list, Entry *entry);
+
+  SmallHashDynamic<shash::Any, Entry *> map_;
+  List volatile_;
+  List regular_;
+  /**
+   * Hashes of entries that got dirty since the last call to TakeDirty().  May
+   * contain hashes that have been erased or inserted again in the meantime.
+   */
+  std::vector<shash::Any> dirty_;
+};
+
+#endif  // CVMFS_QUOTA_INDEX_H_
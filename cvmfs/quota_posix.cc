@@ -23,6 +23,7 @@
 #include <fcntl.h>
 #include <inttypes.h>
 #include <pthread.h>
+#include <sched.h>
 #include <signal.h>
 #include <stdint.h>
 #include <sys/dir.h>
@@ -45,11 +46,14 @@
 #include <string>
 #include <vector>
 
+#include "atomic.h"
 #include "duplex_sqlite3.h"
 #include "hash.h"
 #include "logging.h"
 #include "monitor.h"
 #include "platform.h"
+#include "quota_index.h"
+#include "quota_ring.h"
 #include "smalloc.h"
 #include "statistics.h"
 #include "util/exception.h"
@@ -60,6 +64,147 @@
 
 using namespace std;  // NOLINT
 
+namespace {
+
+/**
+ * State shared between the threads that scan the cache directories 00-ff
+ * during a rebuild of the cache database and the thread that inserts the
+ * found files into the database.
+ */
+struct RebuildScan {
+  struct File {
+    string hash;
+    uint64_t size;
+    int64_t atime;
+  };
+
+  struct Directory {
+    Directory() : failed(false) { }
+    string path;
+    bool failed;
+    vector<File> files;
+  };
+
+  RebuildScan(const string &cache_dir, const unsigned max_pending)
+    : cache_dir(cache_dir)
+    , max_pending(max_pending)
+  {
+    atomic_init32(&next_dir);
+    atomic_init32(&abort);
+    int retval = pthread_mutex_init(&lock, NULL);
+    assert(retval == 0);
+    retval = pthread_cond_init(&cond_results, NULL);
+    assert(retval == 0);
+    retval = pthread_cond_init(&cond_space, NULL);
+    assert(retval == 0);
+  }
+
+  ~RebuildScan() {
+    for (unsigned i = 0; i < results.size(); ++i)
+      delete results[i];
+    pthread_cond_destroy(&cond_space);
+    pthread_cond_destroy(&cond_results);
+    pthread_mutex_destroy(&lock);
+  }
+
+  const string cache_dir;
+  const unsigned max_pending;
+  atomic_int32 next_dir;
+  atomic_int32 abort;
+  pthread_mutex_t lock;
+  /**
+   * Signaled when a scanned directory is added to the results
+   */
+  pthread_cond_t cond_results;
+  /**
+   * Signaled when a scanned directory is taken from the results
+   */
+  pthread_cond_t cond_space;
+  vector<Directory *> results;
+};
+
+
+void ScanDirectory(const string &path, RebuildScan::Directory *dir) {
+  dir->path = path;
+  DIR *dirp = opendir(path.c_str());
+  if (dirp == NULL) {
+    dir->failed = true;
+    return;
+  }
+  const string prefix = GetFileName(path);
+  const int fd_dir = dirfd(dirp);
+  platform_dirent64 *d;
+  struct stat info;
+  while ((d = platform_readdir(dirp)) != NULL) {
+    if (fstatat(fd_dir, d->d_name, &info, 0) != 0) {
+      LogCvmfs(kLogQuota, kLogDebug, "could not stat %s/%s",
+               path.c_str(), d->d_name);
+      continue;
+    }
+    if (!S_ISREG(info.st_mode))
+      continue;
+    if (info.st_size == 0) {
+      LogCvmfs(kLogQuota, kLogSyslog | kLogDebug,
+               "removing empty file %s/%s during automatic cache db rebuild",
+               path.c_str(), d->d_name);
+      unlinkat(fd_dir, d->d_name, 0);
+      continue;
+    }
+    RebuildScan::File file;
+    file.hash = prefix + string(d->d_name);
+    file.size = info.st_size;
+    file.atime = info.st_atime;
+    dir->files.push_back(file);
+  }
+  closedir(dirp);
+}
+
+
+void *MainRebuildScanner(void *data) {
+  RebuildScan *scan = static_cast<RebuildScan *>(data);
+  char hex[4];
+  while (atomic_read32(&scan->abort) == 0) {
+    const int32_t i = atomic_xadd32(&scan->next_dir, 1);
+    if (i > 0xff)
+      break;
+    snprintf(hex, sizeof(hex), "%02x", i);
+    RebuildScan::Directory *dir = new RebuildScan::Directory();
+    ScanDirectory(scan->cache_dir + "/" + string(hex), dir);
+
+    MutexLockGuard guard(&scan->lock);
+    while ((scan->results.size() >= scan->max_pending) &&
+           (atomic_read32(&scan->abort) == 0))
+    {
+      pthread_cond_wait(&scan->cond_space, &scan->lock);
+    }
+    scan->results.push_back(dir);
+    pthread_cond_signal(&scan->cond_results);
+  }
+  return NULL;
+}
+
+void WriteRebuildStatus(
+  const string &path,
+  const string &state,
+  const unsigned num_dirs,
+  const uint64_t num_objects,
+  const uint64_t elapsed)
+{
+  const uint64_t rate = num_objects / ((elapsed > 0) ? elapsed : 1);
+  const string status =
+    "status: " + state + "\n" +
+    "directories: " + StringifyInt(num_dirs) + "/256\n" +
+    "objects: " + StringifyUint(num_objects) + "\n" +
+    "elapsed: " + StringifyUint(elapsed) + "s\n" +
+    "rate: " + StringifyUint(rate) + " objects/s\n";
+  if (!SafeWriteToFile(status, path, 0600)) {
+    LogCvmfs(kLogQuota, kLogDebug, "failed to write rebuild status to %s",
+             path.c_str());
+  }
+}
+
+}  // anonymous namespace
+
 
 int PosixQuotaManager::BindReturnPipe(int pipe_wronly) {
   if (!shared_)
@@ -144,6 +289,15 @@ bool PosixQuotaManager::Cleanup(const uint64_t leave_size) {
 
 
 void PosixQuotaManager::CloseDatabase() {
+  if (index_ != NULL) {
+    if (database_ != NULL) {
+      sqlite3_exec(database_, "BEGIN", NULL, NULL, NULL);
+      SnapshotIndex();
+      sqlite3_exec(database_, "COMMIT", NULL, NULL, NULL);
+    }
+    delete index_;
+    index_ = NULL;
+  }
   if (stmt_list_catalogs_) sqlite3_finalize(stmt_list_catalogs_);
   if (stmt_list_pinned_) sqlite3_finalize(stmt_list_pinned_);
   if (stmt_list_volatile_) sqlite3_finalize(stmt_list_volatile_);
@@ -231,7 +385,8 @@ PosixQuotaManager *PosixQuotaManager::Create(
   const string &cache_workspace,
   const uint64_t limit,
   const uint64_t cleanup_threshold,
-  const bool rebuild_database)
+  const bool rebuild_database,
+  const bool memory_index)
 {
   if (cleanup_threshold >= limit) {
     LogCvmfs(kLogQuota, kLogDebug, "invalid parameters: limit %" PRIu64 ", "
@@ -241,6 +396,7 @@ PosixQuotaManager *PosixQuotaManager::Create(
 
   PosixQuotaManager *quota_manager =
     new PosixQuotaManager(limit, cleanup_threshold, cache_workspace);
+  quota_manager->memory_index_ = memory_index;
 
   // Initialize cache catalog
   if (!quota_manager->InitDatabase(rebuild_database)) {
@@ -249,6 +405,8 @@ PosixQuotaManager *PosixQuotaManager::Create(
   }
   quota_manager->CheckFreeSpace();
   MakePipe(quota_manager->pipe_lru_);
+  quota_manager->ring_ =
+    QuotaRing::CreateAnonymous(QuotaRing::kDefaultNumSlots);
 
   quota_manager->protocol_revision_ = kProtocolRevision;
   quota_manager->initialized_ = true;
@@ -264,7 +422,8 @@ PosixQuotaManager *PosixQuotaManager::CreateShared(
   const std::string &cache_workspace,
   const uint64_t limit,
   const uint64_t cleanup_threshold,
-  bool foreground)
+  bool foreground,
+  const bool memory_index)
 {
   string cache_dir;
   string workspace_dir;
@@ -300,6 +459,8 @@ PosixQuotaManager *PosixQuotaManager::CreateShared(
       quota_mgr->protocol_revision_ = quota_mgr->GetProtocolRevision();
       LogCvmfs(kLogQuota, kLogDebug, "connected protocol revision %u",
                quota_mgr->protocol_revision_);
+      if (quota_mgr->protocol_revision_ >= 3)
+        quota_mgr->ring_ = QuotaRing::Attach(workspace_dir + "/cachemgr.ring");
     } else {
       LogCvmfs(kLogQuota, kLogDebug, "connected to ancient cache manager");
     }
@@ -351,6 +512,7 @@ PosixQuotaManager *PosixQuotaManager::CreateShared(
   command_line.push_back(StringifyInt(GetLogSyslogLevel()));
   command_line.push_back(StringifyInt(GetLogSyslogFacility()));
   command_line.push_back(GetLogDebugFile() + ":" + GetLogMicroSyslog());
+  command_line.push_back(StringifyInt(memory_index));
 
   set<int> preserve_filedes;
   preserve_filedes.insert(0);
@@ -409,6 +571,7 @@ PosixQuotaManager *PosixQuotaManager::CreateShared(
   Nonblock2Block(quota_mgr->pipe_lru_[1]);
   LogCvmfs(kLogQuota, kLogDebug, "connected to a new cache manager");
   quota_mgr->protocol_revision_ = kProtocolRevision;
+  quota_mgr->ring_ = QuotaRing::Attach(workspace_dir + "/cachemgr.ring");
 
   UnlockFile(fd_lockfile);
 
@@ -435,51 +598,80 @@ bool PosixQuotaManager::DoCleanup(const uint64_t leave_size) {
   string hash_str;
   vector<string> trash;
 
-  do {
-    sqlite3_reset(stmt_lru_);
-    if (sqlite3_step(stmt_lru_) != SQLITE_ROW) {
-      LogCvmfs(kLogQuota, kLogDebug, "could not get lru-entry");
-      break;
+  if (index_ != NULL) {
+    const QuotaIndex::Entry *entry = index_->Front();
+    while ((entry != NULL) && (gauge_ > leave_size)) {
+      const QuotaIndex::Entry *next = index_->Next(entry);
+      // Not yet inserted pinned files are skipped, see below
+      if (pinned_chunks_.find(entry->hash) == pinned_chunks_.end()) {
+        const shash::Any hash = entry->hash;
+        hash_str = hash.ToString();
+        trash.push_back(cache_dir_ + "/" + hash.MakePathWithoutSuffix());
+        gauge_ -= entry->size;
+        LogCvmfs(kLogQuota, kLogDebug, "lru cleanup %s, new gauge %" PRIu64,
+                 hash_str.c_str(), gauge_);
+
+        sqlite3_bind_text(stmt_rm_, 1, &hash_str[0], hash_str.length(),
+                          SQLITE_STATIC);
+        result = (sqlite3_step(stmt_rm_) == SQLITE_DONE);
+        sqlite3_reset(stmt_rm_);
+        if (!result) {
+          LogCvmfs(kLogQuota, kLogDebug | kLogSyslogErr,
+                   "failed to remove %s from cache database",
+                   hash_str.c_str());
+          return false;
+        }
+        index_->Erase(hash);
+      }
+      entry = next;
     }
+  } else {
+    do {
+      sqlite3_reset(stmt_lru_);
+      if (sqlite3_step(stmt_lru_) != SQLITE_ROW) {
+        LogCvmfs(kLogQuota, kLogDebug, "could not get lru-entry");
+        break;
+      }
 
-    hash_str = string(reinterpret_cast<const char *>(
-                      sqlite3_column_text(stmt_lru_, 0)));
-    LogCvmfs(kLogQuota, kLogDebug, "removing %s", hash_str.c_str());
-    shash::Any hash = shash::MkFromHexPtr(shash::HexPtr(hash_str));
-
-    // That's a critical condition.  We must not delete a not yet inserted
-    // pinned file as it is already reserved (but will be inserted later).
-    // Instead, set the pin bit in the db to not run into an endless loop
-    if (pinned_chunks_.find(hash) == pinned_chunks_.end()) {
-      trash.push_back(cache_dir_ + "/" + hash.MakePathWithoutSuffix());
-      gauge_ -= sqlite3_column_int64(stmt_lru_, 1);
-      LogCvmfs(kLogQuota, kLogDebug, "lru cleanup %s, new gauge %" PRIu64,
-               hash_str.c_str(), gauge_);
-
-      sqlite3_bind_text(stmt_rm_, 1, &hash_str[0], hash_str.length(),
-                        SQLITE_STATIC);
-      result = (sqlite3_step(stmt_rm_) == SQLITE_DONE);
-      sqlite3_reset(stmt_rm_);
-
-      if (!result) {
-        LogCvmfs(kLogQuota, kLogDebug | kLogSyslogErr,
-                 "failed to find %s in cache database (%d). "
-                 "Cache database is out of sync. "
-                 "Restart cvmfs with clean cache.", hash_str.c_str(), result);
-        return false;
+      hash_str = string(reinterpret_cast<const char *>(
+                        sqlite3_column_text(stmt_lru_, 0)));
+      LogCvmfs(kLogQuota, kLogDebug, "removing %s", hash_str.c_str());
+      shash::Any hash = shash::MkFromHexPtr(shash::HexPtr(hash_str));
+
+      // That's a critical condition.  We must not delete a not yet inserted
+      // pinned file as it is already reserved (but will be inserted later).
+      // Instead, set the pin bit in the db to not run into an endless loop
+      if (pinned_chunks_.find(hash) == pinned_chunks_.end()) {
+        trash.push_back(cache_dir_ + "/" + hash.MakePathWithoutSuffix());
+        gauge_ -= sqlite3_column_int64(stmt_lru_, 1);
+        LogCvmfs(kLogQuota, kLogDebug, "lru cleanup %s, new gauge %" PRIu64,
+                 hash_str.c_str(), gauge_);
+
+        sqlite3_bind_text(stmt_rm_, 1, &hash_str[0], hash_str.length(),
+                          SQLITE_STATIC);
+        result = (sqlite3_step(stmt_rm_) == SQLITE_DONE);
+        sqlite3_reset(stmt_rm_);
+
+        if (!result) {
+          LogCvmfs(kLogQuota, kLogDebug | kLogSyslogErr,
+                   "failed to find %s in cache database (%d). "
+                   "Cache database is out of sync. "
+                   "Restart cvmfs with clean cache.", hash_str.c_str(), result);
+          return false;
+        }
+      } else {
+        sqlite3_bind_text(stmt_block_, 1, &hash_str[0], hash_str.length(),
+                          SQLITE_STATIC);
+        result = (sqlite3_step(stmt_block_) == SQLITE_DONE);
+        sqlite3_reset(stmt_block_);
+        assert(result);
       }
-    } else {
-      sqlite3_bind_text(stmt_block_, 1, &hash_str[0], hash_str.length(),
-                        SQLITE_STATIC);
-      result = (sqlite3_step(stmt_block_) == SQLITE_DONE);
-      sqlite3_reset(stmt_block_);
-      assert(result);
-    }
-  } while (gauge_ > leave_size);
+    } while (gauge_ > leave_size);
 
-  result = (sqlite3_step(stmt_unblock_) == SQLITE_DONE);
-  sqlite3_reset(stmt_unblock_);
-  assert(result);
+    result = (sqlite3_step(stmt_unblock_) == SQLITE_DONE);
+    sqlite3_reset(stmt_unblock_);
+    assert(result);
+  }
 
   // Double fork avoids zombie, forked removal process must not flush file
   // buffers
@@ -528,6 +720,65 @@ bool PosixQuotaManager::DoCleanup(const uint64_t leave_size) {
 }
 
 
+/**
+ * Collects the commands from the ring in the command buffer.  Returns the new
+ * number of buffered commands.
+ */
+unsigned PosixQuotaManager::DrainRing(
+  LruCommand *commands,
+  char *descriptions,
+  unsigned num_commands)
+{
+  // Briefly wait for the producers that already claimed a slot, so that their
+  // records are processed before the next command on the pipe.  A producer
+  // that does not publish in time is left behind; it wakes up the consumer
+  // once it publishes.
+  const int64_t barrier = ring_->head();
+  const uint64_t deadline_ns =
+    platform_monotonic_time_ns() + kRingBarrierTimeoutMs * 1000 * 1000;
+  unsigned char record[QuotaRing::kRecordSize];
+  unsigned size;
+  while (true) {
+    if (!ring_->Pop(record, &size)) {
+      if ((ring_->tail() >= barrier) ||
+          (platform_monotonic_time_ns() >= deadline_ns))
+      {
+        break;
+      }
+      sched_yield();
+      continue;
+    }
+
+    // The ring is writable by all clients, don't trust its content
+    const LruCommand *cmd = reinterpret_cast<LruCommand *>(record);
+    const CommandType command_type = cmd->command_type;
+    if ((size < sizeof(LruCommand)) ||
+        ((command_type != kTouch) && (command_type != kInsert) &&
+         (command_type != kInsertVolatile) && (command_type != kPin) &&
+         (command_type != kPinRegular)) ||
+        (cmd->desc_length > kMaxDescription) ||
+        (size != sizeof(LruCommand) + cmd->desc_length))
+    {
+      LogCvmfs(kLogQuota, kLogDebug | kLogSyslogWarn,
+               "dropping invalid record from command ring");
+      continue;
+    }
+
+    LogCvmfs(kLogQuota, kLogDebug, "received command %d from ring",
+             command_type);
+    commands[num_commands] = *cmd;
+    memcpy(&descriptions[kMaxDescription*num_commands],
+           record + sizeof(LruCommand), cmd->desc_length);
+    num_commands++;
+    if (num_commands == kCommandBufferSize) {
+      ProcessCommandBunch(num_commands, commands, descriptions);
+      num_commands = 0;
+    }
+  }
+  return num_commands;
+}
+
+
 void PosixQuotaManager::DoInsert(
   const shash::Any &hash,
   const uint64_t size,
@@ -549,7 +800,7 @@ void PosixQuotaManager::DoInsert(
   cmd->desc_length = desc_length;
   memcpy(reinterpret_cast<char *>(cmd)+sizeof(LruCommand),
          &description[0], desc_length);
-  WritePipe(pipe_lru_[1], cmd, sizeof(LruCommand) + desc_length);
+  PostCommand(cmd, sizeof(LruCommand) + desc_length);
 }
 
 
@@ -654,6 +905,20 @@ uint32_t PosixQuotaManager::GetProtocolRevision() {
 }
 
 
+/**
+ * Reads the progress of the last rebuild from cachedb.rebuild in cache_dir.
+ */
+string PosixQuotaManager::GetRebuildStatus(const string &cache_dir) {
+  const int fd = open((cache_dir + "/cachedb.rebuild").c_str(), O_RDONLY);
+  if (fd < 0)
+    return "";
+  string status;
+  const bool retval = SafeReadToString(fd, &status);
+  close(fd);
+  return retval ? status : "";
+}
+
+
 /**
  * Queries the shared local hard disk quota manager.
  */
@@ -838,6 +1103,9 @@ bool PosixQuotaManager::InitDatabase(const bool rebuild_database) {
   }
   sqlite3_finalize(stmt);
 
+  if (memory_index_ && !LoadIndex())
+    goto init_database_fail;
+
   // Prepare touch, new, remove statements
   sqlite3_prepare_v2(database_,
                      "UPDATE cache_catalog SET acseq=:seq | (acseq&(1<<63)) "
@@ -880,6 +1148,8 @@ bool PosixQuotaManager::InitDatabase(const bool rebuild_database) {
   return true;
 
  init_database_fail:
+  delete index_;
+  index_ = NULL;
   sqlite3_close(database_);
   database_ = NULL;
   UnlockFile(fd_lock_cachedb_);
@@ -938,6 +1208,43 @@ vector<string> PosixQuotaManager::ListCatalogs() {
 }
 
 
+/**
+ * Fills the memory index from the cache database in LRU order.
+ */
+bool PosixQuotaManager::LoadIndex() {
+  index_ = new QuotaIndex();
+  sqlite3_stmt *stmt;
+  int retval = sqlite3_prepare_v2(database_,
+    "SELECT sha1, size, acseq FROM cache_catalog ORDER BY acseq;", -1, &stmt,
+    NULL);
+  if (retval != SQLITE_OK) {
+    LogCvmfs(kLogQuota, kLogDebug, "could not prepare loading memory index");
+    return false;
+  }
+  while ((retval = sqlite3_step(stmt)) == SQLITE_ROW) {
+    const string hash_str(
+      reinterpret_cast<const char *>(sqlite3_column_text(stmt, 0)));
+    const shash::Any hash = shash::MkFromHexPtr(shash::HexPtr(hash_str));
+    if (hash.algorithm == shash::kAny) {
+      LogCvmfs(kLogQuota, kLogDebug | kLogSyslogWarn,
+               "ignoring invalid cache database entry %s", hash_str.c_str());
+      continue;
+    }
+    index_->Insert(hash, sqlite3_column_int64(stmt, 1),
+                   sqlite3_column_int64(stmt, 2));
+  }
+  sqlite3_finalize(stmt);
+  if (retval != SQLITE_DONE) {
+    LogCvmfs(kLogQuota, kLogDebug, "could not load memory index (%d)", retval);
+    return false;
+  }
+  last_snapshot_ = platform_monotonic_time();
+  LogCvmfs(kLogQuota, kLogDebug, "loaded %u entries into memory index",
+           index_->size());
+  return true;
+}
+
+
 /**
  * Lists only files flagged as volatile (priority removal)
  */
@@ -946,6 +1253,27 @@ vector<string> PosixQuotaManager::ListVolatile() {
 }
 
 
+/**
+ * Sends a fire-and-forget command through the ring if possible.  Falls back to
+ * the pipe if the ring is unavailable or full.
+ */
+void PosixQuotaManager::PostCommand(const LruCommand *cmd, const unsigned size)
+{
+  if (ring_ != NULL) {
+    bool wakeup;
+    if (ring_->Push(cmd, size, &wakeup)) {
+      if (wakeup) {
+        LruCommand notify;
+        notify.command_type = kRingNotify;
+        WritePipe(pipe_lru_[1], &notify, sizeof(notify));
+      }
+      return;
+    }
+  }
+  WritePipe(pipe_lru_[1], cmd, size);
+}
+
+
 /**
  * Entry point for the shared cache manager process
  */
@@ -970,6 +1298,8 @@ int PosixQuotaManager::MainCacheManager(int argc, char **argv) {
   int syslog_level = String2Int64(argv[8]);
   int syslog_facility = String2Int64(argv[9]);
   vector<string> logfiles = SplitString(argv[10], ':');
+  if (argc > 11)
+    shared_manager.memory_index_ = String2Int64(argv[11]);
 
   SetLogSyslogLevel(syslog_level);
   SetLogSyslogFacility(syslog_facility);
@@ -1021,6 +1351,16 @@ int PosixQuotaManager::MainCacheManager(int argc, char **argv) {
   }
   shared_manager.CheckFreeSpace();
 
+  // Clients attach to the ring once they see the protocol revision.  Without
+  // a ring, clients fall back to the pipe.
+  const string ring_path = shared_manager.workspace_dir_ + "/cachemgr.ring";
+  shared_manager.ring_ =
+    QuotaRing::Create(ring_path, QuotaRing::kDefaultNumSlots);
+  if (shared_manager.ring_ == NULL) {
+    LogCvmfs(kLogQuota, kLogDebug | kLogSyslogWarn,
+             "failed to create command ring, using pipe only");
+  }
+
   // Save protocol revision to file.  If the file is not found, it indicates
   // to the client that the cache manager is from times before the protocol
   // was versioned.
@@ -1070,6 +1410,9 @@ int PosixQuotaManager::MainCacheManager(int argc, char **argv) {
   shared_manager.MainCommandServer(&shared_manager);
   unlink(fifo_path.c_str());
   unlink(protocol_revision_path.c_str());
+  unlink(ring_path.c_str());
+  delete shared_manager.ring_;
+  shared_manager.ring_ = NULL;
   shared_manager.CloseDatabase();
   unlink(crash_guard.c_str());
   UnlockFile(fd_lockfile_fifo);
@@ -1089,15 +1432,30 @@ void *PosixQuotaManager::MainCommandServer(void *data) {
   LogCvmfs(kLogQuota, kLogDebug, "starting quota manager");
   sqlite3_soft_heap_limit(quota_mgr->kSqliteMemPerThread);
 
-  LruCommand command_buffer[kCommandBufferSize];
-  char description_buffer[kCommandBufferSize*kMaxDescription];
+  LruCommand *command_buffer = new LruCommand[kCommandBufferSize];
+  char *description_buffer = new char[kCommandBufferSize*kMaxDescription];
   unsigned num_commands = 0;
 
-  while (read(quota_mgr->pipe_lru_[0], &command_buffer[num_commands],
-              sizeof(command_buffer[0])) == sizeof(command_buffer[0]))
-  {
+  while (true) {
+    // Commands from the ring are older than the next command on the pipe
+    if (quota_mgr->ring_ != NULL) {
+      num_commands = quota_mgr->DrainRing(command_buffer, description_buffer,
+                                          num_commands);
+      if (!quota_mgr->ring_->MarkIdle())
+        continue;
+    }
+
+    if (read(quota_mgr->pipe_lru_[0], &command_buffer[num_commands],
+             sizeof(command_buffer[0])) != sizeof(command_buffer[0]))
+    {
+      break;
+    }
+
     const CommandType command_type = command_buffer[num_commands].command_type;
     LogCvmfs(kLogQuota, kLogDebug, "received command %d", command_type);
+    // Wake-up call, the commands are in the ring
+    if (command_type == kRingNotify)
+      continue;
     const uint64_t size = command_buffer[num_commands].GetSize();
 
     // Inserts and pins come with a description (usually a path)
@@ -1249,6 +1607,8 @@ void *PosixQuotaManager::MainCommandServer(void *data) {
             retval = sqlite3_step(quota_mgr->stmt_rm_);
             if ((retval == SQLITE_DONE) || (retval == SQLITE_OK)) {
               quota_mgr->gauge_ -= size;
+              if (quota_mgr->index_ != NULL)
+                quota_mgr->index_->Erase(hash);
             } else {
               LogCvmfs(kLogQuota, kLogDebug | kLogSyslogErr,
                        "failed to delete %s (%d)", hash_str.c_str(), retval);
@@ -1309,6 +1669,8 @@ void *PosixQuotaManager::MainCommandServer(void *data) {
             if ((retval == SQLITE_DONE) || (retval == SQLITE_OK)) {
               success = true;
               quota_mgr->gauge_ -= size;
+              if (quota_mgr->index_ != NULL)
+                quota_mgr->index_->Erase(hash);
               if (is_pinned) {
                 quota_mgr->pinned_chunks_.erase(hash);
                 quota_mgr->pinned_ -= size;
@@ -1382,6 +1744,10 @@ void *PosixQuotaManager::MainCommandServer(void *data) {
 
   LogCvmfs(kLogQuota, kLogDebug, "stopping cache manager (%d)", errno);
   close(quota_mgr->pipe_lru_[0]);
+  if (quota_mgr->ring_ != NULL) {
+    num_commands = quota_mgr->DrainRing(command_buffer, description_buffer,
+                                        num_commands);
+  }
   quota_mgr->ProcessCommandBunch(num_commands, command_buffer,
                                  description_buffer);
 
@@ -1395,6 +1761,8 @@ void *PosixQuotaManager::MainCommandServer(void *data) {
     quota_mgr->ProcessCommandBunch(1, command_buffer, description_buffer);
   }
 
+  delete[] command_buffer;
+  delete[] description_buffer;
   return NULL;
 }
 
@@ -1529,6 +1897,7 @@ PosixQuotaManager::PosixQuotaManager(
   , seq_(0)
   , cache_dir_()  // initialized in body
   , workspace_dir_()  // initialized in body
+  , ring_(NULL)
   , fd_lock_cachedb_(-1)
   , async_delete_(true)
   , database_(NULL)
@@ -1544,6 +1913,9 @@ PosixQuotaManager::PosixQuotaManager(
   , stmt_list_pinned_(NULL)
   , stmt_list_catalogs_(NULL)
   , stmt_list_volatile_(NULL)
+  , memory_index_(false)
+  , index_(NULL)
+  , last_snapshot_(0)
   , initialized_(false)
 {
   ParseDirectories(cache_workspace, &cache_dir_, &workspace_dir_);
@@ -1564,6 +1936,7 @@ PosixQuotaManager::~PosixQuotaManager() {
   if (shared_) {
     // Most of cleanup is done elsewhen by shared cache manager
     close(pipe_lru_[1]);
+    delete ring_;
     return;
   }
 
@@ -1575,6 +1948,7 @@ PosixQuotaManager::~PosixQuotaManager() {
   } else {
     ClosePipe(pipe_lru_);
   }
+  delete ring_;
 
   CloseDatabase();
 }
@@ -1585,10 +1959,23 @@ void PosixQuotaManager::ProcessCommandBunch(
   const LruCommand *commands,
   const char *descriptions)
 {
+  // Only the last touch of a hash in the bunch matters
+  vector<bool> superseded(num, false);
+  set<shash::Any> touched;
+  for (unsigned i = num; i > 0; --i) {
+    if (commands[i - 1].command_type != kTouch)
+      continue;
+    const shash::Any hash = commands[i - 1].RetrieveHash();
+    if (!touched.insert(hash).second)
+      superseded[i - 1] = true;
+  }
+
   int retval = sqlite3_exec(database_, "BEGIN", NULL, NULL, NULL);
   assert(retval == SQLITE_OK);
 
   for (unsigned i = 0; i < num; ++i) {
+    if (superseded[i])
+      continue;
     const shash::Any hash = commands[i].RetrieveHash();
     const string hash_str = hash.ToString();
     const unsigned size = commands[i].GetSize();
@@ -1596,8 +1983,14 @@ void PosixQuotaManager::ProcessCommandBunch(
              hash_str.c_str(), commands[i].command_type);
 
     bool exists;
+    uint64_t seq;
     switch (commands[i].command_type) {
       case kTouch:
+        if (index_ != NULL) {
+          // Written back by the next snapshot
+          index_->Touch(hash, seq_++);
+          break;
+        }
         sqlite3_bind_int64(stmt_touch_, 1, seq_++);
         sqlite3_bind_text(stmt_touch_, 2, &hash_str[0], hash_str.length(),
                           SQLITE_STATIC);
@@ -1627,7 +2020,7 @@ void PosixQuotaManager::ProcessCommandBunch(
       case kInsert:
       case kInsertVolatile:
         // It could already be in, check
-        exists = Contains(hash_str);
+        exists = (index_ != NULL) ? index_->Contains(hash) : Contains(hash_str);
 
         // Cleanup, move to trash and unlink
         if (!exists && (gauge_ + size > limit_)) {
@@ -1641,11 +2034,10 @@ void PosixQuotaManager::ProcessCommandBunch(
         sqlite3_bind_text(stmt_new_, 1, &hash_str[0], hash_str.length(),
                           SQLITE_STATIC);
         sqlite3_bind_int64(stmt_new_, 2, size);
-        if (commands[i].command_type == kInsertVolatile) {
-          sqlite3_bind_int64(stmt_new_, 3, (seq_++) | kVolatileFlag);
-        } else {
-          sqlite3_bind_int64(stmt_new_, 3, seq_++);
-        }
+        seq = seq_++;
+        if (commands[i].command_type == kInsertVolatile)
+          seq |= kVolatileFlag;
+        sqlite3_bind_int64(stmt_new_, 3, seq);
         sqlite3_bind_text(stmt_new_, 4, &descriptions[i*kMaxDescription],
                           commands[i].desc_length, SQLITE_STATIC);
         sqlite3_bind_int64(stmt_new_, 5, (commands[i].command_type == kPin) ?
@@ -1661,6 +2053,8 @@ void PosixQuotaManager::ProcessCommandBunch(
                 hash_str.c_str(), retval);
         }
         sqlite3_reset(stmt_new_);
+        if (index_ != NULL)
+          index_->Insert(hash, size, seq);
 
         if (!exists) gauge_ += size;
         break;
@@ -1670,6 +2064,12 @@ void PosixQuotaManager::ProcessCommandBunch(
     }
   }
 
+  if ((index_ != NULL) && (index_->num_dirty() > 0) &&
+      (platform_monotonic_time() >= last_snapshot_ + kSnapshotIntervalSec))
+  {
+    SnapshotIndex();
+  }
+
   retval = sqlite3_exec(database_, "COMMIT", NULL, NULL, NULL);
   if (retval != SQLITE_OK) {
     PANIC(kLogSyslogErr, "failed to commit to cachedb, error %d", retval);
@@ -1684,14 +2084,19 @@ bool PosixQuotaManager::RebuildDatabase() {
   sqlite3_stmt *stmt_insert = NULL;
   int sqlerr;
   int seq = 0;
-  char hex[4];
-  struct stat info;
-  platform_dirent64 *d;
-  DIR *dirp = NULL;
-  string path;
+  bool in_transaction = false;
 
   LogCvmfs(kLogQuota, kLogSyslog | kLogDebug, "re-building cache database");
 
+  // A single transaction for all the inserts, otherwise every insert is
+  // synced to disk
+  sqlerr = sqlite3_exec(database_, "BEGIN", NULL, NULL, NULL);
+  if (sqlerr != SQLITE_OK) {
+    LogCvmfs(kLogQuota, kLogDebug, "could not start transaction (%d)", sqlerr);
+    goto build_return;
+  }
+  in_transaction = true;
+
   // Empty cache catalog and fscache
   sql = "DELETE FROM cache_catalog; DELETE FROM fscache;";
   sqlerr = sqlite3_exec(database_, sql.c_str(), NULL, NULL, NULL);
@@ -1703,51 +2108,10 @@ bool PosixQuotaManager::RebuildDatabase() {
   gauge_ = 0;
 
   // Insert files from cache sub-directories 00 - ff
-  // TODO(jblomer): fs_traversal
   sqlite3_prepare_v2(database_, "INSERT INTO fscache (sha1, size, actime) "
                      "VALUES (:sha1, :s, :t);", -1, &stmt_insert, NULL);
-
-  for (int i = 0; i <= 0xff; i++) {
-    snprintf(hex, sizeof(hex), "%02x", i);
-    path = cache_dir_ + "/" + string(hex);
-    if ((dirp = opendir(path.c_str())) == NULL) {
-      LogCvmfs(kLogQuota, kLogDebug | kLogSyslogErr,
-               "failed to open directory %s (tmpwatch interfering?)",
-               path.c_str());
-      goto build_return;
-    }
-    while ((d = platform_readdir(dirp)) != NULL) {
-      string file_path = path + "/" + string(d->d_name);
-      if (stat(file_path.c_str(), &info) == 0) {
-        if (!S_ISREG(info.st_mode))
-          continue;
-        if (info.st_size == 0) {
-          LogCvmfs(kLogQuota, kLogSyslog | kLogDebug,
-                   "removing empty file %s during automatic cache db rebuild",
-                   file_path.c_str());
-          unlink(file_path.c_str());
-          continue;
-        }
-
-        string hash = string(hex) + string(d->d_name);
-        sqlite3_bind_text(stmt_insert, 1, hash.data(), hash.length(),
-                          SQLITE_STATIC);
-        sqlite3_bind_int64(stmt_insert, 2, info.st_size);
-        sqlite3_bind_int64(stmt_insert, 3, info.st_atime);
-        if (sqlite3_step(stmt_insert) != SQLITE_DONE) {
-          LogCvmfs(kLogQuota, kLogDebug, "could not insert into temp table");
-          goto build_return;
-        }
-        sqlite3_reset(stmt_insert);
-
-        gauge_ += info.st_size;
-      } else {
-        LogCvmfs(kLogQuota, kLogDebug, "could not stat %s", file_path.c_str());
-      }
-    }
-    closedir(dirp);
-    dirp = NULL;
-  }
+  if (!ScanCacheDirectories(stmt_insert))
+    goto build_return;
   sqlite3_finalize(stmt_insert);
   stmt_insert = NULL;
 
@@ -1788,6 +2152,14 @@ bool PosixQuotaManager::RebuildDatabase() {
     goto build_return;
   }
 
+  sqlerr = sqlite3_exec(database_, "COMMIT", NULL, NULL, NULL);
+  if (sqlerr != SQLITE_OK) {
+    LogCvmfs(kLogQuota, kLogDebug | kLogSyslogErr,
+             "could not commit rebuilt cache database (%d)", sqlerr);
+    goto build_return;
+  }
+  in_transaction = false;
+
   seq_ = seq;
   result = true;
   LogCvmfs(kLogQuota, kLogDebug,
@@ -1797,7 +2169,100 @@ bool PosixQuotaManager::RebuildDatabase() {
  build_return:
   if (stmt_insert) sqlite3_finalize(stmt_insert);
   if (stmt_select) sqlite3_finalize(stmt_select);
-  if (dirp) closedir(dirp);
+  if (in_transaction)
+    sqlite3_exec(database_, "ROLLBACK", NULL, NULL, NULL);
+  return result;
+}
+
+
+/**
+ * Scans the cache directories 00 - ff with kRebuildThreads threads and inserts
+ * the found files into the fscache table.  Progress is written to the
+ * cachedb.rebuild file in the cache directory, where GetRebuildStatus() finds
+ * it.
+ */
+bool PosixQuotaManager::ScanCacheDirectories(sqlite3_stmt *stmt_insert) {
+  const string status_path = cache_dir_ + "/cachedb.rebuild";
+  const uint64_t start = platform_monotonic_time();
+  uint64_t last_status = start;
+  uint64_t num_objects = 0;
+  unsigned num_dirs = 0;
+  bool result = true;
+
+  RebuildScan scan(cache_dir_, kRebuildMaxPending);
+  vector<pthread_t> threads;
+  for (unsigned i = 0; i < kRebuildThreads; ++i) {
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, MainRebuildScanner, &scan) != 0)
+      break;
+    threads.push_back(thread);
+  }
+  if (threads.empty()) {
+    LogCvmfs(kLogQuota, kLogDebug | kLogSyslogErr,
+             "failed to start cache directory scanners");
+    return false;
+  }
+
+  while (num_dirs <= 0xff) {
+    RebuildScan::Directory *dir;
+    {
+      MutexLockGuard guard(&scan.lock);
+      while (scan.results.empty())
+        pthread_cond_wait(&scan.cond_results, &scan.lock);
+      dir = scan.results.front();
+      scan.results.erase(scan.results.begin());
+      pthread_cond_signal(&scan.cond_space);
+    }
+    UniquePtr<RebuildScan::Directory> dir_guard(dir);
+    num_dirs++;
+
+    if (dir->failed) {
+      LogCvmfs(kLogQuota, kLogDebug | kLogSyslogErr,
+               "failed to open directory %s (tmpwatch interfering?)",
+               dir->path.c_str());
+      result = false;
+      break;
+    }
+    for (unsigned i = 0; i < dir->files.size(); ++i) {
+      const RebuildScan::File &file = dir->files[i];
+      sqlite3_bind_text(stmt_insert, 1, file.hash.data(), file.hash.length(),
+                        SQLITE_STATIC);
+      sqlite3_bind_int64(stmt_insert, 2, file.size);
+      sqlite3_bind_int64(stmt_insert, 3, file.atime);
+      if (sqlite3_step(stmt_insert) != SQLITE_DONE) {
+        LogCvmfs(kLogQuota, kLogDebug, "could not insert into temp table");
+        result = false;
+        break;
+      }
+      sqlite3_reset(stmt_insert);
+      gauge_ += file.size;
+    }
+    if (!result)
+      break;
+    num_objects += dir->files.size();
+
+    const uint64_t now = platform_monotonic_time();
+    if (now > last_status) {
+      WriteRebuildStatus(status_path, "running", num_dirs, num_objects,
+                         now - start);
+      last_status = now;
+    }
+  }
+
+  if (!result) {
+    atomic_inc32(&scan.abort);
+    MutexLockGuard guard(&scan.lock);
+    pthread_cond_broadcast(&scan.cond_space);
+  }
+  for (unsigned i = 0; i < threads.size(); ++i)
+    pthread_join(threads[i], NULL);
+
+  const uint64_t elapsed = platform_monotonic_time() - start;
+  WriteRebuildStatus(status_path, result ? "done" : "failed", num_dirs,
+                     num_objects, elapsed);
+  LogCvmfs(kLogQuota, kLogSyslog | kLogDebug,
+           "scanned %u cache directories, %" PRIu64 " objects in %" PRIu64
+           " seconds", num_dirs, num_objects, elapsed);
   return result;
 }
 
@@ -1858,6 +2323,32 @@ void PosixQuotaManager::Remove(const shash::Any &hash) {
 }
 
 
+/**
+ * Writes the sequence numbers of touched entries back to the cache database.
+ * To be called within a transaction.
+ */
+void PosixQuotaManager::SnapshotIndex() {
+  vector<pair<shash::Any, uint64_t> > dirty;
+  index_->TakeDirty(&dirty);
+  for (unsigned i = 0; i < dirty.size(); ++i) {
+    const string hash_str = dirty[i].first.ToString();
+    // The volatile flag is kept by the statement
+    sqlite3_bind_int64(stmt_touch_, 1, dirty[i].second & ~kVolatileFlag);
+    sqlite3_bind_text(stmt_touch_, 2, &hash_str[0], hash_str.length(),
+                      SQLITE_STATIC);
+    int retval = sqlite3_step(stmt_touch_);
+    if ((retval != SQLITE_DONE) && (retval != SQLITE_OK)) {
+      PANIC(kLogSyslogErr, "failed to update %s in cachedb, error %d",
+            hash_str.c_str(), retval);
+    }
+    sqlite3_reset(stmt_touch_);
+  }
+  last_snapshot_ = platform_monotonic_time();
+  LogCvmfs(kLogQuota, kLogDebug, "wrote %u entries of the memory index",
+           static_cast<unsigned>(dirty.size()));
+}
+
+
 void PosixQuotaManager::Spawn() {
   if (spawned_)
     return;
@@ -1879,7 +2370,7 @@ void PosixQuotaManager::Touch(const shash::Any &hash) {
   LruCommand cmd;
   cmd.command_type = kTouch;
   cmd.StoreHash(hash);
-  WritePipe(pipe_lru_[1], &cmd, sizeof(cmd));
+  PostCommand(&cmd, sizeof(cmd));
 }
 
 
@@ -26,6 +26,9 @@ namespace perf {
 class Recorder;
 }
 
+class QuotaIndex;
+class QuotaRing;
+
 /**
  * Works with the PosixCacheManager.  Uses an SQlite database for cache contents
  * tracking.  Tracking is asynchronously.
@@ -38,18 +41,27 @@ class PosixQuotaManager : public QuotaManager {
   FRIEND_TEST(T_QuotaManager, Contains);
   FRIEND_TEST(T_QuotaManager, InitDatabase);
   FRIEND_TEST(T_QuotaManager, MakeReturnPipe);
+  FRIEND_TEST(T_QuotaManager, MemoryIndex);
+  FRIEND_TEST(T_QuotaManager, RingFallback);
+  FRIEND_TEST(T_QuotaManager, TouchCoalescing);
 
  public:
   static PosixQuotaManager *Create(const std::string &cache_workspace,
     const uint64_t limit, const uint64_t cleanup_threshold,
-    const bool rebuild_database);
+    const bool rebuild_database, const bool memory_index = false);
   static PosixQuotaManager *CreateShared(
     const std::string &exe_path,
     const std::string &cache_workspace,
     const uint64_t limit,
     const uint64_t cleanup_threshold,
-    bool foreground);
+    bool foreground,
+    const bool memory_index = false);
   static int MainCacheManager(int argc, char **argv);
+  /**
+   * Progress or result of the last cache database rebuild in the given cache
+   * directory.  Empty if there was none.
+   */
+  static std::string GetRebuildStatus(const std::string &cache_dir);
 
   virtual ~PosixQuotaManager();
   virtual bool HasCapability(Capabilities capability) { return true; }
@@ -118,6 +130,8 @@ class PosixQuotaManager : public QuotaManager {
     // as of protocol revision 2
     kListVolatile,
     kCleanupRate,
+    // as of protocol revision 3
+    kRingNotify,
   };
 
   /**
@@ -182,7 +196,7 @@ class PosixQuotaManager : public QuotaManager {
    * Collect a number of insert and touch operations before processing them
    * as sqlite commands.
    */
-  static const unsigned kCommandBufferSize = 32;
+  static const unsigned kCommandBufferSize = 256;
 
   /**
    * Make sure that the amount of data transferred through the RPC pipe is
@@ -203,8 +217,35 @@ class PosixQuotaManager : public QuotaManager {
    */
   static const uint64_t kVolatileFlag = 1ULL << 63;
 
+  /**
+   * With the memory index, touches are written back to the cache database at
+   * most every so many seconds.
+   */
+  static const unsigned kSnapshotIntervalSec = 60;
+
+  /**
+   * Number of threads that scan the cache directories 00-ff when the cache
+   * database is rebuilt
+   */
+  static const unsigned kRebuildThreads = 8;
+
+  /**
+   * Maximum number of scanned cache directories that are kept in memory until
+   * they are inserted into the cache database
+   */
+  static const unsigned kRebuildMaxPending = 16;
+
+  /**
+   * Maximum time the command server waits for a producer that claimed a slot
+   * in the command ring to publish its record
+   */
+  static const unsigned kRingBarrierTimeoutMs = 10;
+
   bool InitDatabase(const bool rebuild_database);
+  bool LoadIndex();
+  void SnapshotIndex();
   bool RebuildDatabase();
+  bool ScanCacheDirectories(sqlite3_stmt *stmt_insert);
   void CloseDatabase();
   bool Contains(const std::string &hash_str);
   bool DoCleanup(const uint64_t leave_size);
@@ -221,8 +262,11 @@ class PosixQuotaManager : public QuotaManager {
   void ProcessCommandBunch(const unsigned num,
                            const LruCommand *commands,
                            const char *descriptions);
+  unsigned DrainRing(LruCommand *commands, char *descriptions,
+                     unsigned num_commands);
   static void *MainCommandServer(void *data);
 
+  void PostCommand(const LruCommand *cmd, const unsigned size);
   void DoInsert(const shash::Any &hash, const uint64_t size,
                 const std::string &description, const CommandType command_type);
   std::vector<std::string> DoList(const CommandType list_command);
@@ -295,6 +339,15 @@ class PosixQuotaManager : public QuotaManager {
    */
   int pipe_lru_[2];
 
+  /**
+   * As of protocol revision 3, touches, inserts, and pins are posted to a ring
+   * buffer in shared memory (anonymous memory for the exclusive cache
+   * manager).  Commands that need a reply and commands that do not fit into
+   * the ring use pipe_lru_.  The pipe is also used to wake up an idle cache
+   * manager.  NULL if the cache manager does not support the ring.
+   */
+  QuotaRing *ring_;
+
   /**
    * In exclusive mode, controls the quota manager thread.
    */
@@ -331,6 +384,16 @@ class PosixQuotaManager : public QuotaManager {
   sqlite3_stmt *stmt_list_catalogs_;
   sqlite3_stmt *stmt_list_volatile_;
 
+  /**
+   * If set, InitDatabase() loads the cache database into index_.  Touches only
+   * update the index and cleanup walks the index instead of querying the
+   * database for the least recently used entry.  Changed sequence numbers are
+   * written back by SnapshotIndex().
+   */
+  bool memory_index_;
+  QuotaIndex *index_;
+  uint64_t last_snapshot_;
+
   /**
    * Used in the destructor to steer closing of the database and so on.
    */
@@ -0,0 +1,259 @@
+/**
+ * This file is part of the CernVM File System.
+ */
+
+#define __STDC_FORMAT_MACROS
+
+#include "cvmfs_config.h"
+#include "quota_ring.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cassert>
+#include <cstring>
+
+#include "logging.h"
+#include "platform.h"
+
+using namespace std;  // NOLINT
+
+
+QuotaRing *QuotaRing::Attach(const string &path) {
+  const int fd = open(path.c_str(), O_RDWR);
+  if (fd < 0) {
+    LogCvmfs(kLogQuota, kLogDebug, "failed to open command ring %s (%d)",
+             path.c_str(), errno);
+    return NULL;
+  }
+  platform_stat64 info;
+  if ((platform_fstat(fd, &info) != 0) ||
+      (static_cast<uint64_t>(info.st_size) < sizeof(Header)))
+  {
+    close(fd);
+    return NULL;
+  }
+  QuotaRing *ring = Map(fd, info.st_size, false, 0);
+  close(fd);
+  if (ring == NULL)
+    return NULL;
+
+  const Header *header = ring->header_;
+  if ((header->magic != kMagic) || (header->version != kVersion) ||
+      (header->record_size != kRecordSize) ||
+      (GetMappingSize(header->num_slots) != ring->mapping_size_))
+  {
+    LogCvmfs(kLogQuota, kLogDebug, "invalid command ring %s", path.c_str());
+    delete ring;
+    return NULL;
+  }
+  return ring;
+}
+
+
+QuotaRing *QuotaRing::Create(const string &path, const unsigned num_slots) {
+  unlink(path.c_str());
+  const int fd = open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd < 0) {
+    LogCvmfs(kLogQuota, kLogDebug, "failed to create command ring %s (%d)",
+             path.c_str(), errno);
+    return NULL;
+  }
+  const uint64_t size = GetMappingSize(num_slots);
+  if (ftruncate(fd, size) != 0) {
+    LogCvmfs(kLogQuota, kLogDebug, "failed to resize command ring %s (%d)",
+             path.c_str(), errno);
+    close(fd);
+    unlink(path.c_str());
+    return NULL;
+  }
+  QuotaRing *ring = Map(fd, size, true, num_slots);
+  close(fd);
+  if (ring == NULL)
+    unlink(path.c_str());
+  return ring;
+}
+
+
+QuotaRing *QuotaRing::CreateAnonymous(const unsigned num_slots) {
+  return Map(-1, GetMappingSize(num_slots), true, num_slots);
+}
+
+
+uint64_t QuotaRing::GetMappingSize(const unsigned num_slots) {
+  return sizeof(Header) + static_cast<uint64_t>(num_slots) * sizeof(Slot);
+}
+
+
+void QuotaRing::Init(const unsigned num_slots) {
+  assert(num_slots > 0);
+  header_->num_slots = num_slots;
+  header_->record_size = kRecordSize;
+  atomic_init64(&header_->head);
+  atomic_init64(&header_->tail);
+  atomic_init32(&header_->consumer_idle);
+  for (unsigned i = 0; i < num_slots; ++i)
+    atomic_write64(&slots_[i].seq, i);
+  header_->version = kVersion;
+  // Published last, an attaching process sees either no ring or a ready one
+  MemoryFence();
+  header_->magic = kMagic;
+}
+
+
+bool QuotaRing::HasRecord() {
+  const int64_t tail = atomic_read64(&header_->tail);
+  Slot *slot = &slots_[tail % header_->num_slots];
+  return atomic_read64(&slot->seq) == tail + 1;
+}
+
+
+QuotaRing *QuotaRing::Map(
+  const int fd,
+  const uint64_t size,
+  const bool init,
+  const unsigned num_slots)
+{
+  const int flags = (fd < 0) ? (MAP_SHARED | MAP_ANONYMOUS) : MAP_SHARED;
+  void *mapping = mmap(NULL, size, PROT_READ | PROT_WRITE, flags, fd, 0);
+  if (mapping == MAP_FAILED) {
+    LogCvmfs(kLogQuota, kLogDebug, "failed to map command ring (%d)", errno);
+    return NULL;
+  }
+  QuotaRing *ring = new QuotaRing(mapping, size);
+  if (init)
+    ring->Init(num_slots);
+  return ring;
+}
+
+
+bool QuotaRing::MarkIdle() {
+  atomic_write32(&header_->consumer_idle, 1);
+  if (!HasRecord())
+    return true;
+  // If a producer cleared the flag in the meantime, it sends a spurious
+  // wake-up, which is harmless
+  atomic_cas32(&header_->consumer_idle, 1, 0);
+  return false;
+}
+
+
+bool QuotaRing::Pop(void *buffer, unsigned *size) {
+  while (true) {
+    const int64_t tail = atomic_read64(&header_->tail);
+    Slot *slot = &slots_[tail % header_->num_slots];
+    const int64_t seq = atomic_read64(&slot->seq);
+
+    if (seq == tail + 1) {
+      *size = slot->size;
+      assert(*size <= kRecordSize);
+      memcpy(buffer, slot->record, *size);
+      atomic_write64(&slot->seq, tail + header_->num_slots);
+      atomic_write64(&header_->tail, tail + 1);
+      stuck_since_ = 0;
+      return true;
+    }
+
+    // Free slot, nothing has been claimed beyond the tail
+    if (atomic_read64(&header_->head) <= tail) {
+      stuck_since_ = 0;
+      return false;
+    }
+
+    // Claimed but not (yet) published
+    const uint64_t now = platform_monotonic_time();
+    if (stuck_since_ == 0) {
+      stuck_since_ = now;
+      return false;
+    }
+    if (now - stuck_since_ < kStuckTimeoutSec)
+      return false;
+    // The slot is not freed for the next round, the producer may still be
+    // writing the record
+    if (atomic_cas64(&slot->seq, tail, kSeqAbandoned)) {
+      LogCvmfs(kLogQuota, kLogDebug | kLogSyslogWarn,
+               "skipped stuck slot %" PRId64 " of command ring", tail);
+      atomic_write64(&header_->tail, tail + 1);
+    }
+    stuck_since_ = 0;
+  }
+}
+
+
+/**
+ * Claims the slot at the head.  Fails if the ring is full or if the slot is
+ * abandoned.
+ */
+bool QuotaRing::Claim(int64_t *pos) {
+  *pos = atomic_read64(&header_->head);
+  while (true) {
+    Slot *slot = &slots_[*pos % header_->num_slots];
+    const int64_t seq = atomic_read64(&slot->seq);
+    if (seq == *pos) {
+      if (atomic_cas64(&header_->head, *pos, *pos + 1))
+        return true;
+    } else if (seq < *pos) {
+      // The consumer has not yet freed the slot of the previous round or the
+      // slot is abandoned
+      return false;
+    }
+    *pos = atomic_read64(&header_->head);
+  }
+}
+
+
+/**
+ * Copies the record into the claimed slot and publishes it.  If the consumer
+ * skipped the slot in the meantime, the slot is freed for the next round and
+ * the record is not published.
+ */
+bool QuotaRing::Publish(
+  const int64_t pos,
+  const void *record,
+  const unsigned size,
+  bool *wakeup)
+{
+  *wakeup = false;
+  Slot *slot = &slots_[pos % header_->num_slots];
+  slot->size = size;
+  memcpy(slot->record, record, size);
+  if (!atomic_cas64(&slot->seq, pos, pos + 1)) {
+    const bool retval =
+      atomic_cas64(&slot->seq, kSeqAbandoned, pos + header_->num_slots);
+    assert(retval);
+    return false;
+  }
+
+  *wakeup = atomic_cas32(&header_->consumer_idle, 1, 0);
+  return true;
+}
+
+
+bool QuotaRing::Push(const void *record, const unsigned size, bool *wakeup) {
+  assert(size <= kRecordSize);
+  *wakeup = false;
+
+  int64_t pos;
+  if (!Claim(&pos))
+    return false;
+  return Publish(pos, record, size, wakeup);
+}
+
+
+QuotaRing::QuotaRing(void *mapping, const uint64_t mapping_size)
+  : mapping_(mapping)
+  , mapping_size_(mapping_size)
+  , header_(reinterpret_cast<Header *>(mapping))
+  , slots_(reinterpret_cast<Slot *>(
+      reinterpret_cast<char *>(mapping) + sizeof(Header)))
+  , stuck_since_(0)
+{ }
+
+
+QuotaRing::~QuotaRing() {
+  munmap(mapping_, mapping_size_);
+}
@@ -0,0 +1,153 @@
+/**
+ * This file is part of the CernVM File System.
+ *
+ * A bounded ring buffer of fixed-size records in (shared) memory with many
+ * producers and a single consumer.  Used by the quota manager to receive
+ * fire-and-forget commands, such as touch and insert, without a system call
+ * per command.
+ */
+
+#ifndef CVMFS_QUOTA_RING_H_
+#define CVMFS_QUOTA_RING_H_
+
+#include <stdint.h>
+
+#include <string>
+
+#include "atomic.h"
+#include "gtest/gtest_prod.h"
+#include "util/single_copy.h"
+
+/**
+ * The ring consists of a header and num_slots slots of kRecordSize bytes.  It
+ * follows the bounded queue design by D. Vyukov: every slot carries a sequence
+ * number that tells whether the slot is free for the producer at a given
+ * position or whether it holds a published record for the consumer.
+ * Producers claim a position by compare-and-swap on the head counter, copy
+ * the record, and publish the slot.  There are no locks, so the ring can be
+ * shared among processes through a file mapping.
+ *
+ * A producer that dies between claiming and publishing a slot would block the
+ * consumer forever.  Therefore, the consumer skips a slot that stays
+ * unpublished for more than kStuckTimeoutSec and marks it as abandoned.  An
+ * abandoned slot is not handed to the next round of producers because its
+ * producer might only be descheduled and still write the record.  A late
+ * producer notices the abandoned slot, frees it for the next round, and
+ * reports failure, so that the record can be sent through another channel.
+ * If the producer died, the slot stays abandoned and producers fail once they
+ * reach it.
+ *
+ * The consumer can announce that it goes to sleep (MarkIdle()).  The producer
+ * that first publishes a record afterwards is told to wake the consumer up
+ * through some other means, e.g. a pipe.
+ */
+class QuotaRing : SingleCopy {
+  FRIEND_TEST(T_QuotaRing, StuckSlot);
+  FRIEND_TEST(T_QuotaRing, LateProducer);
+
+ public:
+  static const unsigned kRecordSize = 512;
+  static const unsigned kDefaultNumSlots = 2048;
+  static const unsigned kStuckTimeoutSec = 2;
+
+  /**
+   * Creates a new ring in a file that can be attached by other processes.  An
+   * existing file is replaced.
+   */
+  static QuotaRing *Create(const std::string &path, const unsigned num_slots);
+  /**
+   * Creates a ring in anonymous memory for producers and the consumer in the
+   * same process.
+   */
+  static QuotaRing *CreateAnonymous(const unsigned num_slots);
+  /**
+   * Maps a ring created by another process.  Returns NULL if the file does not
+   * exist or does not contain a ring of the expected layout.
+   */
+  static QuotaRing *Attach(const std::string &path);
+  ~QuotaRing();
+
+  /**
+   * Returns false if the ring is full or if the slot got reclaimed.  Sets
+   * wakeup to true if the consumer was idle and needs to be notified.
+   */
+  bool Push(const void *record, const unsigned size, bool *wakeup);
+  /**
+   * Copies the next record into buffer, which must be at least kRecordSize
+   * bytes large.  Returns false if there is no published record.  Only to be
+   * used by the single consumer.
+   */
+  bool Pop(void *buffer, unsigned *size);
+  /**
+   * Called by the consumer before it blocks on its wake-up channel.  Returns
+   * false, and does not go idle, if there are records to pop.
+   */
+  bool MarkIdle();
+
+  /**
+   * Records at positions before the head are claimed and published soon,
+   * unless their producer got stuck.
+   */
+  int64_t head() const { return atomic_read64(&header_->head); }
+  int64_t tail() const { return atomic_read64(&header_->tail); }
+  unsigned num_slots() const { return header_->num_slots; }
+
+ private:
+  static const uint32_t kMagic = 0x51524e47;  // QRNG
+  static const uint32_t kVersion = 2;
+  /**
+   * Sequence number of a slot skipped by the consumer whose producer did not
+   * yet publish the record
+   */
+  static const int64_t kSeqAbandoned = -1;
+
+  /**
+   * Producers and the consumer work on different cache lines
+   */
+  struct Header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t num_slots;
+    uint32_t record_size;
+    char pad0[48];
+    atomic_int64 head;
+    char pad1[56];
+    atomic_int64 tail;
+    atomic_int32 consumer_idle;
+    char pad2[52];
+  };
+
+  struct Slot {
+    /**
+     * Equals the position if the slot is free for the producer of that
+     * position, equals position + 1 if the record is published, equals
+     * kSeqAbandoned if the consumer skipped the slot.
+     */
+    atomic_int64 seq;
+    uint32_t size;
+    uint32_t pad;
+    unsigned char record[kRecordSize];
+  };
+
+  static uint64_t GetMappingSize(const unsigned num_slots);
+  static QuotaRing *Map(const int fd, const uint64_t size, const bool init,
+                        const unsigned num_slots);
+  QuotaRing(void *mapping, const uint64_t mapping_size);
+  void Init(const unsigned num_slots);
+  bool HasRecord();
+  bool Claim(int64_t *pos);
+  bool Publish(const int64_t pos, const void *record, const unsigned size,
+               bool *wakeup);
+
+  void *mapping_;
+  uint64_t mapping_size_;
+  Header *header_;
+  Slot *slots_;
+  /**
+   * Time when the consumer first found the slot at the tail claimed but not
+   * yet published; zero if the tail is not stuck.
+   */
+  uint64_t stuck_since_;
+};
+
+#endif  // CVMFS_QUOTA_RING_H_
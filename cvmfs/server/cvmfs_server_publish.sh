@@ -96,6 +96,10 @@ cvmfs_server_publish() {
     # sanity checks
     is_stratum0 $name   || die "This is not a stratum 0 repository"
     is_publishing $name && die "Another publish process is active for $name"
+    if [ "x$CVMFS_PAGED_CATALOGS" = "xtrue" ] && \
+       [ "x$CVMFS_GARBAGE_COLLECTION" = "xtrue" ]; then
+      die "CVMFS_PAGED_CATALOGS is not supported on garbage collectable repositories"
+    fi
     if [ x"$upstream_type" = xgw ]; then
         health_check -g -r $name
     else
@@ -231,6 +235,9 @@ cvmfs_server_publish() {
        -l $CVMFS_MIN_CHUNK_SIZE \
        -a $CVMFS_AVG_CHUNK_SIZE \
        -h $CVMFS_MAX_CHUNK_SIZE"
+      if [ "x$CVMFS_CHUNKING_ALGORITHM" != "x" ]; then
+        sync_command="$sync_command -j $CVMFS_CHUNKING_ALGORITHM"
+      fi
     fi
     if [ "x$CVMFS_AUTOCATALOGS" = "xtrue" ]; then
       sync_command="$sync_command -A"
@@ -253,6 +260,9 @@ cvmfs_server_publish() {
     if [ "x$CVMFS_NESTED_KCATALOG_LIMIT" != "x" ]; then
       sync_command="$sync_command -Q $CVMFS_NESTED_KCATALOG_LIMIT"
     fi
+    if [ "x$CVMFS_PAGED_CATALOGS" = "xtrue" ]; then
+      sync_command="$sync_command -G"
+    fi
     if [ "x$CVMFS_ROOT_KCATALOG_LIMIT" != "x" ]; then
       sync_command="$sync_command -R $CVMFS_ROOT_KCATALOG_LIMIT"
     fi
@@ -262,6 +272,15 @@ cvmfs_server_publish() {
     if [ "x$CVMFS_NUM_UPLOAD_TASKS" != "x" ]; then
       sync_command="$sync_command -0 $CVMFS_NUM_UPLOAD_TASKS"
     fi
+    if [ "x$CVMFS_NUM_TRAVERSAL_THREADS" != "x" ]; then
+      sync_command="$sync_command -2 $CVMFS_NUM_TRAVERSAL_THREADS"
+    fi
+    if [ "x$CVMFS_NUM_PIPELINE_TASKS" != "x" ]; then
+      sync_command="$sync_command -3 $CVMFS_NUM_PIPELINE_TASKS"
+    fi
+    if [ "x$CVMFS_PUBLISH_HASH_CACHE" = "xtrue" ]; then
+      sync_command="$sync_command -1 ${spool_dir}/hash_cache.db"
+    fi
     if [ "x$manual_revision" != "x" ]; then
       sync_command="$sync_command -v $manual_revision"
     fi
@@ -192,8 +192,17 @@ bool Database<DerivedT>::Configure() {
         SqliteMemoryManager::GetInstance()->AssignLookasideBuffer(sqlite_db());
     }
 
-    return Sql(sqlite_db() , "PRAGMA temp_store=2;").Execute() &&
-           Sql(sqlite_db() , "PRAGMA locking_mode=EXCLUSIVE;").Execute();
+    if (!Sql(sqlite_db() , "PRAGMA temp_store=2;").Execute() ||
+        !Sql(sqlite_db() , "PRAGMA locking_mode=EXCLUSIVE;").Execute())
+    {
+      return false;
+    }
+
+    // Files opened by file descriptor through the cvmfs read-only VFS are
+    // read in place from a memory map if the cache manager allows for it.
+    // SQlite caps the value at SQLITE_MAX_MMAP_SIZE.
+    if ((filename().length() > 1) && (filename()[0] == '@'))
+      return Sql(sqlite_db() , "PRAGMA mmap_size=2147418112;").Execute();
   }
   return true;
 }
@@ -205,7 +214,8 @@ bool Database<DerivedT>::FileReadAhead() {
   // TODO(jblomer): mmap, re-readahead
   assert(filename().length() > 1);
   int fd_readahead;
-  if (filename()[0] != '@') {
+  // '@<fd>' and '%<page reader>' denote files of the cvmfs read-only VFS
+  if ((filename()[0] != '@') && (filename()[0] != '%')) {
     fd_readahead = open(filename().c_str(), O_RDONLY);
     if (fd_readahead < 0) {
       LogCvmfs(kLogSql, kLogDebug, "failed to open %s for read-ahead (%d)",
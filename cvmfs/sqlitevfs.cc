@@ -5,6 +5,8 @@
  * operate on immutable, valid SQlite files.  Hence it can do a few
  * optimiziations.  Most notably it doesn't need to know about the path of
  * the SQlite file once opened.  It works purely on the file descriptor.
+ * Alternatively, the file is provided by a PageReader, which fetches parts of
+ * the file on demand.
  */
 
 #ifndef __STDC_FORMAT_MACROS
@@ -18,7 +20,9 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <inttypes.h>
+#include <pthread.h>
 #include <stdint.h>
+#include <sys/mman.h>
 #include <sys/select.h>
 #include <sys/time.h>
 #include <sys/types.h>
@@ -29,8 +33,10 @@
 #include <climits>
 #include <cstring>
 #include <ctime>
+#include <map>
 #include <vector>
 
+#include "atomic.h"
 #include "cache.h"
 #include "duplex_sqlite3.h"
 #include "logging.h"
@@ -38,6 +44,7 @@
 #include "smalloc.h"
 #include "statistics.h"
 #include "util/string.h"
+#include "util_concurrency.h"
 
 using namespace std;  // NOLINT
 
@@ -62,6 +69,8 @@ struct VfsRdOnly {
     , n_sleep(NULL)
     , sz_sleep(NULL)
     , n_time(NULL)
+    , n_fetch(NULL)
+    , no_mapped(NULL)
   { }
   CacheManager *cache_mgr;
   perf::Counter *n_access;
@@ -73,6 +82,8 @@ struct VfsRdOnly {
   perf::Counter *n_sleep;
   perf::Counter *sz_sleep;
   perf::Counter *n_time;
+  perf::Counter *n_fetch;
+  perf::Counter *no_mapped;
 };
 
 /**
@@ -82,7 +93,21 @@ struct VfsRdOnlyFile {
   sqlite3_file base;  // Base class. Must be first.
   VfsRdOnly *vfs_rdonly;
   int fd;
+  /**
+   * Non-NULL for files opened as '%<id>'; fd is -1 in this case.
+   */
+  PageReader *reader;
   uint64_t size;
+  /**
+   * Read-only memory map of the entire file, created on the first xFetch()
+   * call.  NULL if not (yet) mapped.
+   */
+  void *mapping;
+  /**
+   * Set if the cache manager cannot provide a file descriptor that can be
+   * mapped.  Pages are then read with xRead().
+   */
+  bool no_mapping;
 };
 
 /**
@@ -90,32 +115,122 @@ struct VfsRdOnlyFile {
  */
 std::vector<int> *fd_from_ = NULL;
 std::vector<int> *fd_to_ = NULL;
+/**
+ * Number of file descriptor mappings, can be read without holding lock_fds_
+ */
+atomic_int32 num_fd_mappings_;
+/**
+ * Number of open sqlite files per cache manager file descriptor.  Additional
+ * connections to a catalog (see Catalog::OpenSqlReader()) open the same
+ * "@<fd>" path again.  The descriptor is closed with the last of them.
+ */
+std::map<int, unsigned> *fd_refcounts_ = NULL;
+/**
+ * Protects the file descriptor mappings and the reference counters
+ */
+pthread_mutex_t *lock_fds_ = NULL;
+
+struct PageReaderInfo {
+  PageReaderInfo() : reader(NULL), refcount(0) { }
+  PageReader *reader;
+  unsigned refcount;
+};
+/**
+ * Registered page readers by id, also protected by lock_fds_
+ */
+std::map<uint64_t, PageReaderInfo> *page_readers_ = NULL;
+uint64_t next_page_reader_id_ = 0;
 
 }  // anonymous namespace
 
-static void ApplyFdMap(VfsRdOnlyFile *pFile) {
+/**
+ * The mappings are kept until the last file using the target descriptor is
+ * closed, so that they also apply to files that are opened later by path.
+ */
+static int MapFd(int fd) {
   unsigned N = fd_from_->size();
   for (unsigned i = 0; i < N; ++i) {
-    if (pFile->fd == (*fd_from_)[i]) {
-      LogCvmfs(kLogSql, kLogDebug, "map fd %d --> %d",
-               (*fd_from_)[i], (*fd_to_)[i]);
-      pFile->fd = (*fd_to_)[i];
+    if (fd == (*fd_from_)[i])
+      return (*fd_to_)[i];
+  }
+  return fd;
+}
+
+static void ApplyFdMap(VfsRdOnlyFile *pFile) {
+  if (atomic_read32(&num_fd_mappings_) == 0)
+    return;
+  MutexLockGuard guard(lock_fds_);
+  int fd = MapFd(pFile->fd);
+  if (fd != pFile->fd) {
+    LogCvmfs(kLogSql, kLogDebug, "map fd %d --> %d", pFile->fd, fd);
+    pFile->fd = fd;
+  }
+}
+
+
+/**
+ * Returns true if the file descriptor is not used by other files anymore and
+ * can be closed.
+ */
+static bool ReleaseFd(int fd) {
+  MutexLockGuard guard(lock_fds_);
+  std::map<int, unsigned>::iterator iter = fd_refcounts_->find(fd);
+  assert(iter != fd_refcounts_->end());
+  if (--iter->second > 0)
+    return false;
+  fd_refcounts_->erase(iter);
+  unsigned N = fd_to_->size();
+  for (unsigned i = 0; i < N; ++i) {
+    if (fd == (*fd_to_)[i]) {
       fd_from_->erase(fd_from_->begin() + i);
       fd_to_->erase(fd_to_->begin() + i);
-      return;
+      atomic_dec32(&num_fd_mappings_);
+      break;
     }
   }
+  return true;
+}
+
+
+/**
+ * Returns true if the page reader is not used by other files anymore and
+ * can be deleted.
+ */
+static bool ReleasePageReader(PageReader *reader) {
+  MutexLockGuard guard(lock_fds_);
+  std::map<uint64_t, PageReaderInfo>::iterator iter = page_readers_->begin();
+  for (; iter != page_readers_->end(); ++iter) {
+    if (iter->second.reader == reader)
+      break;
+  }
+  assert(iter != page_readers_->end());
+  if (--iter->second.refcount > 0)
+    return false;
+  page_readers_->erase(iter);
+  return true;
 }
 
 
 static int VfsRdOnlyClose(sqlite3_file *pFile) {
   VfsRdOnlyFile *p = reinterpret_cast<VfsRdOnlyFile *>(pFile);
-  ApplyFdMap(p);
-  int retval = p->vfs_rdonly->cache_mgr->Close(p->fd);
-  if (retval == 0) {
+  if (p->reader != NULL) {
     perf::Dec(p->vfs_rdonly->no_open);
+    if (ReleasePageReader(p->reader))
+      delete p->reader;
     return SQLITE_OK;
   }
+  ApplyFdMap(p);
+  if (p->mapping != NULL) {
+    munmap(p->mapping, p->size);
+    p->mapping = NULL;
+    perf::Dec(p->vfs_rdonly->no_mapped);
+  }
+  perf::Dec(p->vfs_rdonly->no_open);
+  if (!ReleaseFd(p->fd))
+    return SQLITE_OK;
+  int retval = p->vfs_rdonly->cache_mgr->Close(p->fd);
+  if (retval == 0)
+    return SQLITE_OK;
   return SQLITE_IOERR_CLOSE;
 }
 
@@ -131,8 +246,13 @@ static int VfsRdOnlyRead(
   sqlite_int64 iOfst
 ) {
   VfsRdOnlyFile *p = reinterpret_cast<VfsRdOnlyFile *>(pFile);
-  ApplyFdMap(p);
-  ssize_t got = p->vfs_rdonly->cache_mgr->Pread(p->fd, zBuf, iAmt, iOfst);
+  ssize_t got;
+  if (p->reader != NULL) {
+    got = p->reader->Pread(zBuf, iAmt, iOfst);
+  } else {
+    ApplyFdMap(p);
+    got = p->vfs_rdonly->cache_mgr->Pread(p->fd, zBuf, iAmt, iOfst);
+  }
   perf::Inc(p->vfs_rdonly->n_read);
   if (got == iAmt) {
     perf::Xadd(p->vfs_rdonly->sz_read, iAmt);
@@ -235,9 +355,65 @@ static int VfsRdOnlyDeviceCharacteristics(
 }
 
 
+/**
+ * Used by SQlite instead of xRead() if mmap_size is set for the database
+ * connection.  On the first call, the file is mapped as a whole, provided that
+ * the cache manager keeps the object in a plain file.  Pages are then read in
+ * place, without a copy into the page cache.  If the file cannot be mapped,
+ * *pp is set to NULL and SQlite falls back to xRead().
+ */
+static int VfsRdOnlyFetch(
+  sqlite3_file *pFile,
+  sqlite3_int64 iOfst,
+  int iAmt,
+  void **pp)
+{
+  VfsRdOnlyFile *p = reinterpret_cast<VfsRdOnlyFile *>(pFile);
+  *pp = NULL;
+  if ((iOfst < 0) || (static_cast<uint64_t>(iOfst) + iAmt > p->size))
+    return SQLITE_OK;
+
+  if ((p->mapping == NULL) && !p->no_mapping) {
+    ApplyFdMap(p);
+    int native_fd = p->vfs_rdonly->cache_mgr->GetSpliceFd(p->fd);
+    if (native_fd >= 0) {
+      void *mapping = mmap(NULL, p->size, PROT_READ, MAP_SHARED, native_fd, 0);
+      if (mapping != MAP_FAILED) {
+        p->mapping = mapping;
+        perf::Inc(p->vfs_rdonly->no_mapped);
+      } else {
+        LogCvmfs(kLogSql, kLogDebug, "failed to map sqlite file on fd %d (%d)",
+                 p->fd, errno);
+      }
+    }
+    p->no_mapping = (p->mapping == NULL);
+  }
+  if (p->mapping == NULL)
+    return SQLITE_OK;
+
+  *pp = reinterpret_cast<char *>(p->mapping) + iOfst;
+  perf::Inc(p->vfs_rdonly->n_fetch);
+  return SQLITE_OK;
+}
+
+
+/**
+ * The mapping covers the entire immutable file and it is only removed on
+ * close.
+ */
+static int VfsRdOnlyUnfetch(
+  sqlite3_file *pFile __attribute__((unused)),
+  sqlite3_int64 iOfst __attribute__((unused)),
+  void *p __attribute__((unused)))
+{
+  return SQLITE_OK;
+}
+
+
 /**
  * Supports only read-only opens.  The "file name" has to be in the form of
- * '@<file descriptor>', where file descriptor is usable by the cache manager.
+ * '@<file descriptor>', where file descriptor is usable by the cache manager,
+ * or '%<id>' for a registered page reader.
  */
 static int VfsRdOnlyOpen(
   sqlite3_vfs *vfs,
@@ -247,7 +423,7 @@ static int VfsRdOnlyOpen(
   int *pOutFlags)
 {
   static const sqlite3_io_methods io_methods = {
-    1,  // iVersion
+    3,  // iVersion
     VfsRdOnlyClose,
     VfsRdOnlyRead,
     VfsRdOnlyWrite,
@@ -259,7 +435,13 @@ static int VfsRdOnlyOpen(
     VfsRdOnlyCheckReservedLock,
     VfsRdOnlyFileControl,
     VfsRdOnlySectorSize,
-    VfsRdOnlyDeviceCharacteristics
+    VfsRdOnlyDeviceCharacteristics,
+    NULL,  // xShmMap
+    NULL,  // xShmLock
+    NULL,  // xShmBarrier
+    NULL,  // xShmUnmap
+    VfsRdOnlyFetch,
+    VfsRdOnlyUnfetch
   };
 
   VfsRdOnlyFile *p = reinterpret_cast<VfsRdOnlyFile *>(pFile);
@@ -275,22 +457,58 @@ static int VfsRdOnlyOpen(
   if (flags & SQLITE_OPEN_EXCLUSIVE)
     return SQLITE_IOERR;
 
+  p->reader = NULL;
+  if (zName && (zName[0] == '%')) {
+    const uint64_t id = String2Uint64(string(&zName[1]));
+    {
+      MutexLockGuard guard(lock_fds_);
+      std::map<uint64_t, PageReaderInfo>::iterator iter =
+        page_readers_->find(id);
+      if (iter == page_readers_->end())
+        return SQLITE_CANTOPEN;
+      iter->second.refcount++;
+      p->reader = iter->second.reader;
+    }
+    p->fd = -1;
+    p->size = p->reader->GetSize();
+    p->mapping = NULL;
+    p->no_mapping = true;
+    if (pOutFlags)
+      *pOutFlags = flags;
+    p->vfs_rdonly = reinterpret_cast<VfsRdOnly *>(vfs->pAppData);
+    p->base.pMethods = &io_methods;
+    perf::Inc(p->vfs_rdonly->no_open);
+    LogCvmfs(kLogSql, kLogDebug, "open sqlite3 catalog from page reader %s, "
+             "size %" PRIu64, zName, p->size);
+    return SQLITE_OK;
+  }
+
   assert(zName && (zName[0] == '@'));
   p->fd = String2Int64(string(&zName[1]));
   if (p->fd < 0)
     return SQLITE_IOERR;
+  bool is_first_open;
+  {
+    MutexLockGuard guard(lock_fds_);
+    p->fd = MapFd(p->fd);
+    is_first_open = (++(*fd_refcounts_)[p->fd] == 1);
+  }
   int64_t size = cache_mgr->GetSize(p->fd);
   if (size < 0) {
-    cache_mgr->Close(p->fd);
+    if (ReleaseFd(p->fd))
+      cache_mgr->Close(p->fd);
     p->fd = -1;
     return SQLITE_IOERR_FSTAT;
   }
-  if (cache_mgr->Readahead(p->fd) != 0) {
-    cache_mgr->Close(p->fd);
+  if (is_first_open && (cache_mgr->Readahead(p->fd) != 0)) {
+    if (ReleaseFd(p->fd))
+      cache_mgr->Close(p->fd);
     p->fd = -1;
     return SQLITE_IOERR;
   }
   p->size = static_cast<uint64_t>(size);
+  p->mapping = NULL;
+  p->no_mapping = (size == 0);
   if (pOutFlags)
     *pOutFlags = flags;
   p->vfs_rdonly = reinterpret_cast<VfsRdOnly *>(vfs->pAppData);
@@ -457,6 +675,13 @@ bool RegisterVfsRdOnly(
 {
   fd_from_ = new std::vector<int>();
   fd_to_ = new std::vector<int>();
+  fd_refcounts_ = new std::map<int, unsigned>();
+  atomic_init32(&num_fd_mappings_);
+  page_readers_ = new std::map<uint64_t, PageReaderInfo>();
+  lock_fds_ =
+    reinterpret_cast<pthread_mutex_t *>(smalloc(sizeof(pthread_mutex_t)));
+  int retval = pthread_mutex_init(lock_fds_, NULL);
+  assert(retval == 0);
 
   sqlite3_vfs *vfs = reinterpret_cast<sqlite3_vfs *>(
     smalloc(sizeof(sqlite3_vfs)));
@@ -483,7 +708,7 @@ bool RegisterVfsRdOnly(
   vfs->xCurrentTimeInt64 = VfsRdOnlyCurrentTimeInt64;
   assert(vfs->zName);
 
-  int retval = sqlite3_vfs_register(vfs, options == kVfsOptDefault);
+  retval = sqlite3_vfs_register(vfs, options == kVfsOptDefault);
   if (retval != SQLITE_OK) {
     free(const_cast<char *>(vfs->zName));
     delete vfs_rdonly;
@@ -510,6 +735,11 @@ bool RegisterVfsRdOnly(
     statistics->Register("sqlite.sz_sleep", "overall microseconds slept");
   vfs_rdonly->n_time =
     statistics->Register("sqlite.n_time", "overall number of time() calls");
+  vfs_rdonly->n_fetch =
+    statistics->Register("sqlite.n_fetch", "overall number of mapped pages");
+  vfs_rdonly->no_mapped =
+    statistics->Register("sqlite.no_mapped",
+                         "currently memory mapped sqlite files");
 
   return true;
 }
@@ -532,15 +762,39 @@ bool UnregisterVfsRdOnly() {
 
   delete fd_from_;
   delete fd_to_;
+  delete fd_refcounts_;
   fd_from_ = NULL;
   fd_to_ = NULL;
+  fd_refcounts_ = NULL;
+  std::map<uint64_t, PageReaderInfo>::const_iterator i = page_readers_->begin();
+  for (; i != page_readers_->end(); ++i)
+    delete i->second.reader;
+  delete page_readers_;
+  page_readers_ = NULL;
+  pthread_mutex_destroy(lock_fds_);
+  free(lock_fds_);
+  lock_fds_ = NULL;
 
   return true;
 }
 
 void RegisterFdMapping(int from, int to) {
+  MutexLockGuard guard(lock_fds_);
   fd_from_->push_back(from);
   fd_to_->push_back(to);
+  atomic_inc32(&num_fd_mappings_);
+  std::map<int, unsigned>::iterator iter = fd_refcounts_->find(from);
+  if (iter != fd_refcounts_->end()) {
+    (*fd_refcounts_)[to] += iter->second;
+    fd_refcounts_->erase(iter);
+  }
+}
+
+string RegisterPageReader(PageReader *reader) {
+  MutexLockGuard guard(lock_fds_);
+  const uint64_t id = next_page_reader_id_++;
+  (*page_readers_)[id].reader = reader;
+  return "%" + StringifyUint(id);
 }
 
 }  // namespace sqlite
@@ -5,6 +5,8 @@
 #ifndef CVMFS_SQLITEVFS_H_
 #define CVMFS_SQLITEVFS_H_
 
+#include <stdint.h>
+
 #include <string>
 
 class CacheManager;
@@ -30,6 +32,29 @@ bool UnregisterVfsRdOnly();
  */
 void RegisterFdMapping(int from, int to);
 
+/**
+ * Provides the content of a read-only database file that is not available as a
+ * whole in the cache, such as a paged catalog.  Pread() can be called
+ * concurrently.
+ */
+class PageReader {
+ public:
+  virtual ~PageReader() { }
+  virtual uint64_t GetSize() = 0;
+  /**
+   * Returns the number of bytes read or -errno.
+   */
+  virtual int64_t Pread(void *buf, uint64_t size, uint64_t offset) = 0;
+};
+
+/**
+ * Returns the file name under which the reader can be opened by the read-only
+ * VFS, in the form of '%<id>'.  The VFS takes ownership of the reader.  It is
+ * deleted when the last file opened from it is closed or, if it was never
+ * opened, when the VFS is unregistered.
+ */
+std::string RegisterPageReader(PageReader *reader);
+
 }  // namespace sqlite
 
 #endif  // CVMFS_SQLITEVFS_H_
@@ -166,7 +166,8 @@ std::string CommandScrub::CheckPathAndExtractHash(
       last_character != shash::kSuffixPartial &&
       last_character != shash::kSuffixCertificate &&
       last_character != shash::kSuffixMicroCatalog &&
-      last_character != shash::kSuffixMetainfo) {
+      last_character != shash::kSuffixMetainfo &&
+      last_character != shash::kSuffixPagedCatalog) {
     PrintAlert(Alerts::kUnexpectedModifier, full_path);
     return "";
   }
@@ -643,6 +643,14 @@ int swissknife::CommandSync::Main(const swissknife::ArgumentList &args) {
       return 2;
     }
   }
+  if (args.find('j') != args.end()) {
+    if (!ParseChunkingAlgorithm(*args.find('j')->second,
+                                &params.chunking_algorithm))
+    {
+      PrintError("unknown chunking algorithm");
+      return 1;
+    }
+  }
   if (args.find('O') != args.end()) {
     params.generate_legacy_bulk_chunks = true;
   }
@@ -664,6 +672,7 @@ int swissknife::CommandSync::Main(const swissknife::ArgumentList &args) {
   }
 
   if (args.find('E') != args.end()) params.enforce_limits = true;
+  if (args.find('G') != args.end()) params.paged_catalogs = true;
   if (args.find('Q') != args.end()) {
     params.nested_kcatalog_limit = String2Uint64(*args.find('Q')->second);
   } else {
@@ -699,6 +708,25 @@ int swissknife::CommandSync::Main(const swissknife::ArgumentList &args) {
     params.num_upload_tasks = String2Uint64(*args.find('0')->second);
   }
 
+  if (args.find('1') != args.end()) {
+    params.hash_cache_path = MakeCanonicalPath(*args.find('1')->second);
+  }
+
+  if (args.find('2') != args.end()) {
+    params.num_traversal_threads = String2Uint64(*args.find('2')->second);
+  }
+
+  if (args.find('3') != args.end()) {
+    const vector<string> tasks = SplitString(*args.find('3')->second, ':');
+    if (tasks.size() != 6) {
+      PrintError("invalid number of ingestion threads, expected "
+                 "read:chunk:compress:hash:write:register");
+      return 1;
+    }
+    for (unsigned i = 0; i < tasks.size(); ++i)
+      params.num_pipeline_tasks.push_back(String2Uint64(tasks[i]));
+  }
+
   if (args.find('T') != args.end()) {
     params.ttl_seconds = String2Uint64(*args.find('T')->second);
   }
@@ -742,6 +770,15 @@ int swissknife::CommandSync::Main(const swissknife::ArgumentList &args) {
         params.max_concurrent_write_jobs;
   }
   spooler_definition.num_upload_tasks = params.num_upload_tasks;
+  spooler_definition.chunking_algorithm = params.chunking_algorithm;
+  if (!params.num_pipeline_tasks.empty()) {
+    spooler_definition.num_read_tasks = params.num_pipeline_tasks[0];
+    spooler_definition.num_chunk_tasks = params.num_pipeline_tasks[1];
+    spooler_definition.num_compress_tasks = params.num_pipeline_tasks[2];
+    spooler_definition.num_hash_tasks = params.num_pipeline_tasks[3];
+    spooler_definition.num_write_tasks = params.num_pipeline_tasks[4];
+    spooler_definition.num_register_tasks = params.num_pipeline_tasks[5];
+  }
 
   upload::SpoolerDefinition spooler_definition_catalogs(
       spooler_definition.Dup2DefaultCompression());
@@ -788,6 +825,13 @@ int swissknife::CommandSync::Main(const swissknife::ArgumentList &args) {
   if (!manifest.IsValid()) {
     return 3;
   }
+  // Paged catalog objects are not referenced by the catalogs, so that garbage
+  // collection would leak them
+  if (params.paged_catalogs && manifest->garbage_collectable()) {
+    PrintError("paged catalogs are not supported on garbage collectable "
+               "repositories");
+    return 1;
+  }
 
   StatisticsDatabase *stats_db =
     StatisticsDatabase::OpenStandardDB(params.repo_name);
@@ -800,6 +844,7 @@ int swissknife::CommandSync::Main(const swissknife::ArgumentList &args) {
       download_manager(), params.enforce_limits, params.nested_kcatalog_limit,
       params.root_kcatalog_limit, params.file_mbyte_limit, statistics(),
       params.is_balanced, params.max_weight, params.min_weight);
+  catalog_manager.set_paged_catalogs(params.paged_catalogs);
   catalog_manager.Init();
 
   publish::SyncMediator mediator(&catalog_manager, &params, publish_statistics);
@@ -830,6 +875,7 @@ int swissknife::CommandSync::Main(const swissknife::ArgumentList &args) {
       return 3;
     }
 
+    sync->SetNumTraversalThreads(params.num_traversal_threads);
     if (!sync->Initialize()) {
       LogCvmfs(kLogCvmfs, kLogStderr,
                "Initialization of the synchronisation "
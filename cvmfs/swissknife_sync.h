@@ -49,11 +49,15 @@ struct SyncParameters {
         min_file_chunk_size(kDefaultMinFileChunkSize),
         avg_file_chunk_size(kDefaultAvgFileChunkSize),
         max_file_chunk_size(kDefaultMaxFileChunkSize),
+        chunking_algorithm(kChunkingXor32),
         manual_revision(0),
         ttl_seconds(0),
         max_concurrent_write_jobs(0),
         num_upload_tasks(1),
+        num_traversal_threads(0),
+        num_pipeline_tasks(),
         is_balanced(false),
+        paged_catalogs(false),
         max_weight(kDefaultMaxWeight),
         min_weight(kDefaultMinWeight),
         session_token_file(),
@@ -77,6 +81,7 @@ struct SyncParameters {
   std::string tar_file;
   std::string base_directory;
   std::string to_delete;
+  std::string hash_cache_path;
   bool print_changeset;
   bool dry_run;
   bool mucatalogs;
@@ -99,11 +104,15 @@ struct SyncParameters {
   size_t min_file_chunk_size;
   size_t avg_file_chunk_size;
   size_t max_file_chunk_size;
+  ChunkingAlgorithms chunking_algorithm;
   uint64_t manual_revision;
   uint64_t ttl_seconds;
   uint64_t max_concurrent_write_jobs;
   unsigned num_upload_tasks;
+  unsigned num_traversal_threads;
+  std::vector<unsigned> num_pipeline_tasks;  // empty: automatic
   bool is_balanced;
+  bool paged_catalogs;
   unsigned max_weight;
   unsigned min_weight;
 
@@ -264,9 +273,17 @@ class CommandSync : public Command {
     r.push_back(Parameter::Optional('e', "hash algorithm (default: SHA-1)"));
     r.push_back(Parameter::Optional('f', "union filesystem type"));
     r.push_back(Parameter::Optional('h', "maximal file chunk size in bytes"));
+    r.push_back(Parameter::Optional('j', "chunking algorithm "
+                                         "[xor32, fastcdc] (default: xor32)"));
     r.push_back(Parameter::Optional('l', "minimal file chunk size in bytes"));
     r.push_back(Parameter::Optional('q', "number of concurrent write jobs"));
     r.push_back(Parameter::Optional('0', "number of upload tasks"));
+    r.push_back(Parameter::Optional('1', "path to the publish hash cache"));
+    r.push_back(Parameter::Optional('2', "number of scratch area traversal "
+                                         "threads (default: sequential)"));
+    r.push_back(Parameter::Optional('3', "number of ingestion threads per "
+                                         "stage (read:chunk:compress:hash:"
+                                         "write:register, 0: automatic)"));
     r.push_back(Parameter::Optional('v', "manual revision number"));
     r.push_back(Parameter::Optional('z', "log level (0-4, default: 2)"));
     r.push_back(Parameter::Optional('C', "trusted certificates"));
@@ -303,6 +320,7 @@ class CommandSync : public Command {
     r.push_back(Parameter::Switch('y', "dry run"));
     r.push_back(Parameter::Switch('A', "autocatalog enabled/disabled"));
     r.push_back(Parameter::Switch('E', "enforce limits instead of warning"));
+    r.push_back(Parameter::Switch('G', "create paged catalogs"));
     r.push_back(Parameter::Switch('L', "enable HTTP redirects"));
     r.push_back(Parameter::Switch('V',
                                   "Publish format compatible with "
@@ -0,0 +1,244 @@
+/**
+ * This file is part of the CernVM File System.
+ */
+
+#include "sync_hash_cache.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cassert>
+#include <ctime>
+#include <vector>
+
+#include "logging.h"
+#include "sql.h"
+#include "util/string.h"
+#include "util_concurrency.h"
+
+using namespace std;  // NOLINT
+
+namespace {
+
+bool ParseHash(const string &str, shash::Any *hash) {
+  *hash = shash::MkFromSuffixedHexPtr(shash::HexPtr(str));
+  return hash->algorithm != shash::kAny;
+}
+
+}  // anonymous namespace
+
+namespace publish {
+
+HashCache::HashCache()
+  : db_(NULL)
+  , in_transaction_(false)
+  , now_(time(NULL))
+  , num_hits_(0)
+  , num_inserts_(0)
+{
+  int retval = pthread_mutex_init(&lock_, NULL);
+  assert(retval == 0);
+}
+
+
+HashCache::~HashCache() {
+  if (in_transaction_)
+    Exec("ROLLBACK;");
+  // Statements need to be finalized before the database is closed
+  stmt_lookup_.Destroy();
+  stmt_touch_.Destroy();
+  stmt_insert_.Destroy();
+  if (db_ != NULL)
+    sqlite3_close_v2(db_);
+  pthread_mutex_destroy(&lock_);
+}
+
+
+bool HashCache::Exec(const string &sql) {
+  int retval = sqlite3_exec(db_, sql.c_str(), NULL, NULL, NULL);
+  if (retval != SQLITE_OK) {
+    LogCvmfs(kLogPublish, kLogDebug, "hash cache: failed to execute %s (%s)",
+             sql.c_str(), sqlite3_errmsg(db_));
+    return false;
+  }
+  return true;
+}
+
+
+HashCache *HashCache::Open(const string &db_path, const string &settings) {
+  UniquePtr<HashCache> cache(new HashCache());
+  int retval = sqlite3_open_v2(db_path.c_str(), &cache->db_,
+                               SQLITE_OPEN_NOMUTEX | SQLITE_OPEN_READWRITE |
+                               SQLITE_OPEN_CREATE, NULL);
+  if (retval != SQLITE_OK) {
+    LogCvmfs(kLogPublish, kLogDebug, "failed to open hash cache %s",
+             db_path.c_str());
+    return NULL;
+  }
+
+  // The cache can be rebuilt at any time, durability is not required
+  if (!cache->Exec("PRAGMA synchronous=OFF;") ||
+      !cache->Exec("CREATE TABLE IF NOT EXISTS properties "
+                   "(key TEXT PRIMARY KEY, value TEXT);") ||
+      !cache->Exec("CREATE TABLE IF NOT EXISTS hashes "
+                   "(fingerprint TEXT PRIMARY KEY, content_hash TEXT, "
+                   "compression INTEGER, chunks TEXT, atime INTEGER);") ||
+      !cache->Exec("BEGIN;"))
+  {
+    LogCvmfs(kLogPublish, kLogDebug, "failed to initialize hash cache %s",
+             db_path.c_str());
+    return NULL;
+  }
+  cache->in_transaction_ = true;
+
+  string stored_settings;
+  {
+    sqlite::Sql stmt(cache->db_,
+                     "SELECT value FROM properties WHERE key='settings';");
+    if (stmt.FetchRow())
+      stored_settings = stmt.RetrieveString(0);
+  }
+  if (stored_settings != settings) {
+    LogCvmfs(kLogPublish, kLogDebug,
+             "hash cache: settings changed, clearing %s", db_path.c_str());
+    sqlite::Sql stmt(cache->db_,
+      "INSERT OR REPLACE INTO properties (key, value) "
+      "VALUES ('settings', :s);");
+    if (!cache->Exec("DELETE FROM hashes;") ||
+        !stmt.BindText(1, settings) || !stmt.Execute())
+    {
+      return NULL;
+    }
+  }
+  if (cache->now_ > kMaxAgeSec) {
+    if (!cache->Exec("DELETE FROM hashes WHERE atime < " +
+                     StringifyUint(cache->now_ - kMaxAgeSec) + ";"))
+    {
+      return NULL;
+    }
+  }
+
+  cache->stmt_lookup_ = new sqlite::Sql(cache->db_,
+    "SELECT content_hash, compression, chunks FROM hashes "
+    "WHERE fingerprint = :f;");
+  cache->stmt_touch_ = new sqlite::Sql(cache->db_,
+    "UPDATE hashes SET atime = :t WHERE fingerprint = :f;");
+  cache->stmt_insert_ = new sqlite::Sql(cache->db_,
+    "INSERT OR REPLACE INTO hashes "
+    "(fingerprint, content_hash, compression, chunks, atime) "
+    "VALUES (:f, :h, :c, :l, :t);");
+  return cache.Release();
+}
+
+
+bool HashCache::Fingerprint(
+  const string &path,
+  const shash::Algorithms algorithm,
+  string *fingerprint)
+{
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat info;
+  shash::Any hash(algorithm);
+  const bool retval = (fstat(fd, &info) == 0) && shash::HashFd(fd, &hash);
+  close(fd);
+  if (!retval)
+    return false;
+  *fingerprint = StringifyUint(info.st_size) + "-" + hash.ToString();
+  return true;
+}
+
+
+/**
+ * The chunk list is stored as "<offset> <size> <hash>" triples, separated by
+ * commas.
+ */
+bool HashCache::Lookup(const string &fingerprint,
+                       upload::SpoolerResult *result)
+{
+  MutexLockGuard guard(&lock_);
+  if (!stmt_lookup_->BindText(1, fingerprint) || !stmt_lookup_->FetchRow()) {
+    stmt_lookup_->Reset();
+    return false;
+  }
+  const string content_hash = stmt_lookup_->RetrieveString(0);
+  const int compression = stmt_lookup_->RetrieveInt(1);
+  const string chunks = stmt_lookup_->RetrieveString(2);
+  stmt_lookup_->Reset();
+
+  shash::Any hash;
+  if (!ParseHash(content_hash, &hash))
+    return false;
+  FileChunkList file_chunks;
+  if (!chunks.empty()) {
+    vector<string> triples = SplitString(chunks, ',');
+    for (unsigned i = 0; i < triples.size(); ++i) {
+      vector<string> fields = SplitString(triples[i], ' ');
+      uint64_t offset;
+      uint64_t size;
+      shash::Any chunk_hash;
+      if ((fields.size() != 3) ||
+          !String2Uint64Parse(fields[0], &offset) ||
+          !String2Uint64Parse(fields[1], &size) ||
+          !ParseHash(fields[2], &chunk_hash))
+      {
+        return false;
+      }
+      file_chunks.PushBack(FileChunk(chunk_hash, offset, size));
+    }
+  }
+
+  result->content_hash = hash;
+  result->compression_alg = static_cast<zlib::Algorithms>(compression);
+  result->file_chunks = file_chunks;
+
+  if (stmt_touch_->BindInt64(1, now_) &&
+      stmt_touch_->BindText(2, fingerprint))
+  {
+    stmt_touch_->Execute();
+  }
+  stmt_touch_->Reset();
+  num_hits_++;
+  return true;
+}
+
+
+void HashCache::Insert(const string &fingerprint,
+                       const upload::SpoolerResult &result)
+{
+  string chunks;
+  for (unsigned i = 0; i < result.file_chunks.size(); ++i) {
+    const FileChunk chunk = result.file_chunks.At(i);
+    if (i > 0)
+      chunks.push_back(',');
+    chunks += StringifyUint(chunk.offset()) + " " +
+              StringifyUint(chunk.size()) + " " +
+              chunk.content_hash().ToStringWithSuffix();
+  }
+  const string content_hash = result.content_hash.ToStringWithSuffix();
+
+  MutexLockGuard guard(&lock_);
+  const bool retval =
+    stmt_insert_->BindText(1, fingerprint) &&
+    stmt_insert_->BindText(2, content_hash) &&
+    stmt_insert_->BindInt(3, result.compression_alg) &&
+    stmt_insert_->BindText(4, chunks) &&
+    stmt_insert_->BindInt64(5, now_) &&
+    stmt_insert_->Execute();
+  stmt_insert_->Reset();
+  if (retval)
+    num_inserts_++;
+}
+
+
+bool HashCache::Commit() {
+  MutexLockGuard guard(&lock_);
+  if (!in_transaction_)
+    return true;
+  in_transaction_ = false;
+  return Exec("COMMIT;");
+}
+
+}  // namespace publish
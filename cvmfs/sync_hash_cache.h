@@ -0,0 +1,103 @@
+/**
+ * This file is part of the CernVM File System.
+ *
+ * The hash cache remembers the outcome of processing file content in previous
+ * publish runs.  Build systems often rewrite complete install trees with
+ * identical content.  For such files, the publisher can reuse the content hash
+ * and the chunk list instead of compressing and uploading the data again.
+ *
+ * The union file system scratch area is emptied after every publish, so inode
+ * numbers and time stamps of the new files never match earlier runs.  Instead,
+ * the cache is keyed by a fingerprint of the uncompressed content, which is
+ * much cheaper to compute than compressing the file.  Files that miss the
+ * cache, however, are read and hashed twice: once for the fingerprint and once
+ * by the ingestion pipeline.  The cache thus only pays off if a good part of
+ * the published files are unchanged.  It requires an uploader that can check
+ * for existing objects and is not used with the gateway.
+ */
+
+#ifndef CVMFS_SYNC_HASH_CACHE_H_
+#define CVMFS_SYNC_HASH_CACHE_H_
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include <string>
+
+#include "duplex_sqlite3.h"
+#include "hash.h"
+#include "upload_spooler_result.h"
+#include "util/pointer.h"
+
+namespace sqlite {
+class Sql;
+}
+
+namespace publish {
+
+/**
+ * A sqlite database that maps content fingerprints to spooler results.  The
+ * entries are only valid for the processing settings (hash and compression
+ * algorithm, chunk sizes) given on opening; a change of settings empties the
+ * cache.  All changes are written in a single transaction by Commit().
+ *
+ * The cache does not track garbage collection of the repository storage.
+ * Users need to verify that the objects of a cached result still exist.
+ *
+ * Thread-safe.
+ */
+class HashCache {
+ public:
+  /**
+   * Entries that have not been used for this long are dropped on opening
+   */
+  static const uint64_t kMaxAgeSec = 30 * 24 * 60 * 60;
+
+  /**
+   * Creates the database if necessary.  Returns NULL on failure.
+   */
+  static HashCache *Open(const std::string &db_path,
+                         const std::string &settings);
+  /**
+   * Rolls back uncommitted changes
+   */
+  ~HashCache();
+
+  /**
+   * Hashes the uncompressed content of the file at path.  The fingerprint
+   * includes the file size.  Returns false if the file cannot be read.
+   */
+  static bool Fingerprint(const std::string &path,
+                          const shash::Algorithms algorithm,
+                          std::string *fingerprint);
+
+  /**
+   * Fills content_hash, compression_alg and file_chunks of result.  The other
+   * fields remain untouched.
+   */
+  bool Lookup(const std::string &fingerprint, upload::SpoolerResult *result);
+  void Insert(const std::string &fingerprint,
+              const upload::SpoolerResult &result);
+  bool Commit();
+
+  uint64_t num_hits() const { return num_hits_; }
+  uint64_t num_inserts() const { return num_inserts_; }
+
+ private:
+  HashCache();
+  bool Exec(const std::string &sql);
+
+  sqlite3 *db_;
+  UniquePtr<sqlite::Sql> stmt_lookup_;
+  UniquePtr<sqlite::Sql> stmt_touch_;
+  UniquePtr<sqlite::Sql> stmt_insert_;
+  bool in_transaction_;
+  uint64_t now_;
+  uint64_t num_hits_;
+  uint64_t num_inserts_;
+  pthread_mutex_t lock_;
+};
+
+}  // namespace publish
+
+#endif  // CVMFS_SYNC_HASH_CACHE_H_
@@ -19,6 +19,8 @@
 #include "directory_entry.h"
 #include "fs_traversal.h"
 #include "hash.h"
+#include "ingestion/chunk_detector.h"
+#include "ingestion/ingestion_source.h"
 #include "json_document.h"
 #include "publish/repository.h"
 #include "smalloc.h"
@@ -51,6 +53,24 @@ SyncMediator::SyncMediator(catalog::WritableCatalogManager *catalog_manager,
   params->spooler->RegisterListener(&SyncMediator::PublishFilesCallback, this);
 
   counters_ = new perf::FsCounters(statistics);
+
+  if (!params->hash_cache_path.empty() && !params->external_data) {
+    // Hits are only usable if the uploader can check for existing objects
+    if (params->spooler->GetDriverType() == upload::SpoolerDefinition::Gateway)
+    {
+      LogCvmfs(kLogPublish, kLogStderr | kLogSyslogWarn,
+               "Warning: hash cache not supported by the gateway uploader, "
+               "continuing without");
+    } else {
+      hash_cache_ =
+        HashCache::Open(params->hash_cache_path, GetHashCacheSettings());
+      if (!hash_cache_.IsValid()) {
+        LogCvmfs(kLogPublish, kLogStderr | kLogSyslogWarn,
+                 "Warning: failed to open hash cache %s, continuing without",
+                 params->hash_cache_path.c_str());
+      }
+    }
+  }
 }
 
 SyncMediator::~SyncMediator() {
@@ -298,6 +318,16 @@ bool SyncMediator::Commit(manifest::Manifest *manifest) {
     LogCvmfs(kLogPublish, kLogStdout,
              "Waiting for upload of files before committing...");
     params_->spooler->WaitForUpload();
+    if (hash_cache_.IsValid()) {
+      LogCvmfs(kLogPublish, kLogStdout,
+               "Hash cache: %" PRIu64 " hits, %" PRIu64 " new entries",
+               hash_cache_->num_hits(), hash_cache_->num_inserts());
+      if (!hash_cache_->Commit()) {
+        LogCvmfs(kLogPublish, kLogStderr | kLogSyslogWarn,
+                 "Warning: failed to update hash cache %s",
+                 params_->hash_cache_path.c_str());
+      }
+    }
   }
 
   if (!hardlink_queue_.empty()) {
@@ -537,6 +567,15 @@ void SyncMediator::LegacySocketHardlinkCallback(const string &parent_dir,
 void SyncMediator::AddDirectoryRecursively(SharedPtr<SyncItem> entry) {
   AddDirectory(entry);
 
+  // During a parallel traversal, the directory is already being listed
+  SyncUnionWalker *walker = union_engine_->walker();
+  if (walker != NULL) {
+    EnterAddedDirectoryCallback(entry->GetRelativePath(), "");
+    AddDirectoryFromWalker(walker, entry->GetRelativePath());
+    LeaveAddedDirectoryCallback(entry->GetRelativePath(), "");
+    return;
+  }
+
   // Create a recursion engine, which recursively adds all entries in a newly
   // created directory
   FileSystemTraversal<SyncMediator> traversal(
@@ -555,6 +594,33 @@ void SyncMediator::AddDirectoryRecursively(SharedPtr<SyncItem> entry) {
 }
 
 
+/**
+ * Same as the recursion engine in AddDirectoryRecursively() with the Add*
+ * callbacks
+ */
+void SyncMediator::AddDirectoryFromWalker(
+  SyncUnionWalker *walker,
+  const std::string &relative_path)
+{
+  std::vector<SyncUnionWalker::Entry> entries;
+  walker->GetListing(relative_path, &entries);
+  for (unsigned i = 0; i < entries.size(); ++i) {
+    const SyncUnionWalker::Entry &walker_entry = entries[i];
+    // Cf. IgnoreFileCallback()
+    if (walker_entry.item->IsWhiteout())
+      continue;
+    if (walker_entry.type != kItemDir) {
+      Add(walker_entry.item);
+      continue;
+    }
+    AddDirectory(walker_entry.item);
+    EnterDirectory(walker_entry.enter_item);
+    AddDirectoryFromWalker(walker, walker_entry.relative_path);
+    LeaveDirectory(walker_entry.leave_item);
+  }
+}
+
+
 bool SyncMediator::AddDirectoryCallback(const std::string &parent_dir,
                                         const std::string &dir_name)
 {
@@ -725,6 +791,68 @@ SharedPtr<SyncItem> SyncMediator::CreateSyncItem(
                                        entry_type);
 }
 
+/**
+ * Describes the parameters that determine the objects generated for a file.
+ * Cached results are only valid for the same settings.
+ */
+std::string SyncMediator::GetHashCacheSettings() const {
+  return params_->spooler_definition + "|" +
+    StringifyInt(params_->spooler->GetHashAlgorithm()) + "|" +
+    zlib::AlgorithmName(params_->compression_alg) + "|" +
+    StringifyBool(params_->use_file_chunking) + "|" +
+    StringifyUint(params_->min_file_chunk_size) + "|" +
+    StringifyUint(params_->avg_file_chunk_size) + "|" +
+    StringifyUint(params_->max_file_chunk_size) + "|" +
+    ChunkingAlgorithmName(params_->chunking_algorithm) + "|" +
+    StringifyBool(params_->generate_legacy_bulk_chunks);
+}
+
+
+/**
+ * Adds the file to the catalog without processing it if the hash cache knows
+ * its content and all the referenced objects still exist in the storage.
+ * Otherwise, remembers the fingerprint so that the spooler result can be
+ * stored in the cache.  Returns true if the file needs no further processing.
+ */
+bool SyncMediator::AddFileFromHashCache(SharedPtr<SyncItem> entry) {
+  const std::string union_path = entry->GetUnionPath();
+  UniquePtr<IngestionSource> source(entry->CreateIngestionSource());
+  if (!source->IsRealFile())
+    return false;
+
+  std::string fingerprint;
+  if (!HashCache::Fingerprint(union_path, params_->spooler->GetHashAlgorithm(),
+                              &fingerprint))
+  {
+    return false;
+  }
+
+  upload::SpoolerResult result(0, union_path);
+  bool found = hash_cache_->Lookup(fingerprint, &result);
+  if (found && !result.content_hash.IsNull()) {
+    found = params_->spooler->Peek("data/" + result.content_hash.MakePath());
+  }
+  for (unsigned i = 0; found && (i < result.file_chunks.size()); ++i) {
+    found = params_->spooler->Peek(
+      "data/" + result.file_chunks.At(i).content_hash().MakePath());
+  }
+
+  {
+    MutexLockGuard m(&lock_file_queue_);
+    file_queue_[union_path] = entry;
+    if (!found)
+      fingerprints_[union_path] = fingerprint;
+  }
+  if (!found)
+    return false;
+
+  LogCvmfs(kLogPublish, kLogVerboseMsg, "Hash cache hit for %s",
+           union_path.c_str());
+  PublishFilesCallback(result);
+  return true;
+}
+
+
 void SyncMediator::PublishFilesCallback(const upload::SpoolerResult &result) {
   LogCvmfs(kLogPublish, kLogVerboseMsg,
            "Spooler callback for %s, digest %s, produced %d chunks, retval %d",
@@ -738,12 +866,21 @@ void SyncMediator::PublishFilesCallback(const upload::SpoolerResult &result) {
   }
 
   SyncItemList::iterator itr;
+  std::string fingerprint;
   {
     MutexLockGuard guard(lock_file_queue_);
     itr = file_queue_.find(result.local_path);
+    std::map<std::string, std::string>::iterator i =
+      fingerprints_.find(result.local_path);
+    if (i != fingerprints_.end()) {
+      fingerprint = i->second;
+      fingerprints_.erase(i);
+    }
   }
 
   assert(itr != file_queue_.end());
+  if (!fingerprint.empty())
+    hash_cache_->Insert(fingerprint, result);
 
   SyncItem &item = *itr->second;
   item.SetContentHash(result.content_hash);
@@ -968,13 +1105,15 @@ void SyncMediator::AddFile(SharedPtr<SyncItem> entry) {
              entry->IsCatalogMarker()) {
     PANIC(kLogStderr, "Error: nested catalog marker in root directory");
   } else if (!params_->dry_run) {
-    {
-      // Push the file to the spooler, remember the entry for the path
-      MutexLockGuard m(&lock_file_queue_);
-      file_queue_[entry->GetUnionPath()] = entry;
+    if (!hash_cache_.IsValid() || !AddFileFromHashCache(entry)) {
+      {
+        // Push the file to the spooler, remember the entry for the path
+        MutexLockGuard m(&lock_file_queue_);
+        file_queue_[entry->GetUnionPath()] = entry;
+      }
+      // Spool the file
+      params_->spooler->Process(entry->CreateIngestionSource());
     }
-    // Spool the file
-    params_->spooler->Process(entry->CreateIngestionSource());
   }
 
   // publish statistics counting for new file
@@ -39,6 +39,7 @@
 #include "publish/repository.h"
 #include "statistics.h"
 #include "swissknife_sync.h"
+#include "sync_hash_cache.h"
 #include "sync_item.h"
 #include "util/pointer.h"
 #include "util/shared_ptr.h"
@@ -224,6 +225,8 @@ class SyncMediator : public virtual AbstractSyncMediator {
   void LeaveAddedDirectoryCallback(const std::string &parent_dir,
                                    const std::string &dir_name);
   void AddDirectoryRecursively(SharedPtr<SyncItem> entry);
+  void AddDirectoryFromWalker(SyncUnionWalker *walker,
+                              const std::string &relative_path);
   bool AddDirectoryCallback(const std::string &parent_dir,
                             const std::string &dir_name);
   void AddFileCallback(const std::string &parent_dir,
@@ -242,6 +245,10 @@ class SyncMediator : public virtual AbstractSyncMediator {
                                      const std::string &filename,
                                      const SyncItemType entry_type) const;
 
+  // Looks up a new or modified file in the hash cache
+  bool AddFileFromHashCache(SharedPtr<SyncItem> entry);
+  std::string GetHashCacheSettings() const;
+
   // Called by Upload Spooler
   void PublishFilesCallback(const upload::SpoolerResult &result);
   void PublishHardlinksCallback(const upload::SpoolerResult &result);
@@ -288,6 +295,15 @@ class SyncMediator : public virtual AbstractSyncMediator {
    */
   pthread_mutex_t lock_file_queue_;
   SyncItemList file_queue_;
+  /**
+   * Fingerprints of the spooled files that were not found in the hash cache.
+   * Protected by lock_file_queue_.
+   */
+  std::map<std::string, std::string> fingerprints_;
+  /**
+   * Remembers content hashes of earlier publish runs.  NULL if disabled.
+   */
+  UniquePtr<HashCache> hash_cache_;
 
   HardlinkGroupList hardlink_queue_;
 
@@ -6,6 +6,8 @@
 
 #include "sync_union.h"
 
+#include <vector>
+
 #include "sync_mediator.h"
 #include "util/shared_ptr.h"
 
@@ -19,6 +21,7 @@ SyncUnion::SyncUnion(AbstractSyncMediator *mediator,
       scratch_path_(scratch_path),
       union_path_(union_path),
       mediator_(mediator),
+      num_traversal_threads_(0),
       initialized_(false) {}
 
 bool SyncUnion::Initialize() {
@@ -144,6 +147,38 @@ void SyncUnion::LeaveDirectory(const string &parent_dir,
   mediator_->LeaveDirectory(entry);
 }
 
+void SyncUnion::TraverseParallel() {
+  LogCvmfs(kLogUnionFs, kLogVerboseMsg,
+           "starting parallel traversal of scratch_path=[%s] with %u threads",
+           scratch_path().c_str(), num_traversal_threads_);
+  walker_ = new SyncUnionWalker(this, num_traversal_threads_);
+  walker_->Spawn();
+  EnterDirectory("", "");
+  TraverseDirectory("");
+  LeaveDirectory("", "");
+  walker_.Destroy();
+}
+
+/**
+ * Same decisions as the sequential traversal with the callbacks of this class
+ */
+void SyncUnion::TraverseDirectory(const std::string &relative_path) {
+  std::vector<SyncUnionWalker::Entry> entries;
+  walker_->GetListing(relative_path, &entries);
+  for (unsigned i = 0; i < entries.size(); ++i) {
+    const SyncUnionWalker::Entry &entry = entries[i];
+    if (entry.type != kItemDir) {
+      ProcessFile(entry.item);
+      continue;
+    }
+    if (ProcessDirectory(entry.item)) {
+      mediator_->EnterDirectory(entry.enter_item);
+      TraverseDirectory(entry.relative_path);
+      mediator_->LeaveDirectory(entry.leave_item);
+    }
+  }
+}
+
 void SyncUnion::ProcessCharacterDevice(const std::string &parent_dir,
                                        const std::string &filename) {
   LogCvmfs(kLogUnionFs, kLogDebug,
@@ -34,6 +34,8 @@
 #include <string>
 
 #include "sync_item.h"
+#include "sync_union_walker.h"
+#include "util/pointer.h"
 #include "util/shared_ptr.h"
 
 namespace publish {
@@ -139,6 +141,20 @@ class SyncUnion {
   bool IsInitialized() const { return initialized_; }
   virtual bool SupportsHardlinks() const { return false; }
 
+  /**
+   * With more than one thread, Traverse() lists the scratch area and prepares
+   * the SyncItems in parallel (see SyncUnionWalker).  The mediator receives
+   * the same callbacks in the same order as with a sequential traversal.
+   */
+  void SetNumTraversalThreads(const unsigned num_threads) {
+    num_traversal_threads_ = num_threads;
+  }
+  /**
+   * The walker of a running parallel traversal, NULL otherwise.  The mediator
+   * takes the listings of added directories from here.
+   */
+  SyncUnionWalker *walker() { return walker_.weak_ref(); }
+
  protected:
   std::string rdonly_path_;
   std::string scratch_path_;
@@ -236,8 +252,19 @@ class SyncUnion {
    */
   void ProcessFile(SharedPtr<SyncItem> entry);
 
+  /**
+   * Replaces the sequential FileSystemTraversal of the scratch area in
+   * Traverse() if more than one traversal thread is set.
+   */
+  void TraverseParallel();
+
+  unsigned num_traversal_threads_;
+
  private:
+  void TraverseDirectory(const std::string &relative_path);
+
   bool initialized_;
+  UniquePtr<SyncUnionWalker> walker_;
 };  // class SyncUnion
 
 }  // namespace publish
@@ -33,6 +33,11 @@ SyncUnionAufs::SyncUnionAufs(SyncMediator *mediator,
 void SyncUnionAufs::Traverse() {
   assert(this->IsInitialized());
 
+  if (num_traversal_threads_ > 1) {
+    TraverseParallel();
+    return;
+  }
+
   FileSystemTraversal<SyncUnionAufs> traversal(this, scratch_path(), true);
 
   traversal.fn_enter_dir = &SyncUnionAufs::EnterDirectory;
@@ -153,6 +153,11 @@ void SyncUnionOverlayfs::MaskFileHardlinks(SharedPtr<SyncItem> entry) const {
 void SyncUnionOverlayfs::Traverse() {
   assert(this->IsInitialized());
 
+  if (num_traversal_threads_ > 1) {
+    TraverseParallel();
+    return;
+  }
+
   FileSystemTraversal<SyncUnionOverlayfs> traversal(this, scratch_path(), true);
 
   traversal.fn_enter_dir = &SyncUnionOverlayfs::EnterDirectory;
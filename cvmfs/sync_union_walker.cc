@@ -0,0 +1,272 @@
+/**
+ * This file is part of the CernVM File System
+ */
+
+#include "sync_union_walker.h"
+
+#include <dirent.h>
+#include <errno.h>
+
+#include <cassert>
+
+#include "logging.h"
+#include "platform.h"
+#include "sync_union.h"
+#include "util/exception.h"
+
+using namespace std;  // NOLINT
+
+namespace publish {
+
+SyncUnionWalker::SyncUnionWalker(SyncUnion *union_engine,
+                                 const unsigned num_threads)
+  : union_engine_(union_engine)
+  , num_threads_(num_threads)
+  , spawned_(false)
+  , queues_(num_threads + 1)
+  , num_buffered_(0)
+  , terminate_(false)
+{
+  int retval = pthread_mutex_init(&lock_, NULL);
+  assert(retval == 0);
+  retval = pthread_cond_init(&cond_work_, NULL);
+  assert(retval == 0);
+  retval = pthread_cond_init(&cond_done_, NULL);
+  assert(retval == 0);
+
+  Directory *root = new Directory("");
+  directories_[""] = root;
+  queues_[0].push_back(root);
+}
+
+
+SyncUnionWalker::~SyncUnionWalker() {
+  if (spawned_) {
+    pthread_mutex_lock(&lock_);
+    terminate_ = true;
+    pthread_cond_broadcast(&cond_work_);
+    pthread_mutex_unlock(&lock_);
+    for (unsigned i = 0; i < threads_.size(); ++i) {
+      int retval = pthread_join(threads_[i], NULL);
+      assert(retval == 0);
+    }
+  }
+
+  for (map<string, Directory *>::iterator i = directories_.begin(),
+       iEnd = directories_.end(); i != iEnd; ++i)
+  {
+    delete i->second;
+  }
+  pthread_cond_destroy(&cond_done_);
+  pthread_cond_destroy(&cond_work_);
+  pthread_mutex_destroy(&lock_);
+}
+
+
+void SyncUnionWalker::Spawn() {
+  assert(!spawned_);
+  threads_.resize(num_threads_);
+  thread_args_.resize(num_threads_);
+  for (unsigned i = 0; i < num_threads_; ++i) {
+    thread_args_[i].walker = this;
+    thread_args_[i].queue_id = i;
+    int retval =
+      pthread_create(&threads_[i], NULL, MainWorker, &thread_args_[i]);
+    if (retval != 0) PANIC(kLogStderr, "failed to create thread");
+  }
+  spawned_ = true;
+}
+
+
+void *SyncUnionWalker::MainWorker(void *data) {
+  ThreadArgs *args = reinterpret_cast<ThreadArgs *>(data);
+  SyncUnionWalker *walker = args->walker;
+  const unsigned queue_id = args->queue_id;
+
+  vector<string> subdirs;
+  pthread_mutex_lock(&walker->lock_);
+  while (!walker->terminate_) {
+    Directory *directory = NULL;
+    if (walker->num_buffered_ < kMaxBufferedEntries)
+      directory = walker->TakeTask(queue_id);
+    if (directory == NULL) {
+      pthread_cond_wait(&walker->cond_work_, &walker->lock_);
+      continue;
+    }
+
+    directory->state = Directory::kRunning;
+    pthread_mutex_unlock(&walker->lock_);
+    subdirs.clear();
+    walker->Scan(directory, &subdirs);
+    pthread_mutex_lock(&walker->lock_);
+    walker->FinishScan(directory, subdirs, queue_id);
+  }
+  pthread_mutex_unlock(&walker->lock_);
+  return NULL;
+}
+
+
+SyncUnionWalker::Directory *SyncUnionWalker::TakeTask(
+  const unsigned queue_id)
+{
+  deque<Directory *> *own_queue = &queues_[queue_id];
+  while (!own_queue->empty()) {
+    Directory *directory = own_queue->back();
+    own_queue->pop_back();
+    if (directory->state == Directory::kQueued)
+      return directory;
+  }
+
+  for (unsigned i = 1; i < queues_.size(); ++i) {
+    deque<Directory *> *victim = &queues_[(queue_id + i) % queues_.size()];
+    while (!victim->empty()) {
+      Directory *directory = victim->front();
+      victim->pop_front();
+      if (directory->state == Directory::kQueued)
+        return directory;
+    }
+  }
+  return NULL;
+}
+
+
+void SyncUnionWalker::Scan(Directory *directory, vector<string> *subdirs) {
+  const string &relative_path = directory->relative_path;
+  const string path = union_engine_->scratch_path() +
+    (relative_path.empty() ? "" : ("/" + relative_path));
+  LogCvmfs(kLogUnionFs, kLogVerboseMsg, "listing %s", path.c_str());
+
+  DIR *dip = opendir(path.c_str());
+  if (!dip) {
+    PANIC(kLogStderr,
+          "Failed to open %s (%d).\n"
+          "Please check directory permissions.",
+          path.c_str(), errno);
+  }
+  platform_dirent64 *dit;
+  while ((dit = platform_readdir(dip)) != NULL) {
+    const string name(dit->d_name);
+    if ((name == ".") || (name == ".."))
+      continue;
+    if (union_engine_->IgnoreFilePredicate(relative_path, name)) {
+      LogCvmfs(kLogUnionFs, kLogVerboseMsg, "ignoring %s/%s",
+               path.c_str(), name.c_str());
+      continue;
+    }
+
+    platform_stat64 info;
+    int retval = platform_lstat((path + "/" + name).c_str(), &info);
+    if (retval != 0) {
+      PANIC(kLogStderr, "failed to lstat '%s' errno: %d",
+            (path + "/" + name).c_str(), errno);
+    }
+
+    Entry entry;
+    if (S_ISDIR(info.st_mode)) {
+      entry.type = kItemDir;
+    } else if (S_ISREG(info.st_mode)) {
+      entry.type = kItemFile;
+    } else if (S_ISLNK(info.st_mode)) {
+      entry.type = kItemSymlink;
+    } else if (S_ISSOCK(info.st_mode)) {
+      entry.type = kItemSocket;
+    } else if (S_ISBLK(info.st_mode)) {
+      entry.type = kItemBlockDevice;
+    } else if (S_ISCHR(info.st_mode)) {
+      entry.type = kItemCharacterDevice;
+    } else if (S_ISFIFO(info.st_mode)) {
+      entry.type = kItemFifo;
+    } else {
+      LogCvmfs(kLogUnionFs, kLogVerboseMsg, "unknown file type %s/%s",
+               path.c_str(), name.c_str());
+      continue;
+    }
+
+    entry.relative_path =
+      relative_path.empty() ? name : (relative_path + "/" + name);
+    entry.item =
+      union_engine_->CreateSyncItem(relative_path, name, entry.type);
+    if (entry.type == kItemDir) {
+      entry.enter_item =
+        union_engine_->CreateSyncItem(relative_path, name, kItemDir);
+      entry.leave_item =
+        union_engine_->CreateSyncItem(relative_path, name, kItemDir);
+      subdirs->push_back(entry.relative_path);
+    }
+    if (!entry.item->IsWhiteout()) {
+      // Populate the stat caches of the item in the read-only branch, the
+      // union file system and the scratch area
+      entry.item->IsNew();
+      entry.item->GetUnionLinkcount();
+      entry.item->GetScratchSize();
+    }
+    directory->entries.push_back(entry);
+  }
+  closedir(dip);
+}
+
+
+void SyncUnionWalker::FinishScan(
+  Directory *directory,
+  const vector<string> &subdirs,
+  const unsigned queue_id)
+{
+  // Pushed in reverse order, so that the owner continues with the first
+  // subdirectory, which is also the next one requested by the consumer
+  for (vector<string>::const_reverse_iterator i = subdirs.rbegin(),
+       iEnd = subdirs.rend(); i != iEnd; ++i)
+  {
+    if (directories_.find(*i) != directories_.end())
+      continue;
+    Directory *subdir = new Directory(*i);
+    directories_[*i] = subdir;
+    queues_[queue_id].push_back(subdir);
+  }
+  directory->state = Directory::kDone;
+  num_buffered_ += directory->entries.size();
+  pthread_cond_broadcast(&cond_done_);
+  if (!subdirs.empty())
+    pthread_cond_broadcast(&cond_work_);
+}
+
+
+void SyncUnionWalker::GetListing(
+  const string &relative_path,
+  vector<Entry> *entries)
+{
+  pthread_mutex_lock(&lock_);
+  Directory *directory;
+  map<string, Directory *>::const_iterator i =
+    directories_.find(relative_path);
+  if (i == directories_.end()) {
+    directory = new Directory(relative_path);
+    directories_[relative_path] = directory;
+  } else {
+    directory = i->second;
+  }
+
+  vector<string> subdirs;
+  while (directory->state != Directory::kDone) {
+    if (directory->state == Directory::kRunning) {
+      pthread_cond_wait(&cond_done_, &lock_);
+      continue;
+    }
+    // Not yet picked up or requested again: list it here
+    directory->state = Directory::kRunning;
+    pthread_mutex_unlock(&lock_);
+    Scan(directory, &subdirs);
+    pthread_mutex_lock(&lock_);
+    FinishScan(directory, subdirs, num_threads_);
+  }
+
+  entries->swap(directory->entries);
+  directory->entries.clear();
+  directory->state = Directory::kConsumed;
+  const bool was_full = num_buffered_ >= kMaxBufferedEntries;
+  num_buffered_ -= entries->size();
+  if (was_full && (num_buffered_ < kMaxBufferedEntries))
+    pthread_cond_broadcast(&cond_work_);
+  pthread_mutex_unlock(&lock_);
+}
+
+}  // namespace publish
@@ -0,0 +1,163 @@
+/**
+ * This file is part of the CernVM File System
+ *
+ * On large transactions, most of the synchronization time is spent in stat()
+ * calls: every entry of the scratch area is checked in the scratch area, the
+ * union mount and the read-only cvmfs mount, plus extended attributes and
+ * graft files.  The SyncUnionWalker does this work with a pool of threads
+ * while the synchronization itself stays sequential.
+ */
+
+#ifndef CVMFS_SYNC_UNION_WALKER_H_
+#define CVMFS_SYNC_UNION_WALKER_H_
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "sync_item.h"
+#include "util/shared_ptr.h"
+#include "util/single_copy.h"
+
+namespace publish {
+
+class SyncUnion;
+
+/**
+ * Lists the directories of the scratch area in parallel.  For every directory
+ * entry, it creates the SyncItem and obtains its stat information ahead of
+ * time.  Every directory is a task.  Each thread has its own queue of tasks;
+ * a thread that runs out of work steals from the other queues.  Owners take
+ * the most recently found directory, thieves take the oldest one, which is
+ * usually the largest remaining subtree.
+ *
+ * The consumer requests the listing of a directory by GetListing().  It
+ * receives the entries in readdir() order, so that callbacks are delivered in
+ * the same order as with a sequential FileSystemTraversal.  If the requested
+ * directory has not yet been picked up by a thread, the consumer lists it
+ * itself.  Each listing should be requested exactly once.
+ *
+ * The number of prepared but not yet consumed entries is limited, so that a
+ * slow consumer does not end up with the entire scratch area in memory.
+ */
+class SyncUnionWalker : SingleCopy {
+ public:
+  /**
+   * Threads pause picking up new directories above this number of buffered
+   * directory entries.
+   */
+  static const uint64_t kMaxBufferedEntries = 128 * 1024;
+
+  struct Entry {
+    Entry() : type(kItemUnknown) { }
+
+    /**
+     * Path of the entry relative to the scratch area, as found in the
+     * scratch area (also for whiteouts)
+     */
+    std::string relative_path;
+    SyncItemType type;
+    SharedPtr<SyncItem> item;
+    /**
+     * For directories, separate items for entering and leaving the directory,
+     * as created by the sequential traversal
+     */
+    SharedPtr<SyncItem> enter_item;
+    SharedPtr<SyncItem> leave_item;
+  };
+
+  SyncUnionWalker(SyncUnion *union_engine, const unsigned num_threads);
+  /**
+   * Stops the threads.  Directories that were not requested are dropped.
+   */
+  ~SyncUnionWalker();
+
+  void Spawn();
+  /**
+   * Blocks until the directory at relative_path (empty for the root of the
+   * scratch area) is listed.  Ownership of the entries goes to the caller.
+   */
+  void GetListing(const std::string &relative_path,
+                  std::vector<Entry> *entries);
+
+ private:
+  struct Directory {
+    enum State {
+      kQueued,
+      kRunning,
+      kDone,
+      kConsumed,
+    };
+
+    explicit Directory(const std::string &p)
+      : relative_path(p), state(kQueued) { }
+
+    std::string relative_path;
+    State state;
+    std::vector<Entry> entries;
+  };
+
+  struct ThreadArgs {
+    ThreadArgs() : walker(NULL), queue_id(0) { }
+    SyncUnionWalker *walker;
+    unsigned queue_id;
+  };
+
+  static void *MainWorker(void *data);
+  /**
+   * Called with lock_ held
+   */
+  Directory *TakeTask(const unsigned queue_id);
+  /**
+   * Called without lock_ held.  Lists the directory and returns the paths of
+   * the subdirectories.
+   */
+  void Scan(Directory *directory, std::vector<std::string> *subdirs);
+  /**
+   * Called with lock_ held.  Registers the subdirectories as new tasks in the
+   * given queue and marks the directory as done.
+   */
+  void FinishScan(Directory *directory,
+                  const std::vector<std::string> &subdirs,
+                  const unsigned queue_id);
+
+  SyncUnion *union_engine_;
+  unsigned num_threads_;
+  std::vector<pthread_t> threads_;
+  std::vector<ThreadArgs> thread_args_;
+  bool spawned_;
+
+  /**
+   * Protects all of the following
+   */
+  pthread_mutex_t lock_;
+  /**
+   * Signals new tasks and free buffer space to the threads
+   */
+  pthread_cond_t cond_work_;
+  /**
+   * Signals finished directories to the consumer
+   */
+  pthread_cond_t cond_done_;
+  /**
+   * One queue per thread plus one for the directories found by the consumer.
+   * Queued pointers become stale when the consumer takes over a directory;
+   * such entries are skipped.
+   */
+  std::vector<std::deque<Directory *> > queues_;
+  /**
+   * All directories found so far, by relative path.  Directories are only
+   * deleted on destruction, their entries are released on consumption.
+   */
+  std::map<std::string, Directory *> directories_;
+  uint64_t num_buffered_;
+  bool terminate_;
+};
+
+}  // namespace publish
+
+#endif  // CVMFS_SYNC_UNION_WALKER_H_
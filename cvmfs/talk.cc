@@ -52,6 +52,7 @@
 #include "options.h"
 #include "platform.h"
 #include "quota.h"
+#include "quota_posix.h"
 #include "shortstring.h"
 #include "statistics.h"
 #include "tracer.h"
@@ -236,6 +237,20 @@ void *TalkManager::MainResponder(void *data) {
         vector<string> ls_catalogs = quota_mgr->ListCatalogs();
         talk_mgr->AnswerStringList(con_fd, ls_catalogs);
       }
+    } else if (line == "cache rebuild") {
+      if (file_system->cache_mgr()->id() != kPosixCacheManager) {
+        talk_mgr->Answer(con_fd, "Unsupported by this cache\n");
+      } else {
+        PosixCacheManager *cache_mgr =
+          reinterpret_cast<PosixCacheManager *>(file_system->cache_mgr());
+        const string status =
+          PosixQuotaManager::GetRebuildStatus(cache_mgr->cache_path());
+        if (status.empty()) {
+          talk_mgr->Answer(con_fd, "No cache database rebuild recorded\n");
+        } else {
+          talk_mgr->Answer(con_fd, status);
+        }
+      }
     } else if (line.substr(0, 12) == "cleanup rate") {
       QuotaManager *quota_mgr = file_system->cache_mgr()->quota_mgr();
       if (!quota_mgr->HasCapability(QuotaManager::kCapIntrospectCleanupRate)) {
@@ -33,8 +33,15 @@ SpoolerDefinition::SpoolerDefinition(
       min_file_chunk_size(min_file_chunk_size),
       avg_file_chunk_size(avg_file_chunk_size),
       max_file_chunk_size(max_file_chunk_size),
+      chunking_algorithm(kChunkingXor32),
       number_of_concurrent_uploads(kDefaultMaxConcurrentUploads),
       num_upload_tasks(kDefaultNumUploadTasks),
+      num_read_tasks(0),
+      num_chunk_tasks(0),
+      num_compress_tasks(0),
+      num_hash_tasks(0),
+      num_write_tasks(0),
+      num_register_tasks(0),
       session_token_file(session_token_file),
       key_file(key_file),
       valid_(false) {
@@ -9,6 +9,7 @@
 
 #include "compression.h"
 #include "hash.h"
+#include "ingestion/chunk_detector.h"
 
 namespace upload {
 
@@ -75,6 +76,7 @@ struct SpoolerDefinition {
   size_t min_file_chunk_size;
   size_t avg_file_chunk_size;
   size_t max_file_chunk_size;
+  ChunkingAlgorithms chunking_algorithm;
 
   /**
    * This is the number of concurrently open files to be uploaded. It does not,
@@ -88,6 +90,17 @@ struct SpoolerDefinition {
    */
   unsigned int num_upload_tasks;
 
+  /**
+   * Number of threads per stage of the ingestion pipeline.  Zero sizes the
+   * stage according to the number of CPU cores.
+   */
+  unsigned int num_read_tasks;
+  unsigned int num_chunk_tasks;
+  unsigned int num_compress_tasks;
+  unsigned int num_hash_tasks;
+  unsigned int num_write_tasks;
+  unsigned int num_register_tasks;
+
   // The session_token_file parameter is only used for the HTTP driver
   std::string session_token_file;
   std::string key_file;
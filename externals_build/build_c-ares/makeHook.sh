@@ -0,0 +1,7 @@
+#!/bin/sh
+
+make clean
+make
+# Don't strip debug symbols
+# strip -S .libs/libcares.a
+make install
@@ -0,0 +1,5 @@
+#!/bin/sh
+
+make
+
+make install